@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui multimedia
+QT       += core gui multimedia concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -25,15 +25,59 @@ DEFINES += QT_DEPRECATED_WARNINGS
 CONFIG += c++11
 
 SOURCES += \
+        audioengine.cpp \
+        bodystore.cpp \
+        collisionworld.cpp \
+        csvloader.cpp \
+        csvparser.cpp \
+        csvwriter.cpp \
+        editjournal.cpp \
+        formulaengine.cpp \
         graphicseditor.cpp \
         graphicsview.cpp \
+        indexshift.cpp \
+        largefileview.cpp \
         main.cpp \
-        mainwindow.cpp
+        mainwindow.cpp \
+        richtextformat.cpp \
+        savejob.cpp \
+        searchengine.cpp \
+        simulation.cpp \
+        strokeindex.cpp \
+        strokeitem.cpp \
+        stylesidecar.cpp \
+        tablecolumn.cpp \
+        tablecommands.cpp \
+        tablemodel.cpp \
+        tablesorter.cpp \
+        undostore.cpp
 
 HEADERS += \
+        audioengine.h \
+        bodystore.h \
+        collisionworld.h \
+        csvloader.h \
+        csvparser.h \
+        csvwriter.h \
+        editjournal.h \
+        formulaengine.h \
         graphicseditor.h \
         graphicsview.h \
-        mainwindow.h
+        indexshift.h \
+        largefileview.h \
+        mainwindow.h \
+        richtextformat.h \
+        savejob.h \
+        searchengine.h \
+        simulation.h \
+        strokeindex.h \
+        strokeitem.h \
+        stylesidecar.h \
+        tablecolumn.h \
+        tablecommands.h \
+        tablemodel.h \
+        tablesorter.h \
+        undostore.h
 
 FORMS += \
         graphicseditor.ui \
@@ -0,0 +1,224 @@
+#include "audioengine.h"
+
+#include <QAudioDeviceInfo>
+#include <QDebug>
+#include <QFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+static const int BufferMs = 20; // Буфер вывода: чем меньше, тем меньше задержка
+
+// Громкость голоса в процентах по числу слившихся в него ударов
+static int gainForHits(int hits) { return qMin(100, 50 + 10 * hits); }
+
+// Разбор RIFF/WAVE с несжатым PCM 8 или 16 бит. Отсчёты приводятся к 16 битам
+static bool decodeWav(const QByteArray &file, QAudioFormat &format,
+                      QVector<qint16> &samples) {
+  const char *data = file.constData();
+  if (file.size() < 12 || memcmp(data, "RIFF", 4) != 0 ||
+      memcmp(data + 8, "WAVE", 4) != 0) {
+    return false;
+  }
+
+  int channels = 0, sampleRate = 0, bits = 0;
+  int offset = 12;
+  while (offset + 8 <= file.size()) {
+    const char *chunk = data + offset;
+    const int chunkSize = int(qFromLittleEndian<quint32>(chunk + 4));
+    const int body = offset + 8;
+    if (chunkSize < 0 || body + chunkSize > file.size()) {
+      return false;
+    }
+
+    if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+      if (qFromLittleEndian<quint16>(data + body) != 1) {
+        return false; // Только несжатый PCM
+      }
+      channels = qFromLittleEndian<quint16>(data + body + 2);
+      sampleRate = int(qFromLittleEndian<quint32>(data + body + 4));
+      bits = qFromLittleEndian<quint16>(data + body + 14);
+    } else if (memcmp(chunk, "data", 4) == 0) {
+      if (channels <= 0 || sampleRate <= 0 || (bits != 8 && bits != 16)) {
+        return false;
+      }
+      const uchar *pcm = reinterpret_cast<const uchar *>(data + body);
+      if (bits == 16) {
+        samples.resize(chunkSize / 2);
+        for (int i = 0; i < samples.size(); ++i) {
+          samples[i] = qFromLittleEndian<qint16>(pcm + 2 * i);
+        }
+      } else {
+        samples.resize(chunkSize);
+        for (int i = 0; i < samples.size(); ++i) {
+          samples[i] = qint16((int(pcm[i]) - 128) << 8);
+        }
+      }
+
+      format.setSampleRate(sampleRate);
+      format.setChannelCount(channels);
+      format.setSampleSize(16);
+      format.setSampleType(QAudioFormat::SignedInt);
+      format.setByteOrder(QAudioFormat::LittleEndian);
+      format.setCodec("audio/pcm");
+      return !samples.isEmpty();
+    }
+    offset = body + chunkSize + (chunkSize & 1); // Блоки выровнены на 2 байта
+  }
+  return false;
+}
+
+AudioMixer::AudioMixer(const QVector<qint16> &samples,
+                       const QAudioFormat &format)
+    : samples(samples), format(format), output(nullptr),
+      voices(MaxVoices, Voice{-1, 0}), lastVoice(-1), pendingGain(0),
+      pendingBoost(0), stopRequested(0) {}
+
+AudioMixer::~AudioMixer() {
+  delete output; // Останавливаем вывод, пока микшер ещё цел
+}
+
+void AudioMixer::start() {
+  output = new QAudioOutput(format, this);
+  output->setBufferSize(format.bytesForDuration(BufferMs * 1000));
+  open(QIODevice::ReadOnly);
+  output->start(this);
+}
+
+void AudioMixer::requestVoice(int gainPercent) {
+  pendingGain.fetchAndStoreOrdered(gainPercent);
+}
+
+void AudioMixer::requestBoost(int gainPercent) {
+  pendingBoost.fetchAndStoreOrdered(gainPercent);
+}
+
+void AudioMixer::requestStop() {
+  pendingGain.fetchAndStoreOrdered(0);
+  pendingBoost.fetchAndStoreOrdered(0);
+  stopRequested.fetchAndStoreOrdered(1);
+}
+
+qint64 AudioMixer::bytesAvailable() const {
+  // Поток не кончается: без голосов отдаётся тишина
+  return format.bytesForDuration(BufferMs * 1000) + QIODevice::bytesAvailable();
+}
+
+void AudioMixer::startVoice(int gain) {
+  // Свободный голос или, если все заняты, тот, что звучит дольше всех
+  auto slot = std::max_element(
+      voices.begin(), voices.end(), [](const Voice &a, const Voice &b) {
+        return (a.position < 0 ? INT_MAX : a.position) <
+               (b.position < 0 ? INT_MAX : b.position);
+      });
+  slot->position = 0;
+  slot->gain = gain;
+  lastVoice = int(slot - voices.begin());
+}
+
+void AudioMixer::boostVoice(int gain) {
+  // Затихший голос не перезапускается: удары уже отзвучали
+  if (lastVoice >= 0 && voices.at(lastVoice).position >= 0) {
+    Voice &voice = voices[lastVoice];
+    voice.gain = qMax(voice.gain, gain);
+  }
+}
+
+qint64 AudioMixer::readData(char *data, qint64 maxSize) {
+  if (stopRequested.fetchAndStoreOrdered(0)) {
+    for (Voice &voice : voices) {
+      voice.position = -1;
+    }
+  }
+  const int gain = pendingGain.fetchAndStoreOrdered(0);
+  if (gain > 0) {
+    startVoice(gain);
+  }
+  const int boost = pendingBoost.fetchAndStoreOrdered(0);
+  if (boost > 0) {
+    boostVoice(boost);
+  }
+
+  const int count = int(maxSize / 2);
+  mixBuffer.fill(0, count);
+  for (Voice &voice : voices) {
+    if (voice.position < 0) {
+      continue;
+    }
+    const int length = qMin(count, samples.size() - voice.position);
+    const qint16 *source = samples.constData() + voice.position;
+    for (int i = 0; i < length; ++i) {
+      mixBuffer[i] += source[i] * voice.gain / 100;
+    }
+    voice.position += length;
+    if (voice.position >= samples.size()) {
+      voice.position = -1;
+    }
+  }
+
+  qint16 *out = reinterpret_cast<qint16 *>(data);
+  for (int i = 0; i < count; ++i) {
+    out[i] = qint16(qBound(-32768, mixBuffer.at(i), 32767));
+  }
+  return qint64(count) * 2;
+}
+
+qint64 AudioMixer::writeData(const char *, qint64) { return -1; }
+
+AudioEngine::AudioEngine(const QString &fileName, QObject *parent)
+    : QObject(parent), mixer(nullptr), thread(nullptr),
+      lastTrigger(-MinTriggerInterval), burstHits(0) {
+  QFile file(fileName);
+  QAudioFormat format;
+  QVector<qint16> samples;
+  if (!file.open(QIODevice::ReadOnly) ||
+      !decodeWav(file.readAll(), format, samples)) {
+    qWarning() << "AudioEngine: не удалось декодировать" << fileName;
+    return;
+  }
+  if (!QAudioDeviceInfo::defaultOutputDevice().isFormatSupported(format)) {
+    qWarning() << "AudioEngine: формат" << fileName
+               << "не поддерживается устройством вывода";
+    return;
+  }
+
+  // Вывод создаётся и работает целиком в потоке звука
+  mixer = new AudioMixer(samples, format);
+  thread = new QThread(this);
+  mixer->moveToThread(thread);
+  connect(thread, &QThread::started, mixer, &AudioMixer::start);
+  connect(thread, &QThread::finished, mixer, &QObject::deleteLater);
+  thread->start(QThread::TimeCriticalPriority);
+  clock.start();
+}
+
+AudioEngine::~AudioEngine() {
+  if (thread) {
+    thread->quit(); // Микшер удалится по завершении потока
+    thread->wait();
+  }
+}
+
+void AudioEngine::trigger(int hits) {
+  if (!mixer || hits <= 0) {
+    return;
+  }
+  const qint64 now = clock.elapsed();
+  if (now - lastTrigger < MinTriggerInterval) {
+    // Слишком часто: удары сливаются с уже звучащим голосом и делают его громче
+    burstHits += hits;
+    mixer->requestBoost(gainForHits(burstHits));
+    return;
+  }
+  lastTrigger = now;
+  burstHits = hits;
+  mixer->requestVoice(gainForHits(hits));
+}
+
+void AudioEngine::stop() {
+  if (mixer) {
+    mixer->requestStop();
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef AUDIOENGINE_H
+#define AUDIOENGINE_H
+
+#include <QAtomicInt>
+#include <QAudioFormat>
+#include <QAudioOutput>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+
+// Микшер голосов. Живёт в потоке звука: QAudioOutput сам забирает из него
+// данные, а поток GUI только передаёт через атомарные флаги запросы на
+// новый голос, усиление последнего голоса и остановку.
+class AudioMixer : public QIODevice {
+  Q_OBJECT
+
+public:
+  static const int MaxVoices = 8; // Больше голосов не смешивается одновременно
+
+  AudioMixer(const QVector<qint16> &samples, const QAudioFormat &format);
+  ~AudioMixer() override;
+
+  void requestVoice(int gainPercent);
+  // Поднимает громкость последнего запущенного голоса, если он ещё звучит
+  void requestBoost(int gainPercent);
+  void requestStop();
+
+  bool isSequential() const override { return true; }
+  qint64 bytesAvailable() const override;
+
+public slots:
+  void start();
+
+protected:
+  qint64 readData(char *data, qint64 maxSize) override;
+  qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+  struct Voice {
+    int position; // Следующий отсчёт; -1 - голос свободен
+    int gain;     // Громкость в процентах
+  };
+
+  void startVoice(int gain);
+  void boostVoice(int gain);
+
+  const QVector<qint16> samples; // Звук, декодированный в 16-битный PCM
+  QAudioFormat format;
+  QAudioOutput *output;
+
+  QVector<Voice> voices;
+  int lastVoice; // Последний запущенный голос; -1 - ещё не было
+  QVector<qint32> mixBuffer;
+  QAtomicInt pendingGain;   // Громкость голоса, ждущего запуска; 0 - нет
+  QAtomicInt pendingBoost;  // Новая громкость последнего голоса; 0 - нет
+  QAtomicInt stopRequested;
+};
+
+// Звук столкновений.
+// WAV-файл декодируется один раз при создании, голоса смешиваются в
+// отдельном потоке. Частые срабатывания сливаются: за MinTriggerInterval
+// запускается не больше одного голоса, а удары, пришедшие за это время,
+// добавляются к нему и поднимают его громкость.
+class AudioEngine : public QObject {
+  Q_OBJECT
+
+public:
+  static const int MinTriggerInterval = 50; // мс между запусками голосов
+
+  explicit AudioEngine(const QString &fileName, QObject *parent = nullptr);
+  ~AudioEngine() override;
+
+  bool isValid() const { return mixer != nullptr; }
+
+  // Вызывается из потока GUI один раз за кадр с числом столкновений
+  void trigger(int hits);
+  void stop();
+
+private:
+  AudioMixer *mixer;
+  QThread *thread;
+  QElapsedTimer clock;
+  qint64 lastTrigger;
+  int burstHits; // Удары с запуска последнего голоса
+};
+
+#endif // AUDIOENGINE_H
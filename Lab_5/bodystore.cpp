@@ -0,0 +1,68 @@
+#include "bodystore.h"
+
+int BodyStore::add(QGraphicsItemGroup *item, const QPointF &position,
+                   const QRectF &bounds, const QPointF &velocity) {
+  x.append(position.x());
+  y.append(position.y());
+  vx.append(velocity.x());
+  vy.append(velocity.y());
+  centerX.append(bounds.center().x());
+  centerY.append(bounds.center().y());
+  halfWidth.append(bounds.width() / 2);
+  halfHeight.append(bounds.height() / 2);
+  flags.append(0);
+
+  items.append(item);
+  index.insert(item, items.size() - 1);
+  return items.size() - 1;
+}
+
+// Удаление обменом с последним телом: массивы остаются плотными,
+// а индекс меняется только у перенесённого тела
+template <typename T> static void swapRemove(QVector<T> &vector, int i) {
+  vector[i] = vector.last();
+  vector.removeLast();
+}
+
+void BodyStore::remove(int i) {
+  index.remove(items.at(i));
+  if (i != items.size() - 1) {
+    index.insert(items.last(), i);
+  }
+
+  swapRemove(x, i);
+  swapRemove(y, i);
+  swapRemove(vx, i);
+  swapRemove(vy, i);
+  swapRemove(centerX, i);
+  swapRemove(centerY, i);
+  swapRemove(halfWidth, i);
+  swapRemove(halfHeight, i);
+  swapRemove(flags, i);
+  swapRemove(items, i);
+}
+
+void BodyStore::clear() {
+  x.clear();
+  y.clear();
+  vx.clear();
+  vy.clear();
+  centerX.clear();
+  centerY.clear();
+  halfWidth.clear();
+  halfHeight.clear();
+  flags.clear();
+  items.clear();
+  index.clear();
+}
+
+void BodyStore::setPosition(int i, const QPointF &position) {
+  x[i] = position.x();
+  y[i] = position.y();
+}
+
+QRectF BodyStore::sceneBounds(int i) const {
+  return QRectF(x.at(i) + centerX.at(i) - halfWidth.at(i),
+                y.at(i) + centerY.at(i) - halfHeight.at(i), 2 * halfWidth.at(i),
+                2 * halfHeight.at(i));
+}
@@ -0,0 +1,49 @@
+#ifndef BODYSTORE_H
+#define BODYSTORE_H
+
+#include <QGraphicsItemGroup>
+#include <QHash>
+#include <QList>
+#include <QRectF>
+#include <QVector>
+
+// Хранилище движущихся тел в виде структуры массивов.
+// Шаг физики проходит по плотным массивам координат и скоростей без
+// обращений к элементам сцены; элементы синхронизируются раз за кадр.
+// Принадлежность элемента к телам проверяется по хешу за O(1).
+class BodyStore {
+public:
+  enum Flag : quint8 {
+    Collided = 0x1 // Тело столкнулось на последнем шаге
+  };
+
+  int size() const { return items.size(); }
+  bool isEmpty() const { return items.isEmpty(); }
+
+  int add(QGraphicsItemGroup *item, const QPointF &position,
+          const QRectF &bounds, const QPointF &velocity);
+  void remove(int index); // На место удалённого переносится последнее тело
+  void clear();
+
+  int indexOf(const QGraphicsItem *item) const { return index.value(item, -1); }
+  bool contains(const QGraphicsItem *item) const { return index.contains(item); }
+  QGraphicsItemGroup *item(int i) const { return items.at(i); }
+  QList<QGraphicsItemGroup *> itemList() const { return items.toList(); }
+
+  QPointF position(int i) const { return QPointF(x.at(i), y.at(i)); }
+  void setPosition(int i, const QPointF &position);
+  QRectF sceneBounds(int i) const;
+
+  // Массивы открыты для линейного прохода в шаге физики
+  QVector<qreal> x, y;                  // pos() элемента
+  QVector<qreal> vx, vy;                // Скорость, пикс/с
+  QVector<qreal> centerX, centerY;      // Центр габаритов относительно pos()
+  QVector<qreal> halfWidth, halfHeight; // Полуразмеры габаритов
+  QVector<quint8> flags;
+
+private:
+  QVector<QGraphicsItemGroup *> items;
+  QHash<const QGraphicsItem *, int> index;
+};
+
+#endif // BODYSTORE_H
@@ -0,0 +1,253 @@
+#include "collisionworld.h"
+
+#include <QtMath>
+
+CollisionWorld::CollisionWorld(qreal cellSize)
+    : cellSize(cellSize), stamp(0) {}
+
+void CollisionWorld::setArea(const QRectF &area) { walls = area; }
+
+void CollisionWorld::clearObstacles() {
+  obstacles.clear();
+  obstacleGrid.clear();
+  visited.clear();
+  stamp = 0;
+}
+
+void CollisionWorld::addObstacle(const QRectF &bounds,
+                                 const QPainterPath &shape) {
+  obstacles.append({bounds, shape});
+  visited.append(0);
+  insert(obstacleGrid, bounds, obstacles.size() - 1);
+}
+
+int CollisionWorld::step(BodyStore &bodies, qreal dt) {
+  const int count = bodies.size();
+  int collisions = 0;
+
+  // Интегрирование - плотный проход по массивам без ветвлений
+  qreal *x = bodies.x.data();
+  qreal *y = bodies.y.data();
+  const qreal *vx = bodies.vx.constData();
+  const qreal *vy = bodies.vy.constData();
+  quint8 *flags = bodies.flags.data();
+  for (int i = 0; i < count; ++i) {
+    x[i] += vx[i] * dt;
+  }
+  for (int i = 0; i < count; ++i) {
+    y[i] += vy[i] * dt;
+  }
+  for (int i = 0; i < count; ++i) {
+    flags[i] &= ~BodyStore::Collided;
+  }
+
+  // Широкая фаза: раскладываем тела по ячейкам
+  if (bodyGrid.size() > 4 * count + 64) {
+    bodyGrid.clear(); // Слишком много пустых ячеек от прошлых шагов
+  } else {
+    for (auto it = bodyGrid.begin(); it != bodyGrid.end(); ++it) {
+      it.value().clear();
+    }
+  }
+  for (int i = 0; i < count; ++i) {
+    insert(bodyGrid, bodies.sceneBounds(i), i);
+  }
+
+  // Пары проверяются только внутри общих ячеек. Пара, попавшая в несколько
+  // ячеек, обрабатывается в той, где лежит угол пересечения габаритов
+  for (auto it = bodyGrid.constBegin(); it != bodyGrid.constEnd(); ++it) {
+    const QVector<int> &cell = it.value();
+    for (int i = 0; i < cell.size(); ++i) {
+      for (int j = i + 1; j < cell.size(); ++j) {
+        QRectF ra = bodies.sceneBounds(cell[i]);
+        QRectF rb = bodies.sceneBounds(cell[j]);
+        if (!ra.intersects(rb)) {
+          continue;
+        }
+        if (cellKey(cellOf(qMax(ra.left(), rb.left())),
+                    cellOf(qMax(ra.top(), rb.top()))) != it.key()) {
+          continue;
+        }
+        if (resolvePair(bodies, cell[i], cell[j])) {
+          ++collisions;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < count; ++i) {
+    if (resolveObstacles(bodies, i)) {
+      ++collisions;
+    }
+    if (resolveWalls(bodies, i)) {
+      ++collisions;
+    }
+  }
+  return collisions;
+}
+
+quint64 CollisionWorld::cellKey(int x, int y) {
+  return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+// Минимальный сдвиг, выталкивающий прямоугольник a из b по одной оси
+QPointF CollisionWorld::penetration(const QRectF &a, const QRectF &b) {
+  qreal toLeft = a.right() - b.left();
+  qreal toRight = b.right() - a.left();
+  qreal toTop = a.bottom() - b.top();
+  qreal toBottom = b.bottom() - a.top();
+
+  qreal dx = toLeft < toRight ? -toLeft : toRight;
+  qreal dy = toTop < toBottom ? -toTop : toBottom;
+  return qAbs(dx) < qAbs(dy) ? QPointF(dx, 0) : QPointF(0, dy);
+}
+
+int CollisionWorld::cellOf(qreal coordinate) const {
+  return qFloor(coordinate / cellSize);
+}
+
+void CollisionWorld::insert(Grid &grid, const QRectF &rect, int index) {
+  int left = cellOf(rect.left());
+  int right = cellOf(rect.right());
+  int top = cellOf(rect.top());
+  int bottom = cellOf(rect.bottom());
+  for (int x = left; x <= right; ++x) {
+    for (int y = top; y <= bottom; ++y) {
+      grid[cellKey(x, y)].append(index);
+    }
+  }
+}
+
+bool CollisionWorld::resolveWalls(BodyStore &bodies, int i) const {
+  if (walls.isEmpty()) {
+    return false;
+  }
+
+  QRectF rect = bodies.sceneBounds(i);
+  bool hit = false;
+
+  if (rect.left() < walls.left()) {
+    bodies.x[i] += walls.left() - rect.left();
+    bodies.vx[i] = qAbs(bodies.vx[i]);
+    hit = true;
+  } else if (rect.right() > walls.right()) {
+    bodies.x[i] -= rect.right() - walls.right();
+    bodies.vx[i] = -qAbs(bodies.vx[i]);
+    hit = true;
+  }
+
+  if (rect.top() < walls.top()) {
+    bodies.y[i] += walls.top() - rect.top();
+    bodies.vy[i] = qAbs(bodies.vy[i]);
+    hit = true;
+  } else if (rect.bottom() > walls.bottom()) {
+    bodies.y[i] -= rect.bottom() - walls.bottom();
+    bodies.vy[i] = -qAbs(bodies.vy[i]);
+    hit = true;
+  }
+
+  if (hit) {
+    bodies.flags[i] |= BodyStore::Collided;
+  }
+  return hit;
+}
+
+bool CollisionWorld::resolveObstacles(BodyStore &bodies, int i) {
+  if (obstacles.isEmpty()) {
+    return false;
+  }
+
+  QRectF rect = bodies.sceneBounds(i);
+  bool hit = false;
+  ++stamp;
+
+  int left = cellOf(rect.left());
+  int right = cellOf(rect.right());
+  int top = cellOf(rect.top());
+  int bottom = cellOf(rect.bottom());
+  for (int cx = left; cx <= right; ++cx) {
+    for (int cy = top; cy <= bottom; ++cy) {
+      auto cell = obstacleGrid.constFind(cellKey(cx, cy));
+      if (cell == obstacleGrid.constEnd()) {
+        continue;
+      }
+      for (int index : cell.value()) {
+        if (visited[index] == stamp) {
+          continue;
+        }
+        visited[index] = stamp;
+
+        // Узкая фаза: габариты, затем форма препятствия
+        const Obstacle &obstacle = obstacles.at(index);
+        if (!rect.intersects(obstacle.bounds) ||
+            (!obstacle.shape.isEmpty() && !obstacle.shape.intersects(rect))) {
+          continue;
+        }
+
+        // Для препятствия сложной формы проникновение считается по части
+        // формы, попавшей в тело, а не по габаритам: иначе тело, задевшее
+        // край круга, отбрасывается на всю глубину его описанного квадрата
+        QRectF contact = obstacle.bounds;
+        if (!obstacle.shape.isEmpty()) {
+          QPainterPath body;
+          body.addRect(rect);
+          contact = obstacle.shape.intersected(body).boundingRect();
+          if (contact.isEmpty()) {
+            continue;
+          }
+        }
+
+        // Выталкиваем тело по оси наименьшего проникновения и отражаем
+        // соответствующую составляющую скорости
+        QPointF push = penetration(rect, contact);
+        bodies.x[i] += push.x();
+        bodies.y[i] += push.y();
+        if (push.x() != 0) {
+          bodies.vx[i] = push.x() > 0 ? qAbs(bodies.vx[i]) : -qAbs(bodies.vx[i]);
+        } else {
+          bodies.vy[i] = push.y() > 0 ? qAbs(bodies.vy[i]) : -qAbs(bodies.vy[i]);
+        }
+        rect.translate(push);
+        hit = true;
+      }
+    }
+  }
+
+  if (hit) {
+    bodies.flags[i] |= BodyStore::Collided;
+  }
+  return hit;
+}
+
+bool CollisionWorld::resolvePair(BodyStore &bodies, int a, int b) {
+  // Проникновение по осям через расстояние между центрами и полуразмеры
+  qreal dx = (bodies.x[b] + bodies.centerX[b]) - (bodies.x[a] + bodies.centerX[a]);
+  qreal dy = (bodies.y[b] + bodies.centerY[b]) - (bodies.y[a] + bodies.centerY[a]);
+  qreal px = bodies.halfWidth[a] + bodies.halfWidth[b] - qAbs(dx);
+  qreal py = bodies.halfHeight[a] + bodies.halfHeight[b] - qAbs(dy);
+  if (px <= 0 || py <= 0) {
+    return false;
+  }
+
+  // Раздвигаем тела поровну по оси наименьшего проникновения; при сближении
+  // обмениваемся составляющими скорости (упругий удар равных масс)
+  if (px < py) {
+    qreal shift = (dx < 0 ? -px : px) / 2;
+    bodies.x[a] -= shift;
+    bodies.x[b] += shift;
+    if ((bodies.vx[a] - bodies.vx[b]) * shift > 0) {
+      qSwap(bodies.vx[a], bodies.vx[b]);
+    }
+  } else {
+    qreal shift = (dy < 0 ? -py : py) / 2;
+    bodies.y[a] -= shift;
+    bodies.y[b] += shift;
+    if ((bodies.vy[a] - bodies.vy[b]) * shift > 0) {
+      qSwap(bodies.vy[a], bodies.vy[b]);
+    }
+  }
+
+  bodies.flags[a] |= BodyStore::Collided;
+  bodies.flags[b] |= BodyStore::Collided;
+  return true;
+}
@@ -0,0 +1,56 @@
+#ifndef COLLISIONWORLD_H
+#define COLLISIONWORLD_H
+
+#include <QHash>
+#include <QPainterPath>
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+
+#include "bodystore.h"
+
+// Система столкновений на равномерной сетке (пространственном хеше).
+// Статические препятствия раскладываются по ячейкам один раз при
+// добавлении, движущиеся тела - на каждом шаге. Стоимость шага зависит
+// от числа тел и их соседей, а не от общего числа элементов сцены.
+class CollisionWorld {
+public:
+  explicit CollisionWorld(qreal cellSize = 128);
+
+  void setArea(const QRectF &area); // Область внутри стен
+  QRectF area() const { return walls; }
+
+  void clearObstacles(); // Начинает новый набор препятствий
+  void addObstacle(const QRectF &bounds, const QPainterPath &shape);
+
+  // Сдвигает тела на velocity * dt и разрешает столкновения.
+  // Возвращает число столкновений за шаг
+  int step(BodyStore &bodies, qreal dt);
+
+private:
+  struct Obstacle {
+    QRectF bounds;
+    QPainterPath shape; // Пустая форма - препятствие совпадает с габаритами
+  };
+  typedef QHash<quint64, QVector<int>> Grid;
+
+  static quint64 cellKey(int x, int y);
+  static QPointF penetration(const QRectF &a, const QRectF &b);
+  int cellOf(qreal coordinate) const;
+  void insert(Grid &grid, const QRectF &rect, int index);
+  bool resolveWalls(BodyStore &bodies, int i) const;
+  bool resolveObstacles(BodyStore &bodies, int i);
+  static bool resolvePair(BodyStore &bodies, int a, int b);
+
+  qreal cellSize;
+  QRectF walls;
+
+  QVector<Obstacle> obstacles;
+  Grid obstacleGrid;
+  QVector<int> visited; // Метки, чтобы не проверять препятствие дважды
+  int stamp;
+
+  Grid bodyGrid; // Ячейки сохраняются между шагами, чтобы не выделять память
+};
+
+#endif // COLLISIONWORLD_H
@@ -0,0 +1,102 @@
+#include "csvloader.h"
+
+#include <QFile>
+
+#include "csvparser.h"
+
+CsvLoader::CsvLoader(const QString &filePath, QObject *parent) : QObject(parent),
+                                                                 filePath(filePath),
+                                                                 cancelRequested(0)
+{
+    qRegisterMetaType<QVector<QStringList>>("QVector<QStringList>");
+}
+
+void CsvLoader::cancel()
+{
+    cancelRequested.storeRelease(1);
+}
+
+void CsvLoader::run()
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        emit failed(tr("Не удалось открыть CSV файл"));
+        return;
+    }
+
+    const qint64 totalSize = file.size();
+    qint64 processed = 0;
+    int lastPercent = -1;
+    bool anyRows = false;
+
+    CsvParser parser;
+    QVector<QStringList> batch;
+    batch.reserve(BatchRows);
+
+    bool firstChunk = true;
+    while (!file.atEnd())
+    {
+        if (cancelRequested.loadAcquire())
+        {
+            emit canceled();
+            return;
+        }
+
+        QByteArray chunk = file.read(ChunkSize);
+        if (chunk.isEmpty())
+        {
+            emit failed(tr("Ошибка чтения CSV файла"));
+            return;
+        }
+        processed += chunk.size();
+
+        // Метка порядка байт пропускается, разделитель определяется по началу файла
+        int offset = 0;
+        if (firstChunk)
+        {
+            firstChunk = false;
+            offset = CsvParser::bomLength(chunk.constData(), chunk.size());
+            const char delimiter = CsvParser::detectDelimiter(chunk.constData() + offset, chunk.size() - offset,
+                                                              file.atEnd());
+            parser.setDelimiter(delimiter);
+            emit delimiterDetected(delimiter);
+        }
+
+        // Запись, не закончившаяся в этом блоке, продолжится в следующем
+        parser.feed(chunk.constData() + offset, chunk.size() - offset, batch);
+        // Блок коротких строк даёт десятки тысяч записей: GUI получает их
+        // пачками не больше BatchRows, остаток ждёт следующего блока
+        if (batch.size() >= BatchRows)
+        {
+            anyRows = true;
+            int sent = 0;
+            for (; batch.size() - sent >= BatchRows; sent += BatchRows)
+            {
+                emit rowsReady(batch.mid(sent, BatchRows));
+            }
+            batch.remove(0, sent);
+        }
+
+        int percent = totalSize > 0 ? static_cast<int>(processed * 100 / totalSize) : 100;
+        if (percent != lastPercent)
+        {
+            lastPercent = percent;
+            emit progress(percent);
+        }
+    }
+
+    parser.finish(batch);
+    if (!anyRows && batch.isEmpty())
+    {
+        emit failed(tr("Файл CSV пуст или имеет неправильный формат"));
+        return;
+    }
+
+    if (!batch.isEmpty())
+    {
+        emit rowsReady(batch);
+    }
+    emit progress(100);
+    emit finished();
+}
@@ -0,0 +1,43 @@
+#ifndef CSVLOADER_H
+#define CSVLOADER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QStringList>
+#include <QVector>
+
+// Потоковый загрузчик CSV.
+// Читает файл блоками фиксированного размера в рабочем потоке и отдаёт
+// разобранные строки пачками, не держа весь файл в памяти. Строки разной
+// длины допускаются: таблица расширяется до самой длинной.
+class CsvLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CsvLoader(const QString &filePath, QObject *parent = nullptr);
+
+    static const qint64 ChunkSize = 1 << 20; // Размер одного чтения с диска (1 МиБ)
+    static const int BatchRows = 4096;       // Количество строк в одной пачке
+
+    // Потокобезопасна: может вызываться из GUI-потока во время загрузки
+    void cancel();
+
+public slots:
+    void run();
+
+signals:
+    void rowsReady(const QVector<QStringList> &rows);
+    // Разделитель, найденный по началу файла, до первой пачки строк
+    void delimiterDetected(char delimiter);
+    void progress(int percent);
+    void finished();
+    void canceled();
+    void failed(const QString &message);
+
+private:
+    QString filePath;
+    QAtomicInt cancelRequested;
+};
+
+#endif // CSVLOADER_H
@@ -0,0 +1,230 @@
+#include "csvparser.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Первый разделитель, кавычка или перевод строки в [p, end), иначе end
+static const char *findSpecial(const char *p, const char *end, char delimiter)
+{
+#ifdef __SSE2__
+    const __m128i delimiters = _mm_set1_epi8(delimiter);
+    const __m128i quotes = _mm_set1_epi8('"');
+    const __m128i lineFeeds = _mm_set1_epi8('\n');
+    const __m128i carriageReturns = _mm_set1_epi8('\r');
+    for (; p + 16 <= end; p += 16)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, delimiters), _mm_cmpeq_epi8(block, quotes)),
+                                             _mm_or_si128(_mm_cmpeq_epi8(block, lineFeeds), _mm_cmpeq_epi8(block, carriageReturns)));
+        const quint32 mask = quint32(_mm_movemask_epi8(special));
+        if (mask)
+        {
+            return p + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+    for (; p < end; ++p)
+    {
+        if (*p == delimiter || *p == '"' || *p == '\n' || *p == '\r')
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+CsvParser::CsvParser(char delimiter) : delimiter(delimiter),
+                                       state(Unquoted),
+                                       quotedField(false),
+                                       skipLineFeed(false),
+                                       lastWidth(0)
+{
+    field.reserve(256); // Ёмкость сохраняется между полями
+}
+
+int CsvParser::bomLength(const char *data, int size)
+{
+    return size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;
+}
+
+char CsvParser::detectDelimiter(const char *data, int size, bool atEnd)
+{
+    static const char candidates[] = {',', ';', '\t', '|'};
+    static const int SampleLines = 32;
+
+    // Образец, обрезанный по SampleSize, кончается посреди строки
+    const bool wholeFile = atEnd && size <= SampleSize;
+    size = qMin(size, SampleSize);
+    char best = ',';
+    int bestScore = 0;
+    for (char candidate : candidates)
+    {
+        // Количество разделителей вне кавычек в каждой строке образца
+        QVector<int> counts;
+        int count = 0;
+        bool quoted = false;
+        bool lineStarted = false;
+        for (int i = 0; i < size && counts.size() < SampleLines; ++i)
+        {
+            const char ch = data[i];
+            lineStarted = ch != '\n' || quoted;
+            if (ch == '"')
+            {
+                quoted = !quoted;
+            }
+            else if (!quoted && ch == candidate)
+            {
+                ++count;
+            }
+            else if (!quoted && ch == '\n')
+            {
+                counts.append(count);
+                count = 0;
+            }
+        }
+        // Последняя строка файла без перевода строки, например "a;b;c"
+        if (wholeFile && lineStarted && !quoted && counts.size() < SampleLines)
+        {
+            counts.append(count);
+        }
+        if (counts.isEmpty() || counts.first() == 0)
+        {
+            continue;
+        }
+
+        // Строки с тем же числом полей, что и первая, в пользу частого разделителя
+        const int consistent = int(std::count(counts.constBegin(), counts.constEnd(), counts.first()));
+        const int score = consistent * 1024 + qMin(counts.first(), 1023);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+void CsvParser::feed(const char *data, int size, QVector<QStringList> &rows)
+{
+    const char *p = data;
+    const char *end = data + size;
+    while (p < end)
+    {
+        if (skipLineFeed)
+        {
+            skipLineFeed = false;
+            if (*p == '\n')
+            {
+                ++p;
+                continue;
+            }
+        }
+
+        switch (state)
+        {
+        case Unquoted:
+        {
+            const char *special = findSpecial(p, end, delimiter);
+            field.append(p, int(special - p));
+            p = special;
+            if (p == end)
+            {
+                return;
+            }
+
+            const char ch = *p++;
+            if (ch == delimiter)
+            {
+                endField();
+            }
+            else if (ch == '"')
+            {
+                if (field.isEmpty() && !quotedField)
+                {
+                    quotedField = true;
+                    state = Quoted;
+                }
+                else
+                {
+                    field.append('"'); // Кавычка посреди поля без кавычек - обычный символ
+                }
+            }
+            else
+            {
+                // '\r\n', '\n' или одиночный '\r'
+                if (ch == '\r')
+                {
+                    skipLineFeed = true;
+                }
+                endRecord(rows);
+            }
+            break;
+        }
+        case Quoted:
+        {
+            const char *quote = static_cast<const char *>(std::memchr(p, '"', size_t(end - p)));
+            if (!quote)
+            {
+                field.append(p, int(end - p));
+                return;
+            }
+            field.append(p, int(quote - p));
+            p = quote + 1;
+            state = QuoteInQuoted;
+            break;
+        }
+        case QuoteInQuoted:
+            if (*p == '"')
+            {
+                field.append('"');
+                ++p;
+                state = Quoted;
+            }
+            else
+            {
+                state = Unquoted; // Поле закрыто, дальше ждём разделитель
+            }
+            break;
+        }
+    }
+}
+
+void CsvParser::finish(QVector<QStringList> &rows)
+{
+    // Незакрытая кавычка в конце файла: поле берётся как есть
+    if (!record.isEmpty() || !field.isEmpty() || quotedField)
+    {
+        endRecord(rows);
+    }
+    state = Unquoted;
+    skipLineFeed = false;
+}
+
+void CsvParser::endField()
+{
+    record.append(QString::fromUtf8(field));
+    field.resize(0);
+    quotedField = false;
+    state = Unquoted;
+}
+
+void CsvParser::endRecord(QVector<QStringList> &rows)
+{
+    // Пустые строки пропускаются
+    if (record.isEmpty() && field.isEmpty() && !quotedField)
+    {
+        return;
+    }
+
+    endField();
+    lastWidth = record.size();
+    rows.append(record);
+    record = QStringList();
+    record.reserve(lastWidth);
+}
@@ -0,0 +1,52 @@
+#ifndef CSVPARSER_H
+#define CSVPARSER_H
+
+#include <QByteArray>
+#include <QStringList>
+#include <QVector>
+
+// Потоковый разбор CSV по RFC 4180.
+// Работает с сырыми байтами UTF-8: спецсимволы (разделитель, кавычка, перевод
+// строки) ищутся по 16 байт за раз, обычный текст копируется в поле целыми
+// участками, а в строку декодируется только готовое поле. Запись может
+// продолжаться через границу блоков, в том числе внутри кавычек.
+class CsvParser
+{
+public:
+    static const int SampleSize = 64 * 1024; // Сколько байт просматривает определение разделителя
+
+    explicit CsvParser(char delimiter = ',');
+    void setDelimiter(char newDelimiter) { delimiter = newDelimiter; }
+
+    // Разделитель из ',', ';', '\t', '|', дающий одинаковое число полей в строках образца.
+    // atEnd - данные доходят до конца файла, и последняя строка без перевода строки тоже считается
+    static char detectDelimiter(const char *data, int size, bool atEnd);
+    // Длина метки порядка байт UTF-8 в начале данных (0 или 3)
+    static int bomLength(const char *data, int size);
+
+    // Завершённые записи добавляются в rows, незавершённая ждёт следующего блока
+    void feed(const char *data, int size, QVector<QStringList> &rows);
+    // Последняя запись файла может не заканчиваться переводом строки
+    void finish(QVector<QStringList> &rows);
+
+private:
+    enum State
+    {
+        Unquoted,
+        Quoted,
+        QuoteInQuoted // Кавычка внутри кавычек: закрывающая или первая из пары ""
+    };
+
+    void endField();
+    void endRecord(QVector<QStringList> &rows);
+
+    char delimiter;
+    State state;
+    bool quotedField;  // Текущее поле начиналось с кавычки
+    bool skipLineFeed; // Предыдущий блок закончился на '\r'
+    QByteArray field;  // Байты текущего поля
+    QStringList record;
+    int lastWidth;     // Число полей предыдущей записи, для резервирования
+};
+
+#endif // CSVPARSER_H
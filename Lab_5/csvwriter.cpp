@@ -0,0 +1,148 @@
+#include "csvwriter.h"
+
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+// Дописывает UTF-16 как UTF-8; одиночные суррогаты заменяются на U+FFFD
+static void appendUtf8(QByteArray &out, const QChar *text, int length)
+{
+    for (int i = 0; i < length; ++i)
+    {
+        uint code = text[i].unicode();
+        if (code < 0x80)
+        {
+            out.append(char(code));
+            continue;
+        }
+        if (QChar::isHighSurrogate(code) && i + 1 < length && text[i + 1].isLowSurrogate())
+        {
+            code = QChar::surrogateToUcs4(ushort(code), text[++i].unicode());
+        }
+        else if (QChar::isSurrogate(code))
+        {
+            code = QChar::ReplacementCharacter;
+        }
+
+        if (code < 0x800)
+        {
+            out.append(char(0xc0 | (code >> 6)));
+        }
+        else if (code < 0x10000)
+        {
+            out.append(char(0xe0 | (code >> 12)));
+            out.append(char(0x80 | ((code >> 6) & 0x3f)));
+        }
+        else
+        {
+            out.append(char(0xf0 | (code >> 18)));
+            out.append(char(0x80 | ((code >> 12) & 0x3f)));
+            out.append(char(0x80 | ((code >> 6) & 0x3f)));
+        }
+        out.append(char(0x80 | (code & 0x3f)));
+    }
+}
+
+CsvWriter::CsvWriter(const QVector<TableColumn> &columns, int rows, char delimiter) : columns(columns),
+                                                                                      rows(rows),
+                                                                                      delimiter(delimiter)
+{
+}
+
+void CsvWriter::appendField(QByteArray &out, const QStringRef &text, char delimiter)
+{
+    const QChar *data = text.unicode();
+    const int length = text.size();
+
+    bool quote = false;
+    for (int i = 0; i < length && !quote; ++i)
+    {
+        const ushort ch = data[i].unicode();
+        quote = ch == ushort(delimiter) || ch == '"' || ch == '\r' || ch == '\n';
+    }
+    if (!quote)
+    {
+        appendUtf8(out, data, length);
+        return;
+    }
+
+    // Кавычки внутри поля удваиваются
+    out.append('"');
+    int start = 0;
+    for (int i = 0; i < length; ++i)
+    {
+        if (data[i] == QLatin1Char('"'))
+        {
+            appendUtf8(out, data + start, i + 1 - start);
+            out.append('"');
+            start = i + 1;
+        }
+    }
+    appendUtf8(out, data + start, length - start);
+    out.append('"');
+}
+
+void CsvWriter::formatBlock(int firstRow, QByteArray &out) const
+{
+    out.resize(0); // Ёмкость зарезервирована и сохраняется между блоками
+    const int lastRow = qMin(rows, firstRow + BlockRows);
+    for (int i = firstRow; i < lastRow; ++i)
+    {
+        for (int j = 0; j < columns.size(); ++j)
+        {
+            if (j > 0)
+            {
+                out.append(delimiter);
+            }
+            const TableColumn &column = columns.at(j);
+            if (column.type() == TableColumn::String)
+            {
+                appendField(out, column.textRef(i), delimiter);
+            }
+            else if (!column.isEmpty(i))
+            {
+                // Числа и даты форматируются из значений только при записи
+                const QString text = column.text(i);
+                appendField(out, QStringRef(&text), delimiter);
+            }
+        }
+        out.append("\r\n", 2);
+    }
+}
+
+bool CsvWriter::write(QIODevice *device, const std::function<void(qint64, qint64)> &progress)
+{
+    // Одновременно в памяти столько блоков, сколько форматируется параллельно
+    const int window = qMax(1, QThread::idealThreadCount()) * 2;
+    QVector<QByteArray> buffers(window);
+    for (QByteArray &buffer : buffers)
+    {
+        buffer.reserve(BlockRows * 64);
+    }
+    QByteArray *output = buffers.data(); // Без отсоединения данных внутри параллельных задач
+
+    QVector<int> blocks;
+    for (int firstRow = 0; firstRow < rows; firstRow += BlockRows * window)
+    {
+        blocks.clear();
+        for (int slot = 0; slot < window && firstRow + slot * BlockRows < rows; ++slot)
+        {
+            blocks.append(slot);
+        }
+
+        QtConcurrent::blockingMap(blocks, [&](int slot)
+                                  { formatBlock(firstRow + slot * BlockRows, output[slot]); });
+
+        for (int slot : blocks)
+        {
+            if (device->write(buffers.at(slot)) != buffers.at(slot).size())
+            {
+                return false;
+            }
+        }
+        if (progress)
+        {
+            progress(qMin<qint64>(rows, qint64(firstRow) + qint64(BlockRows) * window), rows);
+        }
+    }
+    return true;
+}
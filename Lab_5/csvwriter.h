@@ -0,0 +1,38 @@
+#ifndef CSVWRITER_H
+#define CSVWRITER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QStringRef>
+#include <QVector>
+
+#include <functional>
+
+#include "tablecolumn.h"
+
+// Запись таблицы в CSV по RFC 4180 с разделителем исходного файла.
+// Текст берётся прямо из колоночного хранилища и кодируется в UTF-8 без
+// промежуточных строк. Блоки по BlockRows строк форматируются параллельно
+// в переиспользуемые буферы и пишутся на диск по порядку.
+class CsvWriter
+{
+public:
+    static const int BlockRows = 4096;
+
+    CsvWriter(const QVector<TableColumn> &columns, int rows, char delimiter = ',');
+
+    // progress(записано строк, всего строк) вызывается после каждой порции блоков
+    bool write(QIODevice *device, const std::function<void(qint64, qint64)> &progress = nullptr);
+
+    // Поле в кавычках, только если в нём есть разделитель, кавычка или перевод строки
+    static void appendField(QByteArray &out, const QStringRef &text, char delimiter = ',');
+
+private:
+    void formatBlock(int firstRow, QByteArray &out) const;
+
+    const QVector<TableColumn> &columns;
+    int rows;
+    char delimiter;
+};
+
+#endif // CSVWRITER_H
@@ -0,0 +1,640 @@
+#include "editjournal.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QUuid>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "richtextformat.h"
+
+static const char *JournalDirectory = "../Visual_Lab5/Lab_5/journal";
+static const int RecordHeaderSize = 5; // Тип записи и длина содержимого
+
+// Сжатый журнал пишется рядом и заменяет прежний только целиком
+static QString compactedPath(const QString &journal)
+{
+    return journal + ".compact";
+}
+
+// Довершает замену журнала, прерванную аварийным завершением. Сжатая копия
+// записывается полностью до удаления прежнего журнала: если прежний цел, копия
+// могла быть не дописана и удаляется, иначе она и есть журнал
+static void settle(const QString &journal)
+{
+    const QString compacted = compactedPath(journal);
+    if (!QFile::exists(compacted))
+    {
+        return;
+    }
+    if (QFile::exists(journal))
+    {
+        QFile::remove(compacted);
+    }
+    else
+    {
+        QFile::rename(compacted, journal);
+    }
+}
+
+// Журналом пользуется открытый документ, а не остаток аварийного завершения
+static bool inUse(const QString &journal)
+{
+    QLockFile lock(journal + ".lock");
+    lock.setStaleLockTime(0); // Блокировка умершего процесса снимается и так
+    return !lock.tryLock(0);
+}
+
+// Вставленный участок документа: фрагменты текста с форматами символов,
+// а на границах блоков - пустой текст с форматом нового блока
+static void captureRange(const QTextDocument *document, int from, int to,
+                         QStringList &texts, QVector<QTextFormat> &formats)
+{
+    for (QTextBlock block = document->findBlock(from); block.isValid() && block.position() <= to; block = block.next())
+    {
+        if (block.position() > from)
+        {
+            QTextBlockFormat blockFormat = block.blockFormat();
+            blockFormat.clearProperty(QTextFormat::ObjectIndex); // Списки при воспроизведении не восстанавливаются
+            texts << QString();
+            formats << blockFormat;
+        }
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it)
+        {
+            const QTextFragment fragment = it.fragment();
+            const int start = qMax(from, fragment.position());
+            const int end = qMin(to, fragment.position() + fragment.length());
+            if (start < end)
+            {
+                texts << fragment.text().mid(start - fragment.position(), end - start);
+                formats << fragment.charFormat();
+            }
+        }
+    }
+}
+
+static bool applyDelta(const QByteArray &payload, QTextDocument *document)
+{
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_12);
+    qint32 position, removed;
+    QStringList texts;
+    QVector<QTextFormat> formats;
+    in >> position >> removed >> texts >> formats;
+
+    const int length = document->characterCount() - 1;
+    if (in.status() != QDataStream::Ok || position < 0 || position > length || removed < 0 ||
+        texts.size() != formats.size())
+    {
+        return false;
+    }
+
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(qMin(position + removed, length), QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+    for (int i = 0; i < texts.size(); ++i)
+    {
+        if (formats.at(i).isBlockFormat())
+        {
+            cursor.insertBlock(formats.at(i).toBlockFormat());
+        }
+        else
+        {
+            cursor.insertText(texts.at(i), formats.at(i).toCharFormat());
+        }
+    }
+    return true;
+}
+
+EditJournal::EditJournal(QTextDocument *document, const QString &filePath) : QObject(document),
+                                                                             document(document),
+                                                                             replaying(false),
+                                                                             checkpointOffset(0),
+                                                                             baseSaved(false),
+                                                                             markCheckpointOffset(0),
+                                                                             markOffset(-1),
+                                                                             deltasSinceCheckpoint(0),
+                                                                             bytesSinceCheckpoint(0),
+                                                                             saveOffset(-1),
+                                                                             savedOffset(-1),
+                                                                             snapshot(nullptr),
+                                                                             compactionType(Checkpoint),
+                                                                             compactionFrom(-1)
+{
+    connect(&compactionWatcher, &QFutureWatcher<Compaction>::finished, this, &EditJournal::finishCompaction);
+
+    QDir journalDir(JournalDirectory);
+    if (!journalDir.exists() && !journalDir.mkpath("."))
+    {
+        qDebug() << "Unable to create directory: " << journalDir.absolutePath();
+    }
+    file.setFileName(lockJournal(filePath, lock));
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        qDebug() << "Unable to open journal: " << file.fileName();
+        return;
+    }
+
+    // Документ, только что прочитанный из файла, совпадает с ним: основой
+    // служит отметка сохранения, и сериализовать его не нужно. Контрольная
+    // точка пишется для восстановленного документа и для нового, ещё пустого
+    if (!filePath.isEmpty() && !document->isModified())
+    {
+        baseSaved = true;
+        writeRecord(Saved, QByteArray());
+    }
+    else
+    {
+        writeCheckpoint();
+    }
+    connect(document, &QTextDocument::contentsChange, this, &EditJournal::onContentsChange);
+}
+
+EditJournal::~EditJournal()
+{
+    compactionWatcher.waitForFinished();
+    delete snapshot;
+
+    // Штатное закрытие документа: восстанавливать нечего
+    if (file.isOpen())
+    {
+        file.close();
+        file.remove();
+        QFile::remove(compactedPath(file.fileName()));
+    }
+}
+
+EditJournal *EditJournal::forDocument(QTextDocument *document, const QString &filePath)
+{
+    EditJournal *journal = document->findChild<EditJournal *>(QString(), Qt::FindDirectChildrenOnly);
+    return journal ? journal : new EditJournal(document, filePath);
+}
+
+QString EditJournal::journalPath(const QString &filePath)
+{
+    QDir journalDir(JournalDirectory);
+    if (filePath.isEmpty())
+    {
+        // Новому документу без имени восстанавливать нечего: имя просто уникально
+        return journalDir.absoluteFilePath("untitled-" + QUuid::createUuid().toString(QUuid::WithoutBraces) + ".journal");
+    }
+    const QByteArray key = QFileInfo(filePath).absoluteFilePath().toUtf8();
+    return journalDir.absoluteFilePath(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex() + ".journal");
+}
+
+QString EditJournal::lockJournal(const QString &filePath, QScopedPointer<QLockFile> &lock)
+{
+    // Журнал по имени файла достаётся первому документу; остальным восстанавливать нечего
+    if (!filePath.isEmpty())
+    {
+        const QString path = journalPath(filePath);
+        lock.reset(new QLockFile(path + ".lock"));
+        lock->setStaleLockTime(0);
+        if (lock->tryLock(0))
+        {
+            return path;
+        }
+        lock.reset();
+    }
+    return journalPath(QString());
+}
+
+bool EditJournal::hasJournal(const QString &filePath)
+{
+    if (inUse(journalPath(filePath)))
+    {
+        return false;
+    }
+    settle(journalPath(filePath));
+    QFile journal(journalPath(filePath));
+    if (!journal.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    // Правки не сохранены, если основа - контрольная точка или после отметки сохранения есть дельты
+    qint64 base;
+    quint8 baseType;
+    int deltas;
+    scan(journal, base, baseType, deltas);
+    return base >= 0 && (baseType == Checkpoint || deltas > 0);
+}
+
+void EditJournal::discard(const QString &filePath)
+{
+    if (inUse(journalPath(filePath)))
+    {
+        return;
+    }
+    QFile::remove(journalPath(filePath));
+    QFile::remove(compactedPath(journalPath(filePath)));
+}
+
+bool EditJournal::recover(QTextDocument *document, const QString &filePath)
+{
+    if (inUse(journalPath(filePath)))
+    {
+        return false;
+    }
+    settle(journalPath(filePath));
+    QFile journal(journalPath(filePath));
+    if (!journal.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    // От отметки сохранения дельты применяются к документу, прочитанному из файла
+    qint64 base;
+    quint8 baseType;
+    int deltas;
+    const qint64 end = scan(journal, base, baseType, deltas);
+    return base >= 0 && replay(journal, base, end, document);
+}
+
+qint64 EditJournal::scan(QFile &journal, qint64 &base, quint8 &baseType, int &deltasAfterBase)
+{
+    // Ищем последнюю основу; недописанная запись в конце отбрасывается
+    base = -1;
+    baseType = 0;
+    deltasAfterBase = 0;
+    qint64 offset = 0;
+    while (offset + RecordHeaderSize <= journal.size())
+    {
+        journal.seek(offset);
+        QDataStream in(journal.read(RecordHeaderSize));
+        quint8 type;
+        quint32 size;
+        in >> type >> size;
+        if (offset + RecordHeaderSize + size > journal.size())
+        {
+            break;
+        }
+        if (type == Checkpoint || type == Saved)
+        {
+            base = offset;
+            baseType = type;
+            deltasAfterBase = 0;
+        }
+        else if (type == Delta)
+        {
+            ++deltasAfterBase;
+        }
+        offset += RecordHeaderSize + size;
+    }
+    return offset;
+}
+
+bool EditJournal::replay(QFile &file, qint64 from, qint64 to, QTextDocument *document)
+{
+    const bool undoRedo = document->isUndoRedoEnabled();
+    document->setUndoRedoEnabled(false);
+
+    bool ok = true;
+    for (qint64 offset = from; ok && offset + RecordHeaderSize <= to;)
+    {
+        file.seek(offset);
+        QDataStream header(file.read(RecordHeaderSize));
+        quint8 type;
+        quint32 size;
+        header >> type >> size;
+        const QByteArray payload = file.read(size);
+        if (payload.size() != int(size))
+        {
+            ok = false;
+            break;
+        }
+
+        if (type == Checkpoint)
+        {
+            QDataStream in(payload);
+            in.setVersion(QDataStream::Qt_5_12);
+            ok = RichTextFormat::readDocument(in, document);
+        }
+        else if (type == Delta)
+        {
+            ok = applyDelta(payload, document);
+        }
+        offset += RecordHeaderSize + size;
+    }
+
+    document->setUndoRedoEnabled(undoRedo);
+    return ok;
+}
+
+void EditJournal::setFilePath(const QString &filePath)
+{
+    if (!file.isOpen() || journalPath(filePath) == file.fileName())
+    {
+        return;
+    }
+
+    // Рабочий поток читает журнал по прежнему имени: его копия отбрасывается
+    compactionWatcher.waitForFinished();
+    dropCompaction();
+    QFile::remove(compactedPath(file.fileName()));
+
+    // Если новый файл открыт в другой вкладке, журнал переезжает под уникальное имя
+    QScopedPointer<QLockFile> newLock;
+    const QString newPath = lockJournal(filePath, newLock);
+    QFile::remove(newPath);
+    file.rename(newPath); // Закрывает файл
+    lock.swap(newLock);
+    if (!file.open(QIODevice::ReadWrite))
+    {
+        qDebug() << "Unable to open journal: " << newPath;
+    }
+}
+
+void EditJournal::saveStarted()
+{
+    saveOffset = file.isOpen() ? file.size() : -1;
+}
+
+void EditJournal::saveCommitted()
+{
+    // Правки до снимка теперь в файле: журнал начинается с отметки сохранения.
+    // Если журнал уже сжимается, следующее сжатие начнётся по окончании текущего
+    if (saveOffset >= 0)
+    {
+        savedOffset = saveOffset;
+    }
+    saveOffset = -1;
+    if (savedOffset >= 0 && file.isOpen() && !compactionWatcher.isRunning())
+    {
+        startCompaction(Saved, savedOffset);
+        savedOffset = -1;
+    }
+}
+
+void EditJournal::markClear()
+{
+    // Отмена очистки воспроизводит журнал от основы, а документ на момент
+    // отметки сохранения в журнале не записан. Перед явной очисткой
+    // документ один раз сериализуется, чтобы основой была контрольная точка.
+    // Сжатие, начатое до отметки, не знает о ней и отбрасывается
+    dropCompaction();
+    if (baseSaved)
+    {
+        writeCheckpoint();
+    }
+    markCheckpointOffset = checkpointOffset;
+    markOffset = file.size();
+    writeRecord(Mark, QByteArray());
+}
+
+bool EditJournal::undoClear()
+{
+    if (markOffset < 0)
+    {
+        return false;
+    }
+
+    // Документ на момент отметки - последняя контрольная точка перед ней и дельты до неё
+    replaying = true;
+    const bool ok = replay(file, markCheckpointOffset, markOffset, document);
+    replaying = false;
+
+    // Воспроизведение не пишет дельт: журнал снова описывает документ только с новой основы
+    markOffset = -1;
+    dropCompaction();
+    writeCheckpoint();
+    return ok;
+}
+
+void EditJournal::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if (replaying || !file.isOpen())
+    {
+        return;
+    }
+
+    const int end = qMin(position + charsAdded, document->characterCount() - 1);
+    QStringList texts;
+    QVector<QTextFormat> formats;
+    captureRange(document, position, end, texts, formats);
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << qint32(position) << qint32(charsRemoved) << texts << formats;
+    writeRecord(Delta, payload);
+
+    ++deltasSinceCheckpoint;
+    bytesSinceCheckpoint += payload.size();
+    if (deltasSinceCheckpoint >= CheckpointDeltas || bytesSinceCheckpoint >= CheckpointBytes)
+    {
+        startCheckpoint();
+    }
+}
+
+QByteArray EditJournal::record(RecordType type, const QByteArray &payload)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out << quint8(type) << quint32(payload.size());
+    bytes.append(payload);
+    return bytes;
+}
+
+QByteArray EditJournal::serialize(const QTextDocument *document)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    RichTextFormat::writeDocument(out, document);
+    return payload;
+}
+
+void EditJournal::writeRecord(RecordType type, const QByteArray &payload)
+{
+    file.seek(file.size());
+    file.write(record(type, payload));
+    file.flush();
+}
+
+void EditJournal::writeCheckpoint()
+{
+    // Контрольная точка дописывается в конец и сразу становится основой;
+    // записи перед ней уберёт следующее сжатие
+    deltasSinceCheckpoint = 0;
+    bytesSinceCheckpoint = 0;
+    checkpointOffset = file.size();
+    baseSaved = false;
+    writeRecord(Checkpoint, serialize(document));
+}
+
+void EditJournal::startCheckpoint()
+{
+    if (compactionWatcher.isRunning())
+    {
+        return; // Журнал ещё сжимается: точка будет построена на следующей дельте после него
+    }
+    deltasSinceCheckpoint = 0;
+    bytesSinceCheckpoint = 0;
+    startCompaction(Checkpoint, file.size());
+}
+
+void EditJournal::startCompaction(RecordType type, qint64 from)
+{
+    // Если очистку ещё можно отменить, участок от её контрольной точки до
+    // отметки (или до новой основы, если отметка позже) сохраняется
+    const bool keep = markOffset >= 0 && markCheckpointOffset < from;
+    const qint64 keptFrom = keep ? markCheckpointOffset : 0;
+    const qint64 keptTo = keep ? qMin(markOffset + RecordHeaderSize, from) : 0;
+
+    // В потоке GUI только копируется документ; сериализация и запись сжатого
+    // журнала идут в рабочем потоке
+    compactionType = type;
+    compactionFrom = from;
+    snapshot = type == Checkpoint ? document->clone() : nullptr;
+    const QTextDocument *copy = snapshot;
+    const QString journal = file.fileName();
+    compactionWatcher.setFuture(QtConcurrent::run([journal, keptFrom, keptTo, type, copy, from]()
+                                                  { return writeCompacted(journal, keptFrom, keptTo, type, copy, from); }));
+}
+
+EditJournal::Compaction EditJournal::writeCompacted(const QString &journal, qint64 keptFrom, qint64 keptTo,
+                                                    RecordType type, const QTextDocument *document, qint64 from)
+{
+    Compaction result;
+    result.journal = journal;
+    result.ok = false;
+    result.keptFrom = keptFrom;
+    result.kept = 0;
+    result.prefix = 0;
+    result.copied = from;
+
+    // Поток GUI тем временем только дописывает записи в конец: переносятся
+    // записанные целиком, остальные он допишет в копию сам
+    QFile source(journal);
+    if (!source.open(QIODevice::ReadOnly))
+    {
+        return result;
+    }
+    source.seek(keptFrom);
+    const QByteArray kept = source.read(keptTo - keptFrom);
+    const QByteArray base = record(type, document ? serialize(document) : QByteArray());
+
+    qint64 end = from;
+    const qint64 size = source.size();
+    while (end + RecordHeaderSize <= size)
+    {
+        source.seek(end);
+        QDataStream in(source.read(RecordHeaderSize));
+        quint8 recordType;
+        quint32 recordSize;
+        in >> recordType >> recordSize;
+        if (end + RecordHeaderSize + recordSize > size)
+        {
+            break;
+        }
+        end += RecordHeaderSize + recordSize;
+    }
+    source.seek(from);
+    const QByteArray records = source.read(end - from);
+
+    // Прежний журнал не трогается, пока сжатая копия не записана на диск целиком
+    QSaveFile compacted(compactedPath(journal));
+    if (!compacted.open(QIODevice::WriteOnly) || compacted.write(kept) != kept.size() ||
+        compacted.write(base) != base.size() || compacted.write(records) != records.size() || !compacted.commit())
+    {
+        qDebug() << "Unable to compact journal: " << journal;
+        return result;
+    }
+    result.ok = true;
+    result.kept = kept.size();
+    result.prefix = kept.size() + base.size();
+    result.copied = end;
+    return result;
+}
+
+void EditJournal::finishCompaction()
+{
+    delete snapshot;
+    snapshot = nullptr;
+
+    const Compaction result = compactionWatcher.result();
+    const qint64 from = compactionFrom;
+    compactionFrom = -1;
+    if (from < 0 || !result.ok || !file.isOpen() || !replaceJournal(result))
+    {
+        QFile::remove(compactedPath(result.journal));
+    }
+    else
+    {
+        // Смещения записей после from сдвигаются вслед за ними, участок очистки
+        // переезжает в начало, остальные более ранние записи больше не существуют
+        const qint64 shift = result.prefix - from;
+        if (markOffset >= 0)
+        {
+            markOffset = markOffset < from ? markOffset - result.keptFrom : markOffset + shift;
+            markCheckpointOffset = markCheckpointOffset < from ? markCheckpointOffset - result.keptFrom
+                                                               : markCheckpointOffset + shift;
+        }
+        saveOffset = saveOffset >= from ? saveOffset + shift : -1;
+        savedOffset = savedOffset >= from ? savedOffset + shift : -1;
+
+        // Контрольная точка, дописанная после from, остаётся последней основой
+        if (checkpointOffset >= from)
+        {
+            checkpointOffset += shift;
+        }
+        else
+        {
+            checkpointOffset = result.kept;
+            baseSaved = compactionType == Saved;
+        }
+    }
+
+    if (savedOffset >= 0 && file.isOpen())
+    {
+        startCompaction(Saved, savedOffset);
+        savedOffset = -1;
+    }
+}
+
+void EditJournal::dropCompaction()
+{
+    // Смещения, от которых считалось сжатие, поменялись: результат отбрасывается,
+    // а несостоявшееся сжатие до отметки сохранения будет начато заново
+    if (compactionFrom >= 0 && compactionType == Saved && savedOffset < 0)
+    {
+        savedOffset = compactionFrom;
+    }
+    compactionFrom = -1;
+}
+
+bool EditJournal::replaceJournal(const Compaction &result)
+{
+    // Записи, дописанные, пока копия писалась, переносятся в неё; их немного
+    const QString journal = file.fileName();
+    file.seek(result.copied);
+    const QByteArray rest = file.readAll();
+    QFile compacted(compactedPath(journal));
+    if (!compacted.open(QIODevice::WriteOnly | QIODevice::Append) || compacted.write(rest) != rest.size() ||
+        !compacted.flush())
+    {
+        qDebug() << "Unable to compact journal: " << journal;
+        return false;
+    }
+    compacted.close();
+
+    file.close();
+    if (!QFile::remove(journal))
+    {
+        file.open(QIODevice::ReadWrite);
+        return false;
+    }
+    settle(journal);
+    if (!file.open(QIODevice::ReadWrite))
+    {
+        qDebug() << "Unable to open journal: " << journal;
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QFile>
+#include <QFutureWatcher>
+#include <QLockFile>
+#include <QObject>
+#include <QScopedPointer>
+#include <QTextDocument>
+
+// Журнал правок документа на диске.
+// Каждое изменение дописывается в конец файла как короткая дельта (позиция,
+// число удалённых символов, вставленный текст с форматами). Дельты
+// отсчитываются от основы: отметки "сохранено" (документ совпадает с файлом
+// на диске) или контрольной точки со всем документом. Время от времени
+// журнал сжимается до новой основы: контрольная точка сериализуется из копии
+// документа, а после сохранения основой становится отметка. Сжатый журнал
+// пишет рабочий поток в соседний файл, который затем заменяет прежний.
+// Известное ограничение: копия документа для контрольной точки снимается
+// в потоке GUI, и на большом документе это заметная пауза.
+// В памяти держатся только смещения записей, поэтому длинная сессия правок
+// не увеличивает расход памяти. Журнал удаляется вместе с документом; если
+// программа завершилась аварийно, он остаётся и позволяет восстановить
+// несохранённые правки. Журнал по имени файла блокируется: если файл открыт
+// ещё в одной вкладке, её журнал получает уникальное имя, как у нового
+// документа, и не мешает первой.
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int CheckpointDeltas = 1024;               // Дельт между контрольными точками
+    static const qint64 CheckpointBytes = 4 * 1024 * 1024; // Байт дельт между контрольными точками
+
+    EditJournal(QTextDocument *document, const QString &filePath);
+    ~EditJournal() override;
+
+    // Журнал, закреплённый за документом (создаётся при первом обращении)
+    static EditJournal *forDocument(QTextDocument *document, const QString &filePath = QString());
+
+    // Журнал файла с несохранёнными правками, оставшийся после аварийного завершения
+    static bool hasJournal(const QString &filePath);
+    static bool recover(QTextDocument *document, const QString &filePath);
+    static void discard(const QString &filePath);
+
+    // Файл сохранён под другим именем: журнал переезжает вслед за ним
+    void setFilePath(const QString &filePath);
+    // Снимок документа для сохранения сделан; после записи файла журнал
+    // сокращается до этого места
+    void saveStarted();
+    void saveCommitted();
+
+    // Отметка перед очисткой документа; отмена очистки восстанавливает текст на момент отметки
+    void markClear();
+    bool canUndoClear() const { return markOffset >= 0; }
+    bool undoClear();
+
+private:
+    enum RecordType : quint8
+    {
+        Checkpoint = 1,
+        Delta = 2,
+        Mark = 3,
+        Saved = 4 // Документ в этом месте совпадает с файлом на диске
+    };
+
+    static QString journalPath(const QString &filePath);
+    static QString lockJournal(const QString &filePath, QScopedPointer<QLockFile> &lock);
+    static qint64 scan(QFile &journal, qint64 &base, quint8 &baseType, int &deltasAfterBase);
+    static bool replay(QFile &file, qint64 from, qint64 to, QTextDocument *document);
+    static QByteArray record(RecordType type, const QByteArray &payload);
+    static QByteArray serialize(const QTextDocument *document);
+
+    // Сжатый журнал, записанный рабочим потоком
+    struct Compaction
+    {
+        QString journal; // Прежний журнал
+        bool ok;
+        qint64 keptFrom; // Начало участка очистки, перенесённого в начало копии
+        qint64 kept;     // Его длина
+        qint64 prefix;   // Длина копии до первой перенесённой записи
+        qint64 copied;   // Конец перенесённых записей в прежнем журнале
+    };
+    static Compaction writeCompacted(const QString &journal, qint64 keptFrom, qint64 keptTo,
+                                     RecordType type, const QTextDocument *document, qint64 from);
+
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void writeRecord(RecordType type, const QByteArray &payload);
+    void writeCheckpoint();
+    void startCheckpoint();
+    void startCompaction(RecordType type, qint64 from);
+    void finishCompaction();
+    void dropCompaction();
+    bool replaceJournal(const Compaction &result);
+
+    QTextDocument *document;
+    QScopedPointer<QLockFile> lock; // Блокировка журнала по имени файла
+    QFile file;
+    bool replaying;
+
+    qint64 checkpointOffset;     // Последняя основа: контрольная точка или отметка сохранения
+    bool baseSaved;              // Основа - отметка сохранения
+    qint64 markCheckpointOffset; // Контрольная точка, с которой воспроизводится отметка
+    qint64 markOffset;           // Отметка очистки; -1 - отменять нечего
+    int deltasSinceCheckpoint;
+    qint64 bytesSinceCheckpoint;
+    qint64 saveOffset;  // Конец журнала на момент снимка для сохранения; -1 - нет
+    qint64 savedOffset; // Снимок записан в файл, журнал ждёт сжатия до него; -1 - нет
+
+    QFutureWatcher<Compaction> compactionWatcher;
+    QTextDocument *snapshot; // Копия документа, которую сериализует рабочий поток
+    RecordType compactionType;
+    qint64 compactionFrom; // Новая основа заменяет записи до этого места; -1 - результат устарел
+};
+
+#endif // EDITJOURNAL_H
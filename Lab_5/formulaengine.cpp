@@ -0,0 +1,1067 @@
+#include "formulaengine.h"
+
+#include <QSet>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtNumeric>
+
+#include <algorithm>
+#include <cmath>
+
+static const char *RefError = "#REF!";
+static const char *ValueError = "#VALUE!";
+static const char *DivisionError = "#DIV/0!";
+static const char *NumberError = "#NUM!";
+static const char *NameError = "#NAME?";
+static const char *SyntaxError = "#ERROR!";
+static const char *CycleError = "#CYCLE!";
+
+static const int SmallRange = 4096; // Диапазоны до этого размера перебираются по ячейкам
+static const int WideRange = 64;    // Диапазоны шире стольких столбцов не раскладываются по столбцам
+
+// Лексема формулы
+struct Token
+{
+    enum Kind
+    {
+        End,
+        Number,
+        Reference,
+        Name,
+        Symbol,
+        Error,
+        Invalid
+    };
+
+    Kind kind = End;
+    int position = 0; // Начало и длина в тексте формулы
+    int length = 0;
+    double number = 0.0;
+    int row = 0;
+    int column = 0;
+    QString name;
+    QChar symbol;
+};
+
+static bool isLetter(QChar ch)
+{
+    return (ch >= QLatin1Char('A') && ch <= QLatin1Char('Z')) || (ch >= QLatin1Char('a') && ch <= QLatin1Char('z'));
+}
+
+static bool isDigit(QChar ch)
+{
+    return ch >= QLatin1Char('0') && ch <= QLatin1Char('9');
+}
+
+static Token nextToken(const QString &text, int position)
+{
+    while (position < text.size() && text.at(position).isSpace())
+    {
+        ++position;
+    }
+
+    Token token;
+    token.position = position;
+    if (position >= text.size())
+    {
+        return token;
+    }
+
+    const QChar ch = text.at(position);
+    int end = position;
+    if (isDigit(ch) || ch == QLatin1Char('.'))
+    {
+        while (end < text.size() && (isDigit(text.at(end)) || text.at(end) == QLatin1Char('.')))
+        {
+            ++end;
+        }
+        // Порядок числа: 1e5, 2.5E-3
+        if (end < text.size() && (text.at(end) == QLatin1Char('e') || text.at(end) == QLatin1Char('E')))
+        {
+            int exponent = end + 1;
+            if (exponent < text.size() && (text.at(exponent) == QLatin1Char('+') || text.at(exponent) == QLatin1Char('-')))
+            {
+                ++exponent;
+            }
+            if (exponent < text.size() && isDigit(text.at(exponent)))
+            {
+                end = exponent;
+                while (end < text.size() && isDigit(text.at(end)))
+                {
+                    ++end;
+                }
+            }
+        }
+        bool ok = false;
+        token.number = text.midRef(position, end - position).toDouble(&ok);
+        token.kind = ok ? Token::Number : Token::Invalid;
+    }
+    else if (isLetter(ch))
+    {
+        while (end < text.size() && isLetter(text.at(end)))
+        {
+            ++end;
+        }
+        const int letters = end - position;
+        while (end < text.size() && isDigit(text.at(end)))
+        {
+            ++end;
+        }
+        const int digits = end - position - letters;
+
+        if (digits == 0)
+        {
+            token.kind = Token::Name;
+            token.name = text.mid(position, letters).toUpper();
+        }
+        else if (letters <= 4 && digits <= 9 && text.at(position + letters) != QLatin1Char('0'))
+        {
+            // Ссылка: буквы столбца и номер строки с единицы
+            token.kind = Token::Reference;
+            for (int i = position; i < position + letters; ++i)
+            {
+                token.column = token.column * 26 + (text.at(i).toUpper().unicode() - 'A' + 1);
+            }
+            token.column -= 1;
+            token.row = text.midRef(position + letters, digits).toInt() - 1;
+        }
+        else
+        {
+            token.kind = Token::Invalid;
+        }
+    }
+    else if (ch == QLatin1Char('#'))
+    {
+        while (end < text.size() && text.at(end) != QLatin1Char('!') && text.at(end) != QLatin1Char('?'))
+        {
+            ++end;
+        }
+        end = qMin(end + 1, text.size());
+        token.kind = text.midRef(position, end - position) == QLatin1String(RefError) ? Token::Error : Token::Invalid;
+    }
+    else if (QStringLiteral("+-*/^():,;").contains(ch))
+    {
+        end = position + 1;
+        token.kind = Token::Symbol;
+        token.symbol = ch;
+    }
+    else
+    {
+        token.kind = Token::Invalid;
+    }
+
+    if (end == position)
+    {
+        end = position + 1;
+    }
+    token.length = end - position;
+    return token;
+}
+
+static QString referenceText(int row, int column)
+{
+    return FormulaEngine::columnName(column) + QString::number(row + 1);
+}
+
+// Разбор формулы рекурсивным спуском в массив узлов; корень добавляется последним
+class FormulaParser
+{
+public:
+    using Node = FormulaEngine::Node;
+
+    FormulaParser(const QString &text, QVector<Node> &nodes, QVector<CellRange> &references) : text(text),
+                                                                                             nodes(nodes),
+                                                                                             references(references),
+                                                                                             unknownName(false)
+    {
+        token = nextToken(text, 1); // Пропускаем '='
+    }
+
+    // false - синтаксическая ошибка, unknownFunction() - неизвестная функция
+    bool parse()
+    {
+        return expression() >= 0 && token.kind == Token::End;
+    }
+
+    bool unknownFunction() const { return unknownName; }
+
+private:
+    void advance()
+    {
+        token = nextToken(text, token.position + token.length);
+    }
+
+    bool isSymbol(char symbol) const
+    {
+        return token.kind == Token::Symbol && token.symbol == QLatin1Char(symbol);
+    }
+
+    int add(Node::Op op, int left = -1, int right = -1)
+    {
+        Node node;
+        node.op = op;
+        node.number = 0.0;
+        node.range = CellRange{0, 0, 0, 0};
+        node.left = left;
+        node.right = right;
+        nodes.append(node);
+        return nodes.size() - 1;
+    }
+
+    int expression()
+    {
+        int left = term();
+        while (left >= 0 && (isSymbol('+') || isSymbol('-')))
+        {
+            const Node::Op op = isSymbol('+') ? Node::Add : Node::Subtract;
+            advance();
+            const int right = term();
+            left = right < 0 ? -1 : add(op, left, right);
+        }
+        return left;
+    }
+
+    int term()
+    {
+        int left = power();
+        while (left >= 0 && (isSymbol('*') || isSymbol('/')))
+        {
+            const Node::Op op = isSymbol('*') ? Node::Multiply : Node::Divide;
+            advance();
+            const int right = power();
+            left = right < 0 ? -1 : add(op, left, right);
+        }
+        return left;
+    }
+
+    // Степень правоассоциативна: 2^3^2 = 2^9
+    int power()
+    {
+        const int base = unary();
+        if (base < 0 || !isSymbol('^'))
+        {
+            return base;
+        }
+        advance();
+        const int exponent = power();
+        return exponent < 0 ? -1 : add(Node::Power, base, exponent);
+    }
+
+    int unary()
+    {
+        if (isSymbol('-') || isSymbol('+'))
+        {
+            const bool negate = isSymbol('-');
+            advance();
+            const int operand = unary();
+            return operand < 0 || !negate ? operand : add(Node::Negate, operand);
+        }
+        return primary();
+    }
+
+    int primary()
+    {
+        const Token current = token;
+        switch (current.kind)
+        {
+        case Token::Number:
+        {
+            advance();
+            const int index = add(Node::Number);
+            nodes[index].number = current.number;
+            return index;
+        }
+        case Token::Reference:
+            return reference();
+        case Token::Error:
+            advance();
+            return add(Node::Error);
+        case Token::Name:
+            return function();
+        case Token::Symbol:
+            if (isSymbol('('))
+            {
+                advance();
+                const int inner = expression();
+                if (inner < 0 || !isSymbol(')'))
+                {
+                    return -1;
+                }
+                advance();
+                return inner;
+            }
+            return -1;
+        default:
+            return -1;
+        }
+    }
+
+    // Ссылка на ячейку или диапазон A1:B2
+    int reference()
+    {
+        CellRange range{token.row, token.column, token.row, token.column};
+        advance();
+        Node::Op op = Node::Cell;
+        if (isSymbol(':'))
+        {
+            advance();
+            if (token.kind != Token::Reference)
+            {
+                return -1;
+            }
+            range = CellRange{qMin(range.top, token.row), qMin(range.left, token.column),
+                              qMax(range.top, token.row), qMax(range.left, token.column)};
+            advance();
+            op = Node::Range;
+        }
+        references.append(range);
+        const int index = add(op);
+        nodes[index].range = range;
+        return index;
+    }
+
+    int function()
+    {
+        static const QHash<QString, Node::Op> functions = {
+            {QStringLiteral("SUM"), Node::Sum},
+            {QStringLiteral("AVG"), Node::Average},
+            {QStringLiteral("AVERAGE"), Node::Average},
+            {QStringLiteral("MIN"), Node::Minimum},
+            {QStringLiteral("MAX"), Node::Maximum},
+            {QStringLiteral("COUNT"), Node::Count}};
+
+        auto function = functions.constFind(token.name);
+        advance();
+        if (function == functions.constEnd())
+        {
+            unknownName = true;
+            return -1;
+        }
+        if (!isSymbol('('))
+        {
+            return -1;
+        }
+        advance();
+
+        // Аргументы через ',' или ';'
+        QVector<int> args;
+        if (!isSymbol(')'))
+        {
+            for (;;)
+            {
+                const int arg = expression();
+                if (arg < 0)
+                {
+                    return -1;
+                }
+                args.append(arg);
+                if (!isSymbol(',') && !isSymbol(';'))
+                {
+                    break;
+                }
+                advance();
+            }
+        }
+        if (!isSymbol(')'))
+        {
+            return -1;
+        }
+        advance();
+
+        const int index = add(function.value());
+        nodes[index].args = args;
+        return index;
+    }
+
+    const QString &text;
+    QVector<Node> &nodes;
+    QVector<CellRange> &references;
+    Token token;
+    bool unknownName;
+};
+
+QString FormulaEngine::columnName(int column)
+{
+    QString name;
+    for (int n = column + 1; n > 0; n = (n - 1) / 26)
+    {
+        name.prepend(QChar('A' + (n - 1) % 26));
+    }
+    return name;
+}
+
+QString FormulaEngine::value(int row, int column) const
+{
+    auto formula = formulas.constFind(key(row, column));
+    if (formula == formulas.constEnd())
+    {
+        return QString();
+    }
+    return formula->error.isEmpty() ? QString::number(formula->value, 'g', 15) : formula->error;
+}
+
+QVector<QPair<int, QString>> FormulaEngine::columnValues(int column) const
+{
+    QVector<QPair<int, QString>> values;
+    for (auto it = formulas.constBegin(); it != formulas.constEnd(); ++it)
+    {
+        if (int(it.key() & 0xffffffffu) == column)
+        {
+            values.append(qMakePair(int(it.key() >> 32),
+                                    it->error.isEmpty() ? QString::number(it->value, 'g', 15) : it->error));
+        }
+    }
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+void FormulaEngine::setCell(int row, int column, const QString &text)
+{
+    const quint64 cell = key(row, column);
+    unlink(cell);
+    formulas.remove(cell);
+    if (!isFormula(text))
+    {
+        return;
+    }
+
+    Formula formula;
+    formula.text = text;
+    FormulaParser parser(text, formula.nodes, formula.references);
+    if (!parser.parse())
+    {
+        formula.nodes.clear();
+        formula.references.clear();
+        formula.error = parser.unknownFunction() ? NameError : SyntaxError;
+    }
+    link(cell, formula.references);
+    formulas.insert(cell, formula);
+}
+
+void FormulaEngine::clear()
+{
+    formulas.clear();
+    cellDependents.clear();
+    rangeDependents.clear();
+    wideRangeDependents.clear();
+}
+
+void FormulaEngine::link(quint64 cell, const QVector<CellRange> &references)
+{
+    for (const CellRange &range : references)
+    {
+        if (range.area() == 1)
+        {
+            QVector<quint64> &dependents = cellDependents[key(range.top, range.left)];
+            if (!dependents.contains(cell))
+            {
+                dependents.append(cell);
+            }
+        }
+        else if (range.right - range.left >= WideRange)
+        {
+            wideRangeDependents.append(qMakePair(range, cell));
+        }
+        else
+        {
+            for (int column = range.left; column <= range.right; ++column)
+            {
+                rangeDependents[column].append(qMakePair(range, cell));
+            }
+        }
+    }
+}
+
+void FormulaEngine::unlink(quint64 cell)
+{
+    auto formula = formulas.constFind(cell);
+    if (formula == formulas.constEnd())
+    {
+        return;
+    }
+
+    auto ownRange = [cell](const QPair<CellRange, quint64> &dependent)
+    {
+        return dependent.second == cell;
+    };
+    for (const CellRange &range : formula->references)
+    {
+        if (range.right - range.left >= WideRange)
+        {
+            wideRangeDependents.erase(std::remove_if(wideRangeDependents.begin(), wideRangeDependents.end(), ownRange),
+                                      wideRangeDependents.end());
+            continue;
+        }
+        if (range.area() > 1)
+        {
+            for (int column = range.left; column <= range.right; ++column)
+            {
+                auto dependents = rangeDependents.find(column);
+                if (dependents != rangeDependents.end())
+                {
+                    dependents->erase(std::remove_if(dependents->begin(), dependents->end(), ownRange),
+                                      dependents->end());
+                    if (dependents->isEmpty())
+                    {
+                        rangeDependents.erase(dependents);
+                    }
+                }
+            }
+            continue;
+        }
+        auto dependents = cellDependents.find(key(range.top, range.left));
+        if (dependents != cellDependents.end())
+        {
+            dependents->removeAll(cell);
+            if (dependents->isEmpty())
+            {
+                cellDependents.erase(dependents);
+            }
+        }
+    }
+}
+
+template <typename Visit>
+void FormulaEngine::visitDependents(const CellRange &range, Visit visit) const
+{
+    if (range.area() <= SmallRange)
+    {
+        for (int row = range.top; row <= range.bottom; ++row)
+        {
+            for (int column = range.left; column <= range.right; ++column)
+            {
+                auto dependents = cellDependents.constFind(key(row, column));
+                if (dependents != cellDependents.constEnd())
+                {
+                    for (quint64 dependent : dependents.value())
+                    {
+                        visit(dependent);
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        for (auto it = cellDependents.constBegin(); it != cellDependents.constEnd(); ++it)
+        {
+            if (range.contains(int(it.key() >> 32), int(it.key() & 0xffffffffu)))
+            {
+                for (quint64 dependent : it.value())
+                {
+                    visit(dependent);
+                }
+            }
+        }
+    }
+
+    // Диапазоны ищутся только среди задевающих те же столбцы; формула, чей
+    // диапазон задевает несколько из них, посещается повторно, повторы отсекает visit
+    auto visitRanges = [&](const QVector<QPair<CellRange, quint64>> &dependents)
+    {
+        for (const QPair<CellRange, quint64> &dependent : dependents)
+        {
+            if (dependent.first.intersects(range))
+            {
+                visit(dependent.second);
+            }
+        }
+    };
+    if (qint64(range.right) - range.left + 1 > rangeDependents.size())
+    {
+        for (auto it = rangeDependents.constBegin(); it != rangeDependents.constEnd(); ++it)
+        {
+            if (it.key() >= range.left && it.key() <= range.right)
+            {
+                visitRanges(it.value());
+            }
+        }
+    }
+    else
+    {
+        for (int column = range.left; column <= range.right; ++column)
+        {
+            auto dependents = rangeDependents.constFind(column);
+            if (dependents != rangeDependents.constEnd())
+            {
+                visitRanges(dependents.value());
+            }
+        }
+    }
+    visitRanges(wideRangeDependents);
+}
+
+QVector<quint64> FormulaEngine::recalculate(const QVector<CellRange> &changed, const QVector<TableColumn> &columns, int rows)
+{
+    if (formulas.isEmpty())
+    {
+        return QVector<quint64>();
+    }
+
+    // Грязные формулы: в изменённых ячейках и всё, что от них зависит
+    QSet<quint64> dirty;
+    QVector<quint64> queue;
+    auto mark = [&](quint64 cell)
+    {
+        if (!dirty.contains(cell) && formulas.contains(cell))
+        {
+            dirty.insert(cell);
+            queue.append(cell);
+        }
+    };
+    for (const CellRange &range : changed)
+    {
+        if (range.area() <= SmallRange)
+        {
+            for (int row = range.top; row <= range.bottom; ++row)
+            {
+                for (int column = range.left; column <= range.right; ++column)
+                {
+                    mark(key(row, column));
+                }
+            }
+        }
+        else
+        {
+            for (auto it = formulas.constBegin(); it != formulas.constEnd(); ++it)
+            {
+                if (range.contains(int(it.key() >> 32), int(it.key() & 0xffffffffu)))
+                {
+                    mark(it.key());
+                }
+            }
+        }
+        visitDependents(range, mark);
+    }
+    for (int i = 0; i < queue.size(); ++i)
+    {
+        const int row = int(queue.at(i) >> 32);
+        const int column = int(queue.at(i) & 0xffffffffu);
+        visitDependents(CellRange{row, column, row, column}, mark);
+    }
+
+    // Рёбра графа между грязными формулами: от ячейки, на которую ссылаются, к формуле
+    QHash<quint64, int> pending;
+    QHash<quint64, QVector<quint64>> successors;
+    for (quint64 cell : queue)
+    {
+        int &count = pending[cell];
+        const QVector<CellRange> &references = formulas.constFind(cell)->references;
+        for (const CellRange &range : references)
+        {
+            auto addEdge = [&](quint64 precedent)
+            {
+                successors[precedent].append(cell);
+                ++count;
+            };
+            if (range.area() <= dirty.size())
+            {
+                for (int row = range.top; row <= range.bottom; ++row)
+                {
+                    for (int column = range.left; column <= range.right; ++column)
+                    {
+                        if (dirty.contains(key(row, column)))
+                        {
+                            addEdge(key(row, column));
+                        }
+                    }
+                }
+            }
+            else
+            {
+                for (quint64 precedent : queue)
+                {
+                    if (range.contains(int(precedent >> 32), int(precedent & 0xffffffffu)))
+                    {
+                        addEdge(precedent);
+                    }
+                }
+            }
+        }
+    }
+
+    // Уровни: формулы уровня зависят только от предыдущих и считаются независимо
+    const Sheet sheet{columns, rows};
+    QVector<quint64> level;
+    for (quint64 cell : queue)
+    {
+        if (pending.value(cell) == 0)
+        {
+            level.append(cell);
+        }
+    }
+    while (!level.isEmpty())
+    {
+        QVector<Formula *> batch;
+        batch.reserve(level.size());
+        for (quint64 cell : level)
+        {
+            batch.append(&formulas[cell]);
+        }
+        if (batch.size() >= ParallelFormulas)
+        {
+            QtConcurrent::blockingMap(batch, [this, &sheet](Formula *formula)
+                                      { evaluate(*formula, sheet); });
+        }
+        else
+        {
+            for (Formula *formula : batch)
+            {
+                evaluate(*formula, sheet);
+            }
+        }
+
+        QVector<quint64> next;
+        for (quint64 cell : level)
+        {
+            pending.remove(cell);
+            for (quint64 successor : successors.value(cell))
+            {
+                if (--pending[successor] == 0)
+                {
+                    next.append(successor);
+                }
+            }
+        }
+        level.swap(next);
+    }
+
+    // Оставшиеся формулы ссылаются друг на друга по кругу
+    for (auto it = pending.constBegin(); it != pending.constEnd(); ++it)
+    {
+        Formula &formula = formulas[it.key()];
+        formula.value = 0.0;
+        formula.error = CycleError;
+    }
+    return queue;
+}
+
+QHash<quint64, QString> FormulaEngine::shift(Qt::Orientation orientation, const IndexShift &indexShift)
+{
+    QHash<quint64, QString> rewritten;
+    if (formulas.isEmpty() || indexShift.isEmpty())
+    {
+        return rewritten;
+    }
+
+    // Формула на новом месте; ссылки в неизменённом тексте указывают на те же
+    // ячейки, поэтому её значение остаётся верным
+    struct Moved
+    {
+        quint64 cell;
+        QString text;
+        bool rewritten;
+        double value;
+        QString error;
+    };
+
+    const bool rowsShifted = orientation == Qt::Vertical;
+    QVector<Moved> moved;
+    for (auto it = formulas.constBegin(); it != formulas.constEnd(); ++it)
+    {
+        int row = int(it.key() >> 32);
+        int column = int(it.key() & 0xffffffffu);
+        int &position = rowsShifted ? row : column;
+        position = indexShift.map(position);
+        if (position < 0)
+        {
+            continue; // Ячейка с формулой удалена
+        }
+
+        // Копируем текст между ссылками, ссылки пересчитываем
+        const QString &text = it->text;
+        QString shifted = text.left(1);
+        int copied = 1;
+        Token token = nextToken(text, 1);
+        while (token.kind != Token::End && token.kind != Token::Invalid)
+        {
+            if (token.kind != Token::Reference)
+            {
+                token = nextToken(text, token.position + token.length);
+                continue;
+            }
+
+            CellRange range{token.row, token.column, token.row, token.column};
+            int end = token.position + token.length;
+            const Token colon = nextToken(text, end);
+            const Token second = nextToken(text, colon.position + colon.length);
+            const bool isRange = colon.kind == Token::Symbol && colon.symbol == QLatin1Char(':') &&
+                                 second.kind == Token::Reference;
+            if (isRange)
+            {
+                range = CellRange{qMin(token.row, second.row), qMin(token.column, second.column),
+                                  qMax(token.row, second.row), qMax(token.column, second.column)};
+                end = second.position + second.length;
+            }
+
+            // Границы диапазона сжимаются к оставшимся ячейкам
+            int &low = rowsShifted ? range.top : range.left;
+            int &high = rowsShifted ? range.bottom : range.right;
+            if (indexShift.isRemoval())
+            {
+                const int newLow = indexShift.survivorsBefore(low);
+                high = indexShift.survivorsBefore(high + 1) - 1;
+                low = newLow;
+            }
+            else
+            {
+                low = indexShift.map(low);
+                high = indexShift.map(high);
+            }
+
+            shifted += text.midRef(copied, token.position - copied);
+            if (low > high)
+            {
+                shifted += QLatin1String(RefError);
+            }
+            else
+            {
+                shifted += referenceText(range.top, range.left);
+                if (isRange)
+                {
+                    shifted += QLatin1Char(':') + referenceText(range.bottom, range.right);
+                }
+            }
+            copied = end;
+            token = nextToken(text, end);
+        }
+        shifted += text.midRef(copied);
+
+        const bool changed = shifted != text;
+        moved.append(Moved{key(row, column), shifted, changed, it->value, it->error});
+        if (changed)
+        {
+            rewritten.insert(key(row, column), shifted);
+        }
+    }
+
+    clear();
+    for (const Moved &formula : moved)
+    {
+        setCell(int(formula.cell >> 32), int(formula.cell & 0xffffffffu), formula.text);
+        if (!formula.rewritten)
+        {
+            Formula &kept = formulas[formula.cell];
+            kept.value = formula.value;
+            kept.error = formula.error;
+        }
+    }
+    return rewritten;
+}
+
+FormulaEngine::CellKind FormulaEngine::cellValue(int row, int column, const Sheet &sheet, double &number, QString &error) const
+{
+    if (row >= sheet.rows || column >= sheet.columns.size())
+    {
+        error = RefError;
+        return ErrorCell;
+    }
+
+    auto formula = formulas.constFind(key(row, column));
+    if (formula != formulas.constEnd())
+    {
+        if (!formula->error.isEmpty())
+        {
+            error = formula->error;
+            return ErrorCell;
+        }
+        number = formula->value;
+        return NumberCell;
+    }
+
+    const TableColumn &data = sheet.columns.at(column);
+    if (data.isEmpty(row))
+    {
+        return BlankCell;
+    }
+    if (data.hasValue(row))
+    {
+        number = data.number(row);
+        return NumberCell;
+    }
+    bool ok = false;
+    number = data.type() == TableColumn::String ? data.textRef(row).trimmed().toDouble(&ok)
+                                                : data.text(row).trimmed().toDouble(&ok);
+    return ok ? NumberCell : TextCell;
+}
+
+bool FormulaEngine::evaluate(const Formula &formula, int index, const Sheet &sheet, double &result, QString &error) const
+{
+    const Node &node = formula.nodes.at(index);
+    switch (node.op)
+    {
+    case Node::Number:
+        result = node.number;
+        return true;
+    case Node::Cell:
+        switch (cellValue(node.range.top, node.range.left, sheet, result, error))
+        {
+        case NumberCell:
+            return true;
+        case BlankCell:
+            result = 0.0;
+            return true;
+        case TextCell:
+            error = ValueError;
+            return false;
+        default:
+            return false;
+        }
+    case Node::Range:
+        error = ValueError; // Диапазон допустим только как аргумент функции
+        return false;
+    case Node::Error:
+        error = RefError;
+        return false;
+    case Node::Negate:
+        if (!evaluate(formula, node.left, sheet, result, error))
+        {
+            return false;
+        }
+        result = -result;
+        return true;
+    case Node::Add:
+    case Node::Subtract:
+    case Node::Multiply:
+    case Node::Divide:
+    case Node::Power:
+    {
+        double x = 0.0;
+        double y = 0.0;
+        if (!evaluate(formula, node.left, sheet, x, error) || !evaluate(formula, node.right, sheet, y, error))
+        {
+            return false;
+        }
+        switch (node.op)
+        {
+        case Node::Add:
+            result = x + y;
+            break;
+        case Node::Subtract:
+            result = x - y;
+            break;
+        case Node::Multiply:
+            result = x * y;
+            break;
+        case Node::Divide:
+            if (y == 0.0)
+            {
+                error = DivisionError;
+                return false;
+            }
+            result = x / y;
+            break;
+        default:
+            result = std::pow(x, y);
+            break;
+        }
+        if (!qIsFinite(result))
+        {
+            error = NumberError;
+            return false;
+        }
+        return true;
+    }
+    default:
+        return aggregate(formula, node, sheet, result, error);
+    }
+}
+
+bool FormulaEngine::aggregate(const Formula &formula, const Node &node, const Sheet &sheet, double &result, QString &error) const
+{
+    double sum = 0.0;
+    double minimum = 0.0;
+    double maximum = 0.0;
+    qint64 count = 0;
+    auto include = [&](double value)
+    {
+        sum += value;
+        minimum = count == 0 ? value : qMin(minimum, value);
+        maximum = count == 0 ? value : qMax(maximum, value);
+        ++count;
+    };
+
+    // Пустые ячейки и текст в ссылках и диапазонах пропускаются, ошибки передаются дальше
+    for (int arg : node.args)
+    {
+        const Node &argument = formula.nodes.at(arg);
+        if (argument.op == Node::Range || argument.op == Node::Cell)
+        {
+            // Диапазон за пределами таблицы обрезается по её краю
+            const int bottom = qMin(argument.range.bottom, sheet.rows - 1);
+            const int right = qMin(argument.range.right, sheet.columns.size() - 1);
+            if (argument.op == Node::Cell && (bottom < argument.range.top || right < argument.range.left))
+            {
+                error = RefError;
+                return false;
+            }
+            for (int column = argument.range.left; column <= right; ++column)
+            {
+                for (int row = argument.range.top; row <= bottom; ++row)
+                {
+                    double value = 0.0;
+                    switch (cellValue(row, column, sheet, value, error))
+                    {
+                    case NumberCell:
+                        include(value);
+                        break;
+                    case ErrorCell:
+                        return false;
+                    default:
+                        break;
+                    }
+                }
+            }
+        }
+        else
+        {
+            double value = 0.0;
+            if (!evaluate(formula, arg, sheet, value, error))
+            {
+                return false;
+            }
+            include(value);
+        }
+    }
+
+    switch (node.op)
+    {
+    case Node::Sum:
+        result = sum;
+        break;
+    case Node::Average:
+        if (count == 0)
+        {
+            error = DivisionError;
+            return false;
+        }
+        result = sum / double(count);
+        break;
+    case Node::Minimum:
+        result = minimum;
+        break;
+    case Node::Maximum:
+        result = maximum;
+        break;
+    default:
+        result = double(count);
+        break;
+    }
+    return true;
+}
+
+void FormulaEngine::evaluate(Formula &formula, const Sheet &sheet) const
+{
+    if (formula.nodes.isEmpty())
+    {
+        return; // Ошибка разбора уже записана в формулу
+    }
+
+    double result = 0.0;
+    QString error;
+    if (evaluate(formula, formula.nodes.size() - 1, sheet, result, error) && !qIsFinite(result))
+    {
+        error = NumberError;
+    }
+    formula.value = error.isEmpty() ? result : 0.0;
+    formula.error = error;
+}
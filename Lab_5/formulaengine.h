@@ -0,0 +1,141 @@
+#ifndef FORMULAENGINE_H
+#define FORMULAENGINE_H
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include "tablecolumn.h"
+
+// Прямоугольник ячеек в координатах хранилища, границы включительно
+struct CellRange
+{
+    int top;
+    int left;
+    int bottom;
+    int right;
+
+    bool contains(int row, int column) const { return row >= top && row <= bottom && column >= left && column <= right; }
+    bool intersects(const CellRange &other) const
+    {
+        return top <= other.bottom && other.top <= bottom && left <= other.right && other.left <= right;
+    }
+    qint64 area() const { return qint64(bottom - top + 1) * qint64(right - left + 1); }
+};
+
+// Вычислитель формул в ячейках таблицы.
+// Формула - текст ячейки, начинающийся с '=': числа, + - * / ^, скобки,
+// ссылки вида B3, диапазоны B1:B10 и функции SUM, AVG, MIN, MAX, COUNT.
+// Каждая формула разбирается один раз в компактное дерево. По графу
+// зависимостей после правки пересчитываются только затронутые формулы:
+// они раскладываются по уровням, и формулы одного уровня, не зависящие
+// друг от друга, при большом количестве считаются параллельно.
+// Строки и столбцы - координаты хранилища, а не представления.
+class FormulaEngine
+{
+public:
+    static const int ParallelFormulas = 256; // Уровни меньше этого считаются в одном потоке
+
+    static bool isFormula(const QString &text) { return text.size() > 1 && text.at(0) == QLatin1Char('='); }
+    // Имя столбца в ссылках: A..Z, AA..
+    static QString columnName(int column);
+    // Тот же ключ ячейки, что TableModel::cellKey
+    static quint64 key(int row, int column) { return (quint64(quint32(row)) << 32) | quint32(column); }
+
+    bool isEmpty() const { return formulas.isEmpty(); }
+    bool hasFormula(int row, int column) const { return formulas.contains(key(row, column)); }
+    // Значение для показа: число или код ошибки вида #REF!
+    QString value(int row, int column) const;
+    // Значения всех формул столбца по возрастанию строк
+    QVector<QPair<int, QString>> columnValues(int column) const;
+
+    // Ставит формулу в ячейку или убирает её, если текст не формула; значение
+    // появится после recalculate
+    void setCell(int row, int column, const QString &text);
+    // Пересчитывает формулы в изменённых ячейках и все формулы, зависящие от
+    // них. Возвращает ключи ячеек, значения которых пересчитаны
+    QVector<quint64> recalculate(const QVector<CellRange> &changed, const QVector<TableColumn> &columns, int rows);
+    // Сдвигает ячейки формул и ссылки в них после вставки или удаления строк
+    // (Qt::Vertical) или столбцов, сколько бы участков ни было затронуто, за
+    // один проход; ссылки на удалённые ячейки становятся #REF!. Возвращает
+    // новый текст формул, у которых он изменился; значения остальных формул
+    // остаются прежними, пересчитать нужно только переписанные
+    QHash<quint64, QString> shift(Qt::Orientation orientation, const IndexShift &indexShift);
+    void clear();
+
+private:
+    struct Node
+    {
+        enum Op
+        {
+            Number,
+            Cell,
+            Range,
+            Error, // Ссылка, потерянная при удалении строк или столбцов
+            Negate,
+            Add,
+            Subtract,
+            Multiply,
+            Divide,
+            Power,
+            Sum,
+            Average,
+            Minimum,
+            Maximum,
+            Count
+        };
+
+        Op op;
+        double number;
+        CellRange range;
+        int left;          // Операнды - номера узлов той же формулы
+        int right;
+        QVector<int> args; // Аргументы функции
+    };
+
+    struct Formula
+    {
+        QString text;
+        QVector<Node> nodes; // Корень - последний узел; пусто, если формула с ошибкой
+        QVector<CellRange> references;
+        double value = 0.0;
+        QString error;
+    };
+
+    // Данные таблицы на время пересчёта
+    struct Sheet
+    {
+        const QVector<TableColumn> &columns;
+        int rows;
+    };
+
+    enum CellKind
+    {
+        NumberCell,
+        BlankCell,
+        TextCell,
+        ErrorCell
+    };
+
+    friend class FormulaParser;
+
+    void link(quint64 cell, const QVector<CellRange> &references);
+    void unlink(quint64 cell);
+    template <typename Visit>
+    void visitDependents(const CellRange &range, Visit visit) const;
+
+    CellKind cellValue(int row, int column, const Sheet &sheet, double &number, QString &error) const;
+    bool evaluate(const Formula &formula, int index, const Sheet &sheet, double &result, QString &error) const;
+    bool aggregate(const Formula &formula, const Node &node, const Sheet &sheet, double &result, QString &error) const;
+    void evaluate(Formula &formula, const Sheet &sheet) const;
+
+    QHash<quint64, Formula> formulas;
+    QHash<quint64, QVector<quint64>> cellDependents; // Ячейка -> формулы, ссылающиеся на неё
+    // Диапазоны больше одной ячейки и их формулы, разложенные по столбцам,
+    // которые они задевают; очень широкие диапазоны лежат одним списком
+    QHash<int, QVector<QPair<CellRange, quint64>>> rangeDependents;
+    QVector<QPair<CellRange, quint64>> wideRangeDependents;
+};
+
+#endif // FORMULAENGINE_H
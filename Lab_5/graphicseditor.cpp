@@ -1,12 +1,30 @@
 #include "graphicseditor.h"
 #include "ui_graphicseditor.h"
 
+// Считать физику в отдельном потоке, чтобы тяжёлая сцена не тормозила GUI
+static const bool SimulationInWorkerThread = true;
+
 GraphicsEditor::GraphicsEditor(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::GraphicsEditor), currentColor(Qt::white),
-      currentPen(Qt::black), topWall(nullptr), bottomWall(nullptr),
-      leftWall(nullptr), rightWall(nullptr), collisionSound(":/res/sound.wav") {
+      currentPen(Qt::black), audio(new AudioEngine(":/res/sound.wav", this)),
+      simulation(new Simulation), simulationThread(nullptr),
+      obstaclesDirty(true) {
   ui->setupUi(this);
 
+  // Физика считается с фиксированным шагом отдельно от отрисовки
+  if (SimulationInWorkerThread) {
+    simulationThread = new QThread(this);
+    simulation->moveToThread(simulationThread);
+    connect(simulationThread, &QThread::started, simulation,
+            &Simulation::start);
+    connect(simulationThread, &QThread::finished, simulation,
+            &QObject::deleteLater);
+    simulationThread->start();
+  } else {
+    simulation->setParent(this);
+    simulation->start();
+  }
+
   scene = new QGraphicsScene(this);
   view = new GraphicsView(scene, this);
   setCentralWidget(view);
@@ -22,27 +40,35 @@ GraphicsEditor::GraphicsEditor(QWidget *parent)
 
   connect(view, &GraphicsView::viewportChanged, this,
           &GraphicsEditor::updateWallPositions);
-  connect(
-      view, &GraphicsView::resized, this,
-      &GraphicsEditor::setupWalls); // Подключение сигнала resized к setupWalls
+  // Стены рисуются слоем поверх сцены, при изменении размера меняется только
+  // граница арены, поэтому откладывать её не нужно
+  connect(view, &GraphicsView::resized, this,
+          &GraphicsEditor::updateWallPositions);
   setupWalls();
 
   drawGordeew();
   drawSheiko();
   createMovingObject();
 
-  //         Таймер для перемещения объекта
+  //         Таймер отрисовки движущихся объектов
   QTimer *timer = new QTimer(this);
-  connect(timer, &QTimer::timeout, this, [this]() {
-    moveObject(); // Функция перемещения и обнаружения столкновений
-  });
-  timer->start(30); // Интервал обновления, например, 30 мс
+  connect(timer, &QTimer::timeout, this,
+          &GraphicsEditor::renderMovingObjects);
+  timer->start(16); // Около 60 кадров в секунду
 }
 
-GraphicsEditor::~GraphicsEditor() { delete ui; }
+GraphicsEditor::~GraphicsEditor() {
+  if (simulationThread) {
+    simulationThread->quit(); // Симуляция удалится по завершении потока
+    simulationThread->wait();
+  }
+  delete ui;
+}
 
 void GraphicsEditor::closeEvent(QCloseEvent *event) {
   // Удаление всех движущихся объектов
+  QList<QGraphicsItemGroup *> movingItemGroups = simulation->bodyItems();
+  simulation->clearBodies();
   for (QGraphicsItemGroup *itemGroup : movingItemGroups) {
     QList<QGraphicsItem *> children = itemGroup->childItems();
     for (QGraphicsItem *child : children) {
@@ -52,11 +78,9 @@ void GraphicsEditor::closeEvent(QCloseEvent *event) {
     scene->removeItem(itemGroup);
     delete itemGroup;
   }
-  movingItemGroups.clear();
-  velocities.clear();
 
   // Останавливаем звук
-  collisionSound.stop();
+  audio->stop();
 
   emit editorClosed();
   QMainWindow::closeEvent(event);
@@ -106,9 +130,9 @@ void GraphicsEditor::createMovingObject() {
 
   human->setPos(400, 500); // Начальная позиция объекта
 
-  // Добавляем объект и его начальную скорость в соответствующие списки
-  movingItemGroups.append(human);
-  velocities.append(QPointF(2, 2)); // Скорость по осям X и Y
+  // Добавляем объект и его начальную скорость в хранилище тел
+  simulation->addBody(human, human->pos(), human->boundingRect(),
+                      QPointF(66, 66)); // Скорость по осям X и Y, пикс/с
 
   // Создание элементов телефона
   QGraphicsRectItem *phoneBody = new QGraphicsRectItem(20, 20, 50, 100);
@@ -136,9 +160,9 @@ void GraphicsEditor::createMovingObject() {
 
   phone->setPos(400, 500); // Начальная позиция объекта
 
-  // Добавляем объект и его начальную скорость в соответствующие списки
-  movingItemGroups.append(phone);
-  velocities.append(QPointF(2, 2)); // Скорость по осям X и Y
+  // Добавляем объект и его начальную скорость в хранилище тел
+  simulation->addBody(phone, phone->pos(), phone->boundingRect(),
+                      QPointF(66, 66)); // Скорость по осям X и Y, пикс/с
 }
 
 // void GraphicsEditor::moveObject()
@@ -211,93 +235,50 @@ void GraphicsEditor::createMovingObject() {
 //    }
 //}
 
-void GraphicsEditor::moveObject() {
-  int wallThickness = 10;
+void GraphicsEditor::renderMovingObjects() {
+  if (obstaclesDirty) {
+    collectObstacles();
+  }
 
-  for (int i = 0; i < movingItemGroups.size(); ++i) {
-    QGraphicsItemGroup *itemGroup = movingItemGroups[i];
-    QPointF velocity = velocities[i];
-    QPointF newPos = itemGroup->pos() + velocity;
-
-    // Проверка столкновения с левой и правой стенами
-    QRectF boundingRect = itemGroup->boundingRect();
-    qreal left = newPos.x() + boundingRect.width();
-    qreal right = newPos.x() + boundingRect.width();
-    qreal top = newPos.y() + boundingRect.height();
-    qreal bottom = newPos.y() + boundingRect.height();
-
-    // Проверка столкновения с левой и правой стенами
-    if (left <= wallThickness) {
-      velocity.setX(-velocity.x());
-      collisionSound.play();
-    } else if (right >= view->viewport()->width() - 2 * wallThickness) {
-      velocity.setX(-velocity.x());
-      collisionSound.play();
-    }
+  // Положения, интерполированные между шагами симуляции
+  QVector<QGraphicsItemGroup *> items;
+  QVector<QPointF> positions;
+  // Удары за кадр сливаются в один запрос к звуку
+  audio->trigger(simulation->interpolate(items, positions));
+  for (int i = 0; i < items.size(); ++i) {
+    items[i]->setPos(positions[i]);
+  }
+}
 
-    // Проверка столкновения с верхней и нижней стенами
-    if (top <= wallThickness) {
-      velocity.setY(-velocity.y());
-      collisionSound.play();
-    } else if (bottom >= view->viewport()->height() - wallThickness) {
-      velocity.setY(-velocity.y());
-      collisionSound.play();
-    }
+void GraphicsEditor::itemDragged(QGraphicsItem *item) {
+  if (!simulation->setBodyPosition(item, item->pos())) {
+    obstaclesDirty = true;
+  }
+}
 
-    // Проверка столкновения с другими объектами на сцене
-    //        QList<QGraphicsItem *> itemsAtNewPos = scene->items(newPos);
-    //        bool collisionDetected = false;
-    //        for (QGraphicsItem *otherItem : itemsAtNewPos) {
-    //            if (otherItem != itemGroup &&
-    //            itemGroup->collidesWithItem(otherItem,
-    //            Qt::IntersectsItemShape) && otherItem->data(0) != "user") {
-    //                collisionDetected = true;
-    //                break;
-    //            }
-    //        }
-
-    //        if (collisionDetected) {
-
-    //            velocity.setX(-velocity.x()); // Изменяем направление по оси X
-    //            при столкновении velocity.setY(-velocity.y()); // Изменяем
-    //            направление по оси Y при столкновении collisionSound.play();
-    //            // Звук столкновения
-    //        }
-    bool collisionDetected = false;
-    QList<QGraphicsItem *> itemsAtNewPos =
-        scene->items(QRectF(newPos, boundingRect.size()));
-    for (QGraphicsItem *otherItem : itemsAtNewPos) {
-      if (otherItem != itemGroup && otherItem->data(0) != "user") {
-        QRectF otherBoundingRect =
-            otherItem->boundingRect().translated(otherItem->pos());
-
-        if (right > otherBoundingRect.left() &&
-            left < otherBoundingRect.right()) {
-          collisionDetected = true;
-          break;
-        }
-
-        if (bottom > otherBoundingRect.top() &&
-            top < otherBoundingRect.bottom()) {
-          collisionDetected = true;
-          break;
-        }
-      }
+void GraphicsEditor::collectObstacles() {
+  obstaclesDirty = false;
+  QVector<QRectF> bounds;
+  QVector<QPainterPath> shapes;
+
+  // Препятствия - все фигуры верхнего уровня, кроме движущихся объектов и
+  // пользовательских штрихов
+  for (QGraphicsItem *item : scene->items()) {
+    if (item->parentItem() || item->data(0) == "user" ||
+        simulation->containsBody(item)) {
+      continue;
     }
 
-    if (collisionDetected) {
-
-      velocity.setX(
-          -velocity.x()); // Изменяем направление по оси X при столкновении
-      velocity.setY(
-          -velocity.y()); // Изменяем направление по оси Y при столкновении
-      collisionSound.play(); // Звук столкновения
+    // Для групп и прямоугольников достаточно габаритов
+    QPainterPath shape;
+    if (item->type() != QGraphicsItemGroup::Type &&
+        item->type() != QGraphicsRectItem::Type) {
+      shape = item->mapToScene(item->shape());
     }
-
-    // Обновляем позицию объекта и скорость
-    itemGroup->setPos(newPos);
-    velocities[i] = velocity;
+    bounds.append(item->sceneBoundingRect());
+    shapes.append(shape);
   }
+  simulation->setObstacles(bounds, shapes);
 }
 
 void GraphicsEditor::on_SetPen_triggered() {
@@ -401,84 +382,46 @@ void GraphicsEditor::on_SetPen_triggered() {
 
 void GraphicsEditor::on_Clear_triggered() {
   // Останавливаем движение всех объектов (если они двигаются)
-  for (int i = 0; i < movingItemGroups.size(); ++i) {
-    // Останавливаем все анимации или действия, связанные с движущимися
-    // объектами
-    movingItemGroups[i]->setPos(QPointF(0, 0)); // Пример остановки движения
-  }
+  // Останавливаем все анимации или действия, связанные с движущимися
+  // объектами
+  simulation->clearBodies();
 
-  QList<QGraphicsItem *> items = scene->items();
-  // Удаляем все объекты, кроме стен
-  foreach (QGraphicsItem *item, items) {
-    // Проверяем, что это не стена
-    if (item != topWall && item != bottomWall && item != leftWall &&
-        item != rightWall) {
-      scene->removeItem(item); // Убираем из сцены
-      movingItemGroups.removeAll(
-          qgraphicsitem_cast<QGraphicsItemGroup *>(item));
-      delete item; // Немедленное удаление объекта
-    }
-  }
-
-  // Опционально можно перерисовать стены, чтобы они точно остались на месте
-  setupWalls();
+  // Удаляем все объекты; стены рисуются поверх сцены и не затрагиваются
+  scene->clear();
+  obstaclesDirty = true;
 
   scene->setBackgroundBrush(Qt::white); // Сброс фона (если нужно)
 }
 
 void GraphicsEditor::resizeEvent(QResizeEvent *event) {
   QMainWindow::resizeEvent(event);
-  setupWalls(); // Перестраиваем стены при каждом изменении размера окна
+  updateWallPositions(); // Арена следует за размером окна сразу
 }
 
 void GraphicsEditor::setupWalls() {
-  int viewWidth = view->viewport()->width();
-  int viewHeight = view->viewport()->height();
   int wallThickness = 10;
 
-  QPixmap wallImage(":/res/images/wall.jpg");
-
-  QPixmap scaledTopBottom = wallImage.scaled(viewWidth, wallThickness);
-  QPixmap scaledLeftRight = wallImage.scaled(wallThickness, viewHeight);
-
-  // Если стены ещё не были созданы, создаём их, иначе просто изменяем размеры
-  if (!topWall) {
-    topWall = scene->addPixmap(scaledTopBottom);
-    bottomWall = scene->addPixmap(scaledTopBottom);
-    leftWall = scene->addPixmap(scaledLeftRight);
-    rightWall = scene->addPixmap(scaledLeftRight);
-
-    topWall->setFlag(QGraphicsItem::ItemIsMovable, false);
-    bottomWall->setFlag(QGraphicsItem::ItemIsMovable, false);
-    leftWall->setFlag(QGraphicsItem::ItemIsMovable, false);
-    rightWall->setFlag(QGraphicsItem::ItemIsMovable, false);
-  } else {
-    topWall->setPixmap(scaledTopBottom);
-    bottomWall->setPixmap(scaledTopBottom);
-    leftWall->setPixmap(scaledLeftRight);
-    rightWall->setPixmap(scaledLeftRight);
+  // Стены - декорации слоя поверх сцены, их длина следует за окном сама.
+  // Текстура декодируется и масштабируется под толщину стены один раз
+  if (view->edgeDecorations().isEmpty()) {
+    QPixmap wallImage(":/res/images/wall.jpg");
+    QBrush topBottomBrush(
+        wallImage.scaledToHeight(wallThickness, Qt::SmoothTransformation));
+    QBrush leftRightBrush(
+        wallImage.scaledToWidth(wallThickness, Qt::SmoothTransformation));
+
+    view->setEdgeDecorations({{Qt::TopEdge, wallThickness, topBottomBrush},
+                              {Qt::BottomEdge, wallThickness, topBottomBrush},
+                              {Qt::LeftEdge, wallThickness, leftRightBrush},
+                              {Qt::RightEdge, wallThickness, leftRightBrush}});
   }
 
   updateWallPositions();
 }
 
 void GraphicsEditor::updateWallPositions() {
-  int wallThickness = 10;
-
-  int horizontalOffset = view->horizontalScrollBar()->value();
-  int verticalOffset = view->verticalScrollBar()->value();
-
-  if (topWall)
-    topWall->setPos(horizontalOffset, verticalOffset);
-  if (bottomWall)
-    bottomWall->setPos(horizontalOffset, view->viewport()->height() -
-                                             wallThickness + verticalOffset);
-  if (leftWall)
-    leftWall->setPos(horizontalOffset, verticalOffset);
-  if (rightWall)
-    rightWall->setPos(view->viewport()->width() - wallThickness +
-                          horizontalOffset,
-                      verticalOffset);
+  // Тела отражаются от внутренних краёв стен
+  simulation->setArea(view->innerBounds());
 }
 
 void GraphicsEditor::on_AddFigure_triggered() {
@@ -651,6 +594,7 @@ void GraphicsEditor::addShape(QString shapeType, QRectF rect, QColor fillColor,
   shape->setFlag(QGraphicsItem::ItemIsSelectable,
                  true); // Фигуры можно выделять
   shape->setFlag(QGraphicsItem::ItemSendsGeometryChanges, true);
+  obstaclesDirty = true;
 }
 
 void GraphicsEditor::on_DeleteFigure_triggered() {
@@ -674,7 +618,7 @@ void GraphicsEditor::on_DeleteFigure_triggered() {
       // Если это группа, выводим информацию и удаляем её элементы
       qDebug() << "Removing group with child items.";
 
-      movingItemGroups.removeAll(group);
+      simulation->removeBody(group);
 
       QList<QGraphicsItem *> children = group->childItems();
       for (QGraphicsItem *child : children) {
@@ -694,6 +638,7 @@ void GraphicsEditor::on_DeleteFigure_triggered() {
   }
 
   // Обновляем сцену и выводим сообщение
+  obstaclesDirty = true;
   scene->update();
   qDebug() << "Scene updated after deletion.";
 }
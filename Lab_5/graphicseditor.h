@@ -6,21 +6,23 @@
 #include <QDebug>
 #include <QDialog>
 #include <QFormLayout>
-#include <QGraphicsPixmapItem>
+#include <QGraphicsRectItem>
 #include <QGraphicsScene>
 #include <QLabel>
 #include <QMainWindow>
 #include <QPen>
 #include <QPushButton>
 #include <QRandomGenerator>
-#include <QSound>
 #include <QSpinBox>
+#include <QThread>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QtMath>
 
 
+#include "audioengine.h"
 #include "graphicsview.h" // Подключаем наш новый класс GraphicsView
+#include "simulation.h"
 
 namespace Ui {
 class GraphicsEditor;
@@ -32,13 +34,12 @@ class GraphicsEditor : public QMainWindow {
 public:
   explicit GraphicsEditor(QWidget *parent = nullptr);
   ~GraphicsEditor() override;
-  QGraphicsPixmapItem *getTopWall() const { return topWall; }
-  QGraphicsPixmapItem *getBottomWall() const { return bottomWall; }
-  QGraphicsPixmapItem *getLeftWall() const { return leftWall; }
-  QGraphicsPixmapItem *getRightWall() const { return rightWall; }
   QList<QGraphicsItemGroup *> getMovingItemGroups() const {
-    return movingItemGroups;
+    return simulation->bodyItems();
   }
+  // Пользователь перетащил элемент: движущийся объект переносится в
+  // симуляции, остальные фигуры обновляют препятствия
+  void itemDragged(QGraphicsItem *item);
 
 signals:
   void editorClosed();
@@ -62,7 +63,8 @@ private slots:
   void textSetFlags(QGraphicsTextItem *item);
   Qt::BrushStyle stringToBrushStyle(const QString &styleStr);
   void createMovingObject();
-  void moveObject();
+  void renderMovingObjects();
+  void collectObstacles();
 
   void on_Eraser_triggered();
 
@@ -73,16 +75,13 @@ private:
   QPen currentPen;
   GraphicsView *view;
 
-  QGraphicsPixmapItem *topWall;
-  QGraphicsPixmapItem *bottomWall;
-  QGraphicsPixmapItem *leftWall;
-  QGraphicsPixmapItem *rightWall;
 
   QTimer *moveTimer;
 
-  QList<QGraphicsItemGroup *> movingItemGroups; // Список движущихся объектов
-  QList<QPointF> velocities;
-  QSound collisionSound;
+  AudioEngine *audio; // Звук столкновений
+  Simulation *simulation;
+  QThread *simulationThread; // nullptr, если симуляция идёт в потоке GUI
+  bool obstaclesDirty; // Препятствия нужно собрать заново
 };
 
 #endif // GRAPHICSEDITOR_H
@@ -29,12 +29,95 @@ void GraphicsView::setEraserMode(bool mode)
 }
 
 
+void GraphicsView::setEdgeDecorations(const QVector<EdgeDecoration> &newDecorations)
+{
+    decorations = newDecorations;
+    viewport()->update();
+}
+
+QRectF GraphicsView::innerBounds() const
+{
+    QRect inner = viewport()->rect();
+    for (const EdgeDecoration &decoration : decorations) {
+        switch (decoration.edge) {
+        case Qt::TopEdge:
+            inner.setTop(inner.top() + decoration.thickness);
+            break;
+        case Qt::BottomEdge:
+            inner.setBottom(inner.bottom() - decoration.thickness);
+            break;
+        case Qt::LeftEdge:
+            inner.setLeft(inner.left() + decoration.thickness);
+            break;
+        case Qt::RightEdge:
+            inner.setRight(inner.right() - decoration.thickness);
+            break;
+        }
+    }
+    return mapToScene(inner).boundingRect();
+}
+
+bool GraphicsView::isWithinBounds(QGraphicsItem *item, QPointF newPos)
+{
+    QRectF bounds = innerBounds();
+    QRectF current = item->sceneBoundingRect();
+    // Элемент, уже заходящий за границу, можно свободно вытащить обратно
+    return bounds.contains(current.translated(newPos - item->pos())) || !bounds.contains(current);
+}
+
+QRect GraphicsView::decorationRect(const EdgeDecoration &decoration) const
+{
+    const QRect area = viewport()->rect();
+    switch (decoration.edge) {
+    case Qt::TopEdge:
+        return QRect(0, 0, area.width(), decoration.thickness);
+    case Qt::BottomEdge:
+        return QRect(0, area.height() - decoration.thickness, area.width(), decoration.thickness);
+    case Qt::LeftEdge:
+        return QRect(0, 0, decoration.thickness, area.height());
+    case Qt::RightEdge:
+        return QRect(area.width() - decoration.thickness, 0, decoration.thickness, area.height());
+    }
+    return QRect();
+}
+
 void GraphicsView::scrollContentsBy(int dx, int dy)
 {
     QGraphicsView::scrollContentsBy(dx, dy);
+
+    // Прокрутка сдвигает пиксели вместе с полосами: перерисовываем только
+    // полосы и место, куда их унесло, а не элементы сцены
+    QRegion dirty;
+    for (const EdgeDecoration &decoration : decorations) {
+        QRect area = decorationRect(decoration);
+        dirty += area;
+        dirty += area.translated(dx, dy);
+    }
+    viewport()->update(dirty);
+
     emit viewportChanged();
 }
 
+void GraphicsView::drawForeground(QPainter *painter, const QRectF &rect)
+{
+    QGraphicsView::drawForeground(painter, rect);
+    if (decorations.isEmpty()) {
+        return;
+    }
+
+    // Декорации рисуются в координатах окна просмотра поверх сцены
+    painter->save();
+    painter->resetTransform();
+    painter->setPen(Qt::NoPen);
+    for (const EdgeDecoration &decoration : decorations) {
+        QRect area = decorationRect(decoration);
+        painter->setBrushOrigin(area.topLeft());
+        painter->setBrush(decoration.brush);
+        painter->drawRect(area);
+    }
+    painter->restore();
+}
+
 void GraphicsView::mousePressEvent(QMouseEvent *event)
 {
 
@@ -56,13 +139,14 @@ void GraphicsView::mousePressEvent(QMouseEvent *event)
         {
             isDrawing = true;
             isMovingShape = false;
-            lastPoint = mapToScene(event->pos()).toPoint(); // Запоминаем точку нажатия
+            lastPoint = mapToScene(event->pos()); // Запоминаем точку нажатия
+            currentStroke = nullptr; // Новый штрих начнётся с первым движением
         }
         else if (isEraserMode && event->button() == Qt::LeftButton)
                 {
                     // Start erasing on left mouse button press
                     isDrawing = true;
-                    lastPoint = mapToScene(event->pos()).toPoint(); // Capture initial point for eraser
+                    lastPoint = mapToScene(event->pos()); // Capture initial point for eraser
                 }
 
     QGraphicsView::mousePressEvent(event); // Не забываем вызвать базовый метод
@@ -71,38 +155,27 @@ void GraphicsView::mousePressEvent(QMouseEvent *event)
 void GraphicsView::mouseMoveEvent(QMouseEvent *event)
 {
     if (isEraserMode && isDrawing) {
-            QPoint currentPoint = mapToScene(event->pos()).toPoint();
-            QPainterPath eraserPath;
-            eraserPath.addEllipse(currentPoint, currentPen.width() / 2, currentPen.width() / 2); // Задаем область ластика
-
-            QList<QGraphicsItem*> itemsToErase = scene()->items(eraserPath); // Находим объекты в области ластика
-            GraphicsEditor* editor = qobject_cast<GraphicsEditor*>(parent());
-
-            if (editor) {
-                QList<QGraphicsItemGroup*> movingGroups = editor->getMovingItemGroups();
-
-                for (QGraphicsItem* item : itemsToErase) {
-                    bool isUserCreated = item->data(0) == "user";
-
-                    QGraphicsItem* topLevelItem = item->topLevelItem();
-
-                    bool isPartOfMovingGroup = movingGroups.contains(dynamic_cast<QGraphicsItemGroup*>(topLevelItem));
-
-                    if (isUserCreated && !isPartOfMovingGroup) {
-                        // Получаем текущий размер объекта
-                        QRectF bounds = item->boundingRect();
-                        qreal scaleFactor = 0.9;  // Коэффициент уменьшения (настраиваемый)
+            QPointF currentPoint = mapToScene(event->pos());
+            qreal radius = currentPen.widthF() / 2; // Радиус ластика
+
+            // Кандидаты берём из индекса штрихов вдоль капсулы, которую
+            // ластик прошёл от прошлой точки до текущей
+            QRectF sweep = QRectF(lastPoint, currentPoint).normalized().adjusted(-radius, -radius, radius, radius);
+            for (StrokeItem *stroke : strokeIndex.query(sweep)) {
+                bool touched = false;
+                QVector<QVector<QPointF>> pieces = stroke->erase(lastPoint, currentPoint, radius, &touched);
+                if (!touched) {
+                    continue;
+                }
 
-                        if (bounds.width() > 5 && bounds.height() > 5) {
-                            // Уменьшаем размер объекта, если он ещё достаточно велик
-                            item->setScale(item->scale() * scaleFactor);
-                        } else {
-                            // Если объект уже очень мал, удаляем его
-                            scene()->removeItem(item);
-                            delete item;
-                        }
-                    }
+                // Задетый штрих заменяется уцелевшими кусками
+                for (const QVector<QPointF> &piece : pieces) {
+                    StrokeItem *part = new StrokeItem(stroke->pen());
+                    part->setPoints(piece);
+                    scene()->addItem(part);
+                    strokeIndex.insert(part);
                 }
+                delete stroke; // Штрих сам уходит из сцены и индекса
             }
 
             lastPoint = currentPoint; // Обновляем точку для плавного стирания
@@ -115,18 +188,22 @@ void GraphicsView::mouseMoveEvent(QMouseEvent *event)
                     -10, -10).contains(event->pos()))
         {
             isDrawing = false;
+            currentStroke = nullptr;
             return;
         }
 
-        QPoint currentPoint = mapToScene(event->pos()).toPoint(); // Получаем текущую точку
-        QPainterPath path;
-        path.moveTo(lastPoint);
-        path.lineTo(currentPoint);
+        QPointF currentPoint = mapToScene(event->pos()); // Получаем текущую точку
 
-        // Добавляем линию на сцену
-        QGraphicsPathItem *line = scene()->addPath(path, currentPen);
-        line->setZValue(1);
-        line->setData(0, "user");
+        // Весь штрих копится в одном элементе; заполненный кусок
+        // продолжается новым с общей точкой стыка
+        if (!currentStroke || currentStroke->isFull()) {
+            QPointF startPoint = currentStroke ? currentStroke->points().last() : lastPoint;
+            currentStroke = new StrokeItem(currentPen);
+            currentStroke->addPoint(startPoint);
+            scene()->addItem(currentStroke);
+        }
+        currentStroke->addPoint(currentPoint);
+        strokeIndex.insertLastSegment(currentStroke);
 
         lastPoint = currentPoint; // Обновляем последнюю точку
     }
@@ -142,37 +219,33 @@ void GraphicsView::mouseMoveEvent(QMouseEvent *event)
                            QPointF currentPos = itemGroup->pos();
                            QPointF delta = mapToScene(event->pos()) - mapToScene(lastMousePos);  // Смещение от предыдущей позиции
 
-                           // Проверка на столкновение с границами
-                           GraphicsEditor* editor = qobject_cast<GraphicsEditor*>(parent());
-                           if (editor) {
-                               if (itemGroup->collidesWithItem(editor->getTopWall()) ||
-                                   itemGroup->collidesWithItem(editor->getBottomWall()) ||
-                                   itemGroup->collidesWithItem(editor->getLeftWall()) ||
-                                   itemGroup->collidesWithItem(editor->getRightWall())) {
-                                   return;  // Прекращаем перемещение при столкновении с границей
-                               }
+                           // Проверка на выход за стены по аналитической границе
+                           if (!isWithinBounds(itemGroup, currentPos + delta)) {
+                               return;  // Прекращаем перемещение у границы
                            }
+                           GraphicsEditor* editor = qobject_cast<GraphicsEditor*>(parent());
 
                            // Применяем смещение к группе
                            itemGroup->setPos(currentPos + delta);
+                           if (editor) {
+                               editor->itemDragged(itemGroup); // Сообщаем системе столкновений
+                           }
                        } else {
                            // Для обычных объектов
                            QPointF currentPos = selectedItem->pos();
                            QPointF delta = mapToScene(event->pos()) - mapToScene(lastMousePos);  // Смещение от предыдущей позиции
 
-                           // Проверка на столкновение с границами
-                           GraphicsEditor* editor = qobject_cast<GraphicsEditor*>(parent());
-                           if (editor) {
-                               if (selectedItem->collidesWithItem(editor->getTopWall()) ||
-                                   selectedItem->collidesWithItem(editor->getBottomWall()) ||
-                                   selectedItem->collidesWithItem(editor->getLeftWall()) ||
-                                   selectedItem->collidesWithItem(editor->getRightWall())) {
-                                   return;  // Прекращаем перемещение при столкновении с границей
-                               }
+                           // Проверка на выход за стены по аналитической границе
+                           if (!isWithinBounds(selectedItem, currentPos + delta)) {
+                               return;  // Прекращаем перемещение у границы
                            }
+                           GraphicsEditor* editor = qobject_cast<GraphicsEditor*>(parent());
 
                            // Применяем смещение к объекту
                            selectedItem->setPos(currentPos + delta);
+                           if (editor) {
+                               editor->itemDragged(selectedItem);
+                           }
                        }
                    }
                }
@@ -186,6 +259,7 @@ void GraphicsView::mouseReleaseEvent(QMouseEvent *event)
 
         isDrawing = false;
     isMovingShape = false;
+    currentStroke = nullptr;
     QGraphicsView::mouseReleaseEvent(event); // Не забываем вызвать базовый метод
 }
 
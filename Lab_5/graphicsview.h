@@ -10,6 +10,18 @@
 #include <QScrollBar>
 #include <QGraphicsItem>
 
+#include "strokeindex.h"
+#include "strokeitem.h"
+
+
+// Декорация слоя поверх сцены: полоса у края окна просмотра.
+// Рисуется в координатах окна и не является элементом сцены
+struct EdgeDecoration
+{
+    Qt::Edge edge;
+    int thickness;
+    QBrush brush;
+};
 
 class GraphicsView : public QGraphicsView
 {
@@ -21,6 +33,11 @@ public:
     void setPen(const QPen &pen);
     void setEraserMode(bool mode);
 
+    void setEdgeDecorations(const QVector<EdgeDecoration> &newDecorations);
+    const QVector<EdgeDecoration> &edgeDecorations() const { return decorations; }
+    // Граница для столкновений: видимая часть сцены внутри полос-декораций
+    QRectF innerBounds() const;
+
 signals:
     void resized();
     void viewportChanged();
@@ -35,16 +52,22 @@ protected:
             emit resized(); // Испускаем сигнал при каждом изменении размера
         }
     void scrollContentsBy(int dx, int dy) override;
+    void drawForeground(QPainter *painter, const QRectF &rect) override;
     bool isWithinBounds(QGraphicsItem* item, QPointF newPos);
 
 private:
-    QPoint lastPoint;    // Текущая точка рисования
+    QPointF lastPoint;   // Текущая точка рисования
     QColor currentColor; // Цвет кисти
     bool isDrawing;      // Флаг, рисуем ли мы
     bool isMovingShape;
     QPen currentPen;
     QPoint lastMousePos;
     bool isEraserMode = false;
+    StrokeItem *currentStroke = nullptr; // Штрих, который сейчас рисуется
+    StrokeIndex strokeIndex;             // Сетка штрихов для ластика
+    QVector<EdgeDecoration> decorations;
+
+    QRect decorationRect(const EdgeDecoration &decoration) const;
 };
 
 #endif // GRAPHICSVIEW_H
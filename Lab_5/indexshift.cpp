@@ -0,0 +1,120 @@
+#include "indexshift.h"
+
+#include <algorithm>
+
+IndexShift::IndexShift() : removal(false)
+{
+}
+
+IndexShift::IndexShift(const QVector<IndexRange> &ranges, bool removed) : removal(removed)
+{
+    QVector<IndexRange> sorted;
+    for (const IndexRange &range : ranges)
+    {
+        if (range.count > 0)
+        {
+            sorted.append(range);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const IndexRange &a, const IndexRange &b)
+              { return a.first < b.first; });
+
+    // Удаляемые участки сливаются при перекрытии и касании, вставки в одно место складываются
+    for (const IndexRange &range : sorted)
+    {
+        if (!spans.isEmpty())
+        {
+            IndexRange &last = spans.last();
+            if (removed && range.first <= last.first + last.count)
+            {
+                last.count = qMax(last.first + last.count, range.first + range.count) - last.first;
+                continue;
+            }
+            if (!removed && range.first == last.first)
+            {
+                last.count += range.count;
+                continue;
+            }
+        }
+        spans.append(range);
+    }
+
+    int sum = 0;
+    for (const IndexRange &range : spans)
+    {
+        before.append(sum);
+        sum += range.count;
+    }
+}
+
+int IndexShift::find(int index) const
+{
+    // Последний участок, начинающийся не позже index
+    auto it = std::upper_bound(spans.constBegin(), spans.constEnd(), index, [](int value, const IndexRange &range)
+                               { return value < range.first; });
+    return int(it - spans.constBegin()) - 1;
+}
+
+int IndexShift::map(int index) const
+{
+    const int i = find(index);
+    if (i < 0)
+    {
+        return index;
+    }
+    const IndexRange &range = spans.at(i);
+    if (!removal)
+    {
+        return index + before.at(i) + range.count;
+    }
+    return index < range.first + range.count ? -1 : index - before.at(i) - range.count;
+}
+
+int IndexShift::survivorsBefore(int index) const
+{
+    const int i = find(index);
+    if (i < 0)
+    {
+        return index;
+    }
+    const IndexRange &range = spans.at(i);
+    return index - before.at(i) - qMin(range.count, index - range.first);
+}
+
+int IndexShift::indexInRanges(int index) const
+{
+    // Вставленные номера ищутся в новой нумерации, где участок k начинается с first + before[k]
+    int low = 0;
+    int high = spans.size() - 1;
+    while (low <= high)
+    {
+        const int middle = (low + high) / 2;
+        const int first = spans.at(middle).first + (removal ? 0 : before.at(middle));
+        if (index < first)
+        {
+            high = middle - 1;
+        }
+        else if (index >= first + spans.at(middle).count)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            return before.at(middle) + index - first;
+        }
+    }
+    return -1;
+}
+
+IndexShift IndexShift::inverted() const
+{
+    IndexShift inverse;
+    inverse.removal = !removal;
+    inverse.before = before;
+    inverse.spans = spans;
+    for (int i = 0; i < spans.size(); ++i)
+    {
+        inverse.spans[i].first += removal ? -before.at(i) : before.at(i);
+    }
+    return inverse;
+}
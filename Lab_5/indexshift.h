@@ -0,0 +1,49 @@
+#ifndef INDEXSHIFT_H
+#define INDEXSHIFT_H
+
+#include <QVector>
+
+// Участок строк или столбцов: первый номер и количество
+struct IndexRange
+{
+    int first;
+    int count;
+};
+
+// Перенумерация строк или столбцов после вставки или удаления нескольких
+// участков одним изменением. Участки задаются в номерах до изменения; при
+// вставке участок означает count новых номеров перед номером first.
+// Участки упорядочиваются и сливаются при создании, номер переводится
+// двоичным поиском, поэтому каждая структура таблицы перестраивается за
+// один проход, сколько бы участков ни было.
+class IndexShift
+{
+public:
+    IndexShift();
+    IndexShift(const QVector<IndexRange> &ranges, bool removed);
+
+    bool isEmpty() const { return spans.isEmpty(); }
+    bool isRemoval() const { return removal; }
+    const QVector<IndexRange> &ranges() const { return spans; }
+    // Сколько номеров вставлено или удалено
+    int total() const { return spans.isEmpty() ? 0 : before.last() + spans.last().count; }
+
+    // Новый номер; -1, если номер удалён
+    int map(int index) const;
+    // Сколько оставшихся номеров меньше index (для удаления)
+    int survivorsBefore(int index) const;
+    // Место номера в участках, если их выписать подряд; -1, если номер ни в
+    // один участок не входит
+    int indexInRanges(int index) const;
+    // Обратное изменение: удаление вставленного или вставка удалённого
+    IndexShift inverted() const;
+
+private:
+    int find(int index) const;
+
+    QVector<IndexRange> spans;
+    QVector<int> before; // Суммарная длина участков перед каждым
+    bool removal;
+};
+
+#endif // INDEXSHIFT_H
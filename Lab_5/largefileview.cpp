@@ -0,0 +1,464 @@
+#include "largefileview.h"
+
+#include <QFontDatabase>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+static const qint64 IndexBlockSize = 8 * 1024 * 1024; // Объём файла между отчётами индексатора
+static const qint64 SearchChunkSize = 4 * 1024 * 1024; // Окно поиска по файлу
+static const int MaxLineBytes = 4096;                  // Сколько байт длинной строки показывать
+
+LineIndexer::LineIndexer(const uchar *data, qint64 size, int stride, QObject *parent) : QObject(parent),
+                                                                                        data(data),
+                                                                                        size(size),
+                                                                                        stride(stride),
+                                                                                        cancelRequested(0)
+{
+    qRegisterMetaType<QVector<qint64>>("QVector<qint64>");
+}
+
+void LineIndexer::cancel()
+{
+    cancelRequested.storeRelease(1);
+}
+
+void LineIndexer::run()
+{
+    QVector<qint64> batch;
+    qint64 lineCount = 0;
+    if (size > 0)
+    {
+        batch.append(0);
+        lineCount = 1;
+    }
+
+    qint64 position = 0;
+    while (position < size)
+    {
+        if (cancelRequested.loadAcquire())
+        {
+            return;
+        }
+
+        const qint64 blockEnd = qMin(size, position + IndexBlockSize);
+        const uchar *cursor = data + position;
+        const uchar *end = data + blockEnd;
+        while (cursor < end)
+        {
+            const void *newLine = std::memchr(cursor, '\n', size_t(end - cursor));
+            if (!newLine)
+            {
+                break;
+            }
+
+            const qint64 next = static_cast<const uchar *>(newLine) - data + 1;
+            cursor = data + next;
+            if (next >= size)
+            {
+                break; // Перевод строки в конце файла не начинает новую строку
+            }
+
+            if (lineCount % stride == 0)
+            {
+                batch.append(next);
+            }
+            ++lineCount;
+        }
+
+        position = blockEnd;
+        emit indexed(batch, lineCount, position);
+        batch.clear();
+    }
+    emit finished();
+}
+
+// Сдвигает позицию назад к началу символа UTF-8
+static qint64 alignToCharStart(const uchar *data, qint64 size, qint64 position)
+{
+    while (position > 0 && position < size && (data[position] & 0xC0) == 0x80)
+    {
+        --position;
+    }
+    return position;
+}
+
+// Ищет текст в отображённом файле окнами фиксированного размера
+static LargeFileMatch findInMapped(const uchar *data, qint64 size, qint64 from, const QString &text,
+                                   bool forward, Qt::CaseSensitivity cs, QAtomicInt *cancel)
+{
+    LargeFileMatch none = {-1, 0};
+    const QByteArray needle = text.toUtf8();
+    if (needle.isEmpty() || !data)
+    {
+        return none;
+    }
+
+    // Окна перекрываются, чтобы не пропустить совпадение на их границе
+    const qint64 overlap = needle.size() * 2 + 8;
+
+    auto searchWindow = [&](qint64 start, qint64 windowEnd, qint64 limit) -> LargeFileMatch
+    {
+        QByteArray window = QByteArray::fromRawData(reinterpret_cast<const char *>(data + start), int(windowEnd - start));
+        if (cs == Qt::CaseSensitive)
+        {
+            int index = forward ? window.indexOf(needle) : window.lastIndexOf(needle, int(limit - start) - 1);
+            if (index >= 0 && (forward || start + index < limit))
+            {
+                LargeFileMatch found = {start + index, needle.size()};
+                return found;
+            }
+            return none;
+        }
+
+        QString chunk = QString::fromUtf8(window);
+        int index = -1;
+        if (forward)
+        {
+            index = chunk.indexOf(text, 0, cs);
+        }
+        else
+        {
+            int charLimit = QString::fromUtf8(window.constData(), int(limit - start)).size();
+            index = charLimit > 0 ? chunk.lastIndexOf(text, charLimit - 1, cs) : -1;
+        }
+        if (index < 0)
+        {
+            return none;
+        }
+        LargeFileMatch found = {start + chunk.leftRef(index).toUtf8().size(),
+                                chunk.midRef(index, text.size()).toUtf8().size()};
+        return found;
+    };
+
+    if (forward)
+    {
+        qint64 start = from;
+        while (start < size)
+        {
+            if (cancel->loadAcquire())
+            {
+                return none;
+            }
+            const qint64 windowEnd = alignToCharStart(data, size, qMin(size, start + SearchChunkSize + overlap));
+            LargeFileMatch found = searchWindow(start, windowEnd, size);
+            if (found.offset >= 0)
+            {
+                return found;
+            }
+            if (windowEnd >= size)
+            {
+                break;
+            }
+            start = alignToCharStart(data, size, start + SearchChunkSize);
+        }
+    }
+    else
+    {
+        qint64 end = from;
+        while (end > 0)
+        {
+            if (cancel->loadAcquire())
+            {
+                return none;
+            }
+            const qint64 start = alignToCharStart(data, size, qMax<qint64>(0, end - SearchChunkSize));
+            const qint64 windowEnd = alignToCharStart(data, size, qMin(size, end + overlap));
+            LargeFileMatch found = searchWindow(start, windowEnd, end);
+            if (found.offset >= 0)
+            {
+                return found;
+            }
+            end = start;
+        }
+    }
+    return none;
+}
+
+LargeFileView::LargeFileView(QWidget *parent) : QAbstractScrollArea(parent),
+                                                data(nullptr),
+                                                size(0),
+                                                lines(0),
+                                                indexedBytes(0),
+                                                pendingOffset(-1),
+                                                searchOrigin(-1),
+                                                searchCancel(0),
+                                                contentWidth(0)
+{
+    match.offset = -1;
+    match.length = 0;
+
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    viewport()->setBackgroundRole(QPalette::Base);
+
+    // Пользователь прокрутил файл: следующий поиск идёт от первой видимой строки
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int line)
+            {
+                if (line < lines)
+                {
+                    searchOrigin = lineStart(line);
+                } });
+
+    connect(&searchWatcher, &QFutureWatcher<LargeFileMatch>::finished, this, [this]()
+            {
+                LargeFileMatch found = searchWatcher.result();
+                if (found.offset >= 0)
+                {
+                    showMatch(found);
+                }
+                emit searchFinished(found.offset >= 0); });
+}
+
+LargeFileView::~LargeFileView()
+{
+    // Фоновые задачи читают отображённую память, дожидаемся их до закрытия файла
+    searchCancel.storeRelease(1);
+    searchWatcher.waitForFinished();
+
+    if (indexer)
+    {
+        indexer->cancel();
+    }
+    if (indexThread)
+    {
+        indexThread->quit();
+        indexThread->wait();
+    }
+
+    if (data)
+    {
+        file.unmap(const_cast<uchar *>(data));
+    }
+}
+
+bool LargeFileView::open(const QString &filePath)
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    size = file.size();
+    if (size > 0)
+    {
+        data = file.map(0, size);
+        if (!data)
+        {
+            return false;
+        }
+    }
+
+    indexThread = new QThread;
+    indexer = new LineIndexer(data, size, IndexStride);
+    indexer->moveToThread(indexThread);
+
+    connect(indexThread, &QThread::started, indexer, &LineIndexer::run);
+    connect(indexer, &LineIndexer::indexed, this, &LargeFileView::appendIndex);
+    connect(indexer, &LineIndexer::finished, indexThread, &QThread::quit);
+    connect(indexThread, &QThread::finished, indexer, &QObject::deleteLater);
+    connect(indexThread, &QThread::finished, indexThread, &QObject::deleteLater);
+
+    indexThread->start();
+    return true;
+}
+
+void LargeFileView::find(const QString &text, bool forward, Qt::CaseSensitivity cs)
+{
+    if (searchWatcher.isRunning() || text.isEmpty())
+    {
+        return;
+    }
+
+    qint64 from = 0;
+    if (searchOrigin >= 0)
+    {
+        from = searchOrigin;
+    }
+    else if (match.offset >= 0)
+    {
+        from = forward ? match.offset + match.length : match.offset;
+    }
+    else if (lines > 0)
+    {
+        from = lineStart(verticalScrollBar()->value());
+    }
+
+    const uchar *mapped = data;
+    const qint64 mappedSize = size;
+    QAtomicInt *cancel = &searchCancel;
+    searchWatcher.setFuture(QtConcurrent::run([=]()
+                                              { return findInMapped(mapped, mappedSize, from, text, forward, cs, cancel); }));
+}
+
+void LargeFileView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), palette().base());
+    if (!data || lines == 0)
+    {
+        return;
+    }
+
+    const QFontMetrics metrics(font());
+    const int lineHeight = metrics.height();
+    const int visibleLines = viewport()->height() / lineHeight + 2;
+    const int x = 4 - horizontalScrollBar()->value();
+    const qint64 firstLine = verticalScrollBar()->value();
+    int widest = contentWidth;
+
+    painter.setFont(font());
+    qint64 start = lineStart(firstLine);
+    for (int i = 0; i < visibleLines && firstLine + i < lines && start < size; ++i)
+    {
+        const qint64 end = lineEnd(start);
+        qint64 shownEnd = end;
+        if (shownEnd > start && data[shownEnd - 1] == '\r')
+        {
+            --shownEnd;
+        }
+        shownEnd = qMin(shownEnd, start + MaxLineBytes);
+
+        const char *bytes = reinterpret_cast<const char *>(data);
+        const QString text = QString::fromUtf8(bytes + start, int(shownEnd - start));
+        const int y = i * lineHeight;
+
+        // Подсвечиваем найденное совпадение
+        if (match.offset >= 0 && match.offset < shownEnd && match.offset + match.length > start)
+        {
+            const qint64 highlightStart = qMax(match.offset, start);
+            const qint64 highlightEnd = qMin(match.offset + match.length, shownEnd);
+            const int left = metrics.horizontalAdvance(QString::fromUtf8(bytes + start, int(highlightStart - start)));
+            const int width = metrics.horizontalAdvance(QString::fromUtf8(bytes + highlightStart, int(highlightEnd - highlightStart)));
+            painter.fillRect(QRect(x + left, y, width, lineHeight), palette().highlight());
+        }
+
+        painter.setPen(palette().text().color());
+        painter.drawText(x, y + metrics.ascent(), text);
+        widest = qMax(widest, metrics.horizontalAdvance(text) + 8);
+
+        start = end + 1;
+    }
+
+    if (widest != contentWidth)
+    {
+        contentWidth = widest;
+        updateScrollBars();
+    }
+}
+
+void LargeFileView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void LargeFileView::mousePressEvent(QMouseEvent *event)
+{
+    // Щелчок по строке переносит начало следующего поиска на неё
+    const qint64 line = verticalScrollBar()->value() + event->pos().y() / fontMetrics().height();
+    if (line < lines)
+    {
+        searchOrigin = lineStart(line);
+    }
+    QAbstractScrollArea::mousePressEvent(event);
+}
+
+void LargeFileView::appendIndex(const QVector<qint64> &newCheckpoints, qint64 lineCount, qint64 indexed)
+{
+    const qint64 previousLines = lines;
+    checkpoints += newCheckpoints;
+    lines = lineCount;
+    indexedBytes = indexed;
+    updateScrollBars();
+
+    if (pendingOffset >= 0 && (pendingOffset < indexedBytes || indexedBytes == size))
+    {
+        LargeFileMatch pending = match;
+        pendingOffset = -1;
+        showMatch(pending);
+    }
+    else if (verticalScrollBar()->value() + verticalScrollBar()->pageStep() >= previousLines)
+    {
+        viewport()->update(); // Новые строки попали в видимую область
+    }
+}
+
+void LargeFileView::showMatch(const LargeFileMatch &found)
+{
+    match = found;
+
+    // Строку совпадения можно найти только в уже проиндексированной части файла
+    searchOrigin = -1;
+    if (found.offset >= indexedBytes && indexedBytes < size)
+    {
+        pendingOffset = found.offset;
+        return;
+    }
+
+    const qint64 line = lineForOffset(found.offset);
+    const int pageLines = qMax(1, viewport()->height() / fontMetrics().height());
+    verticalScrollBar()->setValue(int(qMin<qint64>(INT_MAX, qMax<qint64>(0, line - pageLines / 2))));
+    searchOrigin = -1; // Прокрутка к совпадению не сдвигает начало поиска
+
+    const qint64 start = lineStart(line);
+    const int left = fontMetrics().horizontalAdvance(
+        QString::fromUtf8(reinterpret_cast<const char *>(data + start), int(qMin<qint64>(found.offset - start, MaxLineBytes))));
+    if (left < horizontalScrollBar()->value() || left > horizontalScrollBar()->value() + viewport()->width() - 16)
+    {
+        horizontalScrollBar()->setValue(qMax(0, left - viewport()->width() / 2));
+    }
+    viewport()->update();
+}
+
+void LargeFileView::updateScrollBars()
+{
+    const int pageLines = qMax(1, viewport()->height() / fontMetrics().height());
+    verticalScrollBar()->setPageStep(pageLines);
+    verticalScrollBar()->setSingleStep(1);
+    verticalScrollBar()->setRange(0, int(qMin<qint64>(INT_MAX, qMax<qint64>(0, lines - pageLines))));
+
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(fontMetrics().averageCharWidth() * 4);
+    horizontalScrollBar()->setRange(0, qMax(0, contentWidth - viewport()->width()));
+}
+
+qint64 LargeFileView::lineStart(qint64 line) const
+{
+    const int checkpoint = int(qMin<qint64>(line / IndexStride, checkpoints.size() - 1));
+    qint64 start = checkpoints.at(checkpoint);
+    for (qint64 current = qint64(checkpoint) * IndexStride; current < line && start < size; ++current)
+    {
+        start = lineEnd(start) + 1;
+    }
+    return start;
+}
+
+qint64 LargeFileView::lineEnd(qint64 start) const
+{
+    const void *newLine = std::memchr(data + start, '\n', size_t(size - start));
+    return newLine ? static_cast<const uchar *>(newLine) - data : size;
+}
+
+qint64 LargeFileView::lineForOffset(qint64 offset) const
+{
+    auto it = std::upper_bound(checkpoints.constBegin(), checkpoints.constEnd(), offset);
+    const int checkpoint = qMax(0, int(it - checkpoints.constBegin()) - 1);
+
+    qint64 line = qint64(checkpoint) * IndexStride;
+    qint64 start = checkpoints.at(checkpoint);
+    qint64 end = lineEnd(start);
+    while (end < offset && end + 1 < size)
+    {
+        start = end + 1;
+        end = lineEnd(start);
+        ++line;
+    }
+    return line;
+}
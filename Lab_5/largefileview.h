@@ -0,0 +1,101 @@
+#ifndef LARGEFILEVIEW_H
+#define LARGEFILEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QAtomicInt>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QThread>
+#include <QVector>
+
+// Найденное совпадение в отображённом файле (смещение и длина в байтах)
+struct LargeFileMatch
+{
+    qint64 offset;
+    qint64 length;
+};
+
+// Фоновый индексатор строк.
+// Запоминает начало каждой IndexStride-й строки, остальные строки
+// находятся по требованию коротким просмотром от ближайшей отметки.
+class LineIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    LineIndexer(const uchar *data, qint64 size, int stride, QObject *parent = nullptr);
+
+    void cancel();
+
+public slots:
+    void run();
+
+signals:
+    void indexed(const QVector<qint64> &checkpoints, qint64 lineCount, qint64 indexedBytes);
+    void finished();
+
+private:
+    const uchar *data;
+    qint64 size;
+    int stride;
+    QAtomicInt cancelRequested;
+};
+
+// Просмотр больших текстовых файлов только для чтения.
+// Файл отображается в память, строки индексируются в фоне,
+// а отрисовываются только строки, видимые в окне.
+class LargeFileView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LargeFileView(QWidget *parent = nullptr);
+    ~LargeFileView() override;
+
+    static const qint64 Threshold = 64 * 1024 * 1024; // Файлы больше этого размера открываются в режиме просмотра
+    static const int IndexStride = 64;                 // Через сколько строк запоминается отметка индекса
+
+    bool open(const QString &filePath);
+    QString filePath() const { return file.fileName(); }
+    qint64 lineCount() const { return lines; }
+
+    // Асинхронный поиск по всему файлу от текущего совпадения; после прокрутки
+    // или щелчка по строке - от первой видимой или выбранной строки
+    void find(const QString &text, bool forward, Qt::CaseSensitivity cs);
+
+signals:
+    void searchFinished(bool found);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private:
+    void appendIndex(const QVector<qint64> &newCheckpoints, qint64 lineCount, qint64 indexed);
+    void showMatch(const LargeFileMatch &match);
+    void updateScrollBars();
+    qint64 lineStart(qint64 line) const;
+    qint64 lineEnd(qint64 start) const;
+    qint64 lineForOffset(qint64 offset) const;
+
+    QFile file;
+    const uchar *data;
+    qint64 size;
+
+    QVector<qint64> checkpoints; // Начало каждой IndexStride-й строки
+    qint64 lines;
+    qint64 indexedBytes;
+    QPointer<LineIndexer> indexer;
+    QPointer<QThread> indexThread;
+
+    LargeFileMatch match;
+    qint64 pendingOffset; // Совпадение за пределами проиндексированной части
+    qint64 searchOrigin;  // Начало следующего поиска, выбранное пользователем; -1 - от совпадения
+    QFutureWatcher<LargeFileMatch> searchWatcher;
+    QAtomicInt searchCancel;
+    int contentWidth;
+};
+
+#endif // LARGEFILEVIEW_H
@@ -1,12 +1,63 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
-QTemporaryFile MainWindow::tempFile;
+// Модель таблицы, открытой во вкладке, или nullptr для остальных вкладок
+static TableModel *tableModelOf(QWidget *widget)
+{
+    QTableView *view = qobject_cast<QTableView *>(widget);
+    return view ? qobject_cast<TableModel *>(view->model()) : nullptr;
+}
+
+// Строки (Qt::Vertical) или столбцы выделения непрерывными участками; без
+// выделения - строка или столбец текущей ячейки
+static QVector<IndexRange> selectedRanges(QTableView *view, Qt::Orientation orientation)
+{
+    QVector<IndexRange> ranges;
+    for (const QItemSelectionRange &range : view->selectionModel()->selection())
+    {
+        ranges.append(orientation == Qt::Vertical ? IndexRange{range.top(), range.height()}
+                                                  : IndexRange{range.left(), range.width()});
+    }
+    const QModelIndex current = view->currentIndex();
+    if (ranges.isEmpty() && current.isValid())
+    {
+        ranges.append(orientation == Qt::Vertical ? IndexRange{current.row(), 1} : IndexRange{current.column(), 1});
+    }
+    // Пересекающиеся участки выделения сливаются
+    return IndexShift(ranges, true).ranges();
+}
+
+// Прямоугольники выделения в строках представления; без выделения - текущая ячейка
+static QVector<CellRange> selectedRects(QTableView *view)
+{
+    QVector<CellRange> rects;
+    for (const QItemSelectionRange &range : view->selectionModel()->selection())
+    {
+        rects.append(CellRange{range.top(), range.left(), range.bottom(), range.right()});
+    }
+    const QModelIndex current = view->currentIndex();
+    if (rects.isEmpty() && current.isValid())
+    {
+        rects.append(CellRange{current.row(), current.column(), current.row(), current.column()});
+    }
+    return rects;
+}
+
+// Индикатор сортировки в заголовке по ключам модели
+static void showSortIndicator(QTableView *view, const TableModel *model)
+{
+    QHeaderView *header = view->horizontalHeader();
+    header->setSortIndicatorShown(!model->sortKeys().isEmpty());
+    if (!model->sortKeys().isEmpty())
+    {
+        header->setSortIndicator(model->sortKeys().first().column, model->sortKeys().first().order);
+    }
+}
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent),
                                           ui(new Ui::MainWindow),
                                           editor(new QTextEdit),
-                                          tableWidget(new QTableWidget),
+                                          tableView(nullptr),
                                           tableModified(false),
                                           graphicEditor(nullptr)
 {
@@ -14,8 +65,6 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent),
     ui->tabWidget->setTabsClosable(true);
     connect(ui->tabWidget, &QTabWidget::tabCloseRequested, this, &MainWindow::closeTab);
 
-    connect(tableWidget, &QTableWidget::cellChanged, this, &MainWindow::onTableCellChanged);
-
     QWidget *centralWidget = new QWidget(this);
     this->setCentralWidget(centralWidget);
     QVBoxLayout *layout = new QVBoxLayout();
@@ -50,6 +99,7 @@ void MainWindow::on_CreateNewFile_triggered()
     format.setBackground(Qt::white);
     newEdit->setCurrentCharFormat(format);
     newEdit->document()->setModified(false);
+    EditJournal::forDocument(newEdit->document());
 }
 
 void MainWindow::on_OpenFile_triggered()
@@ -83,98 +133,21 @@ void MainWindow::on_OpenFile_triggered()
 
     if (fileName.endsWith(".csv", Qt::CaseInsensitive))
     {
-        QFile file(fileName);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-        {
-            QMessageBox::warning(nullptr, QObject::tr("Ошибка"), QObject::tr("Не удалось открыть CSV файл"));
-            return;
-        }
-
-        QTextStream in(&file);
-        QStringList lines;
-        while (!in.atEnd())
-        {
-            lines.append(in.readLine());
-        }
-        file.close();
-
-        int rows = lines.size();
-        int columns = !lines.isEmpty() ? lines.first().split(",").size() : 0;
-
-        if (rows == 0 || columns == 0)
-        {
-            QMessageBox::warning(nullptr, QObject::tr("Ошибка"), QObject::tr("Файл CSV пуст или имеет неправильный формат"));
-            return;
-        }
-
-        if (tableWidget)
-        {
-            tableWidget->clear();
-            tableWidget->setRowCount(0);
-            tableWidget->setColumnCount(0);
-        }
-
-        QTableWidget *newTableWidget = new QTableWidget(rows, columns);
-        newTableWidget->setWindowTitle(fileName);
-        if (!tableWidget)
+        openCsvFile(fileName);
+    }
+    else if (QFileInfo(fileName).size() >= LargeFileView::Threshold)
+    {
+        // Очень большие файлы открываются только для чтения без загрузки в QTextEdit
+        LargeFileView *largeFileView = new LargeFileView();
+        if (!largeFileView->open(fileName))
         {
-            QMessageBox::warning(nullptr, QObject::tr("Ошибка"), QObject::tr("Не удалось создать таблицу"));
+            delete largeFileView;
+            QMessageBox::warning(nullptr, QObject::tr("Ошибка"), QObject::tr("Не удалось открыть файл"));
             return;
         }
 
-        for (int i = 0; i < rows; ++i)
-        {
-            QStringList cells = lines.at(i).split(",");
-            if (cells.size() != columns)
-            {
-                QMessageBox::warning(nullptr, QObject::tr("Ошибка"), QObject::tr("Некорректный CSV файл: строки содержат разное количество столбцов"));
-                delete newTableWidget;
-                return;
-            }
-
-            for (int j = 0; j < cells.size(); ++j)
-            {
-                newTableWidget->setItem(i, j, new QTableWidgetItem(cells.at(j)));
-            }
-        }
-        QFileInfo fileInfo(fileName);
-        QString relativePath = "../Visual_Lab5/Lab_5/tabSettings";
-        QDir settingsDir(relativePath);
-        QString jsonFilePath = settingsDir.absoluteFilePath(fileInfo.fileName() + ".json");
-        QFile settingsFile(jsonFilePath);
-        if (settingsFile.exists() && settingsFile.open(QIODevice::ReadOnly))
-        {
-            QByteArray settingsData = settingsFile.readAll();
-            settingsFile.close();
-
-            QJsonDocument settingsDoc = QJsonDocument::fromJson(settingsData);
-            QJsonArray cellSettingsArray = settingsDoc.array();
-
-            for (int i = 0; i < cellSettingsArray.size(); ++i)
-            {
-                QJsonArray rowSettings = cellSettingsArray[i].toArray();
-                for (int j = 0; j < rowSettings.size(); ++j)
-                {
-                    QTableWidgetItem *item = newTableWidget->item(i, j);
-                    if (item)
-                    {
-                        QJsonObject cellSettings = rowSettings[j].toObject();
-                        item->setForeground(QColor(cellSettings["textColor"].toString()));
-                        item->setBackground(QColor(cellSettings["backgroundColor"].toString()));
-                        QFont font;
-                        font.fromString(cellSettings["font"].toString());
-                        item->setFont(font);
-                        qDebug() << "Restoring font: " << cellSettings["font"].toString();
-                        item->setTextAlignment(cellSettings["alignment"].toInt());
-                    }
-                }
-            }
-        }
-
-        pageIndex = ui->tabWidget->addTab(newTableWidget, QFileInfo(fileName).fileName());
+        pageIndex = ui->tabWidget->addTab(largeFileView, QFileInfo(fileName).fileName() + tr(" (только чтение)"));
         ui->tabWidget->setCurrentIndex(pageIndex);
-        connect(newTableWidget, &QTableWidget::cellChanged, this, &MainWindow::onTableCellChanged);
-        newTableWidget->setProperty("modified", false);
     }
     else
     {
@@ -186,241 +159,152 @@ void MainWindow::on_OpenFile_triggered()
             return;
         }
 
-        QTextStream in(&file);
-        QString fileContent = in.readAll();
-        file.close();
-
         QTextEdit *newEdit = new QTextEdit();
-        newEdit->setText(fileContent);
 
         int pageIndex = ui->tabWidget->addTab(newEdit, QFileInfo(fileName).fileName());
         ui->tabWidget->setCurrentIndex(pageIndex);
         pageIndex = ui->tabWidget->currentIndex();
 
         editor = qobject_cast<QTextEdit *>(ui->tabWidget->currentWidget());
-        loadTextSettings(fileName);
+        // Оформленный документ загружается за один проход, сам файл читается,
+        // только если актуального файла оформления нет
+        if (!loadTextSettings(fileName))
+        {
+            QTextStream in(&file);
+            editor->setText(in.readAll());
+        }
+        file.close();
         editor->document()->setModified(false);
+
+        // Журнал правок, оставшийся после аварийного завершения
+        if (EditJournal::hasJournal(fileName) &&
+            QMessageBox::question(this, tr("Восстановление"),
+                                  tr("Найдены несохранённые изменения файла \"%1\". Восстановить?").arg(QFileInfo(fileName).fileName()),
+                                  QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes)
+        {
+            if (EditJournal::recover(editor->document(), fileName))
+            {
+                editor->document()->setModified(true);
+            }
+        }
+        EditJournal::forDocument(editor->document(), fileName);
     }
     pageIndex = ui->tabWidget->currentIndex();
     ui->tabWidget->setTabToolTip(pageIndex, fileName);
 }
 
-void MainWindow::on_SaveFile_triggered()
+void MainWindow::openCsvFile(const QString &fileName)
 {
-    QWidget *currentWidget = ui->tabWidget->currentWidget();
-    if (!currentWidget)
-    {
-        QMessageBox::warning(this, tr("Ошибка"), tr("Нет открытой вкладки для сохранения"));
-        return;
-    }
+    // Вкладка с таблицей появляется сразу и заполняется по мере чтения файла
+    TableModel *model = new TableModel();
+    QTableView *newTableView = createTableView(model);
+    newTableView->setWindowTitle(fileName);
 
-    // Определяем тип виджета
-    editor = qobject_cast<QTextEdit *>(currentWidget);
-    QTableWidget *tableWidget = qobject_cast<QTableWidget *>(currentWidget);
+    pageIndex = ui->tabWidget->addTab(newTableView, QFileInfo(fileName).fileName());
+    ui->tabWidget->setCurrentIndex(pageIndex);
+    ui->tabWidget->setTabToolTip(pageIndex, fileName);
 
-    QString filePath = ui->tabWidget->tabToolTip(ui->tabWidget->currentIndex()); // Получаем путь к файлу из tabToolTip
+    QProgressDialog *progressDialog = new QProgressDialog(tr("Загрузка %1...").arg(QFileInfo(fileName).fileName()),
+                                                          tr("Отмена"), 0, 100, newTableView);
+    progressDialog->setWindowModality(Qt::NonModal);
+    progressDialog->setMinimumDuration(300);
 
-    if (editor)
-    {
-        // Обработка для текстового редактора
-        if (!filePath.isEmpty())
-        {
-            // Если файл существует, сохраняем изменения без диалога
-            QFile file(filePath);
-            if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                QMessageBox::warning(nullptr, "Ошибка", "Не удалось сохранить текстовый файл");
-                return;
-            }
+    QThread *thread = new QThread;
+    CsvLoader *loader = new CsvLoader(fileName);
+    loader->moveToThread(thread);
 
-            QTextStream out(&file);
-            out << editor->toPlainText();
-            file.close();
-            saveTextSettings(filePath);
-        }
-        else
-        {
-            // Если файл новый, вызываем диалог сохранения
-            filePath = QFileDialog::getSaveFileName(this, tr("Сохранить файл"), "", tr("Text Files (*.txt);;All Files (*)"));
-            if (filePath.isEmpty())
-            {
-                return;
-            }
-
-            QFile file(filePath);
-            if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                QMessageBox::warning(nullptr, "Ошибка", "Не удалось сохранить текстовый файл");
-                return;
-            }
-
-            QTextStream out(&file);
-            out << editor->toPlainText();
-            file.close();
-            saveTextSettings(filePath);
-            // Устанавливаем путь в качестве подсказки на вкладке
-            ui->tabWidget->setTabToolTip(ui->tabWidget->currentIndex(), filePath);
-            ui->tabWidget->setTabText(ui->tabWidget->currentIndex(), QFileInfo(filePath).fileName());
-        }
-        editor->document()->setModified(false); // Снимаем флаг изменения документа
-    }
-    else if (tableWidget && tableWidget->property("modified").toBool())
+    // Убираем вкладку, если загрузка не удалась или была отменена
+    auto discardTab = [this, newTableView]()
     {
-        // Обработка для таблицы
-        if (!filePath.isEmpty())
+        int index = ui->tabWidget->indexOf(newTableView);
+        if (index != -1)
         {
-            // Если файл существует, сохраняем изменения без диалога
-            QFile file(filePath);
-            if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
-            {
-                QMessageBox::warning(nullptr, QObject::tr("Ошибка"), QObject::tr("Не удалось открыть файл для записи"));
-                return;
-            }
-
-            QTextStream out(&file);
-            int rows = tableWidget->rowCount();
-            int columns = tableWidget->columnCount();
-
-            // Записываем данные таблицы в файл
-            QJsonArray cellSettingsArray;
-            for (int i = 0; i < rows; ++i)
-            {
-                QStringList rowContents;
-                QJsonArray rowCellSettings;
-
-                for (int j = 0; j < columns; ++j)
-                {
-                    QTableWidgetItem *item = tableWidget->item(i, j);
-
-                    // Проверка на nullptr
-                    if (!item)
-                    {
-                        item = new QTableWidgetItem(""); // Создаем пустую ячейку, если она не существует
-                        tableWidget->setItem(i, j, item);
-                    }
-
-                    QString cellText = item->text();
-                    rowContents << cellText;
-
-                    // Сохраняем настройки ячейки
-                    QJsonObject cellSettings;
-                    cellSettings["textColor"] = item->foreground().color().name();
-                    cellSettings["backgroundColor"] = item->background().color().name();
-                    cellSettings["font"] = item->font().toString();
-                    qDebug() << item->font().toString();
-                    cellSettings["alignment"] = item->textAlignment();
-                    rowCellSettings.append(cellSettings);
-                }
-
-                out << rowContents.join(",") << "\n";
-                cellSettingsArray.append(rowCellSettings);
-            }
-
-            // Сохраняем настройки в JSON файл
-            QFileInfo fileInfo(filePath);
-            QString relativePath = "../Visual_Lab5/Lab_5/tabSettings";
-
-            QDir settingsDir(relativePath);
-            if (!settingsDir.exists() && !settingsDir.mkpath("."))
-            {
-                qDebug() << "Unable to create directory: " << settingsDir.absolutePath();
-                return;
-            }
-            QString jsonFilePath = settingsDir.absoluteFilePath(fileInfo.fileName() + ".json");
-            QFile settingsFile(jsonFilePath);
-            if (settingsFile.open(QIODevice::WriteOnly))
-            {
-                QJsonDocument settingsDoc(cellSettingsArray);
-                settingsFile.write(settingsDoc.toJson());
-                settingsFile.close();
-            }
-            tableWidget->setProperty("modified", false);
-            file.close();
+            ui->tabWidget->removeTab(index);
         }
-        else
-        {
-            // Если файл новый, вызываем диалог сохранения
-            filePath = QFileDialog::getSaveFileName(this, tr("Сохранить файл таблицы"), "", tr("CSV Files (*.csv);;All Files (*)"));
-            if (filePath.isEmpty())
-            {
-                return;
-            }
+        newTableView->deleteLater();
+    };
 
-            QFile file(filePath);
-            if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    connect(thread, &QThread::started, loader, &CsvLoader::run);
+    connect(loader, &CsvLoader::progress, progressDialog, &QProgressDialog::setValue);
+    connect(loader, &CsvLoader::delimiterDetected, model, &TableModel::setDelimiter);
+    connect(loader, &CsvLoader::rowsReady, model, &TableModel::appendRows);
+    connect(loader, &CsvLoader::finished, newTableView, [this, model, fileName, progressDialog]()
             {
-                QMessageBox::warning(nullptr, QObject::tr("Ошибка"), QObject::tr("Не удалось открыть файл для записи"));
-                return;
-            }
-
-            QTextStream out(&file);
-            int rows = tableWidget->rowCount();
-            int columns = tableWidget->columnCount();
-
-            // Записываем данные таблицы в файл
-            QJsonArray cellSettingsArray;
-            for (int i = 0; i < rows; ++i)
+                progressDialog->deleteLater();
+                applyTableSettings(model, fileName);
+                connect(model, &TableModel::dataChanged, this, [this](const QModelIndex &topLeft)
+                        { onTableCellChanged(topLeft.row(), topLeft.column()); }); });
+    connect(loader, &CsvLoader::failed, newTableView, [discardTab](const QString &message)
             {
-                QStringList rowContents;
-                QJsonArray rowCellSettings;
-
-                for (int j = 0; j < columns; ++j)
-                {
-                    QTableWidgetItem *item = tableWidget->item(i, j);
-
-                    // Проверка на nullptr
-                    if (!item)
-                    {
-                        item = new QTableWidgetItem(""); // Создаем пустую ячейку, если она не существует
-                        tableWidget->setItem(i, j, item);
-                    }
+                QMessageBox::warning(nullptr, QObject::tr("Ошибка"), message);
+                discardTab(); });
+    connect(loader, &CsvLoader::canceled, newTableView, discardTab);
 
-                    QString cellText = item->text();
-                    rowContents << cellText;
+    // Отмена из диалога или закрытие вкладки останавливают чтение в рабочем потоке
+    connect(progressDialog, &QProgressDialog::canceled, loader, &CsvLoader::cancel, Qt::DirectConnection);
+    connect(newTableView, &QObject::destroyed, loader, &CsvLoader::cancel, Qt::DirectConnection);
 
-                    // Сохраняем настройки ячейки
-                    QJsonObject cellSettings;
-                    cellSettings["textColor"] = item->foreground().color().name();
-                    cellSettings["backgroundColor"] = item->background().color().name();
-                    cellSettings["font"] = item->font().toString();
-                    cellSettings["alignment"] = item->textAlignment();
-                    rowCellSettings.append(cellSettings);
-                }
+    connect(loader, &CsvLoader::finished, thread, &QThread::quit);
+    connect(loader, &CsvLoader::canceled, thread, &QThread::quit);
+    connect(loader, &CsvLoader::failed, thread, &QThread::quit);
+    connect(thread, &QThread::finished, loader, &QObject::deleteLater);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
 
-                out << rowContents.join(",") << "\n";
-                cellSettingsArray.append(rowCellSettings);
-            }
+    thread->start();
+}
 
-            // Сохраняем настройки в JSON файл
-            QFileInfo fileInfo(filePath);
-            QString relativePath = "../Visual_Lab5/Lab_5/tabSettings";
+QTableView *MainWindow::createTableView(TableModel *model)
+{
+    QTableView *view = new QTableView();
+    model->setParent(view);
+    view->setModel(model);
+    view->setProperty("modified", false);
+
+    // Щелчок по заголовку столбца сортирует таблицу в рабочем потоке
+    connect(view->horizontalHeader(), &QHeaderView::sectionClicked, this, [this, view](int column)
+            { sortTableByColumn(view, column); });
+    return view;
+}
 
-            QDir settingsDir(relativePath);
-            if (!settingsDir.exists() && !settingsDir.mkpath("."))
-            {
-                qDebug() << "Unable to create directory: " << settingsDir.absolutePath();
-                return;
-            }
-            QString jsonFilePath = settingsDir.absoluteFilePath(fileInfo.fileName() + ".json");
-            QFile settingsFile(jsonFilePath);
-            if (settingsFile.open(QIODevice::WriteOnly))
-            {
-                QJsonDocument settingsDoc(cellSettingsArray);
-                settingsFile.write(settingsDoc.toJson());
-                settingsFile.close();
-            }
+void MainWindow::applyTableSettings(TableModel *model, const QString &fileName)
+{
+    StyleSidecar::read(model, fileName);
+}
 
-            file.close();
-            // Устанавливаем путь в качестве подсказки на вкладке
-            ui->tabWidget->setTabToolTip(ui->tabWidget->currentIndex(), filePath);
-            ui->tabWidget->setTabText(ui->tabWidget->currentIndex(), QFileInfo(filePath).fileName());
-            tableWidget->setProperty("modified", false);
-        }
+void MainWindow::on_SaveFile_triggered()
+{
+    QWidget *currentWidget = ui->tabWidget->currentWidget();
+    if (!currentWidget)
+    {
+        QMessageBox::warning(this, tr("Ошибка"), tr("Нет открытой вкладки для сохранения"));
+        return;
     }
-    else
+
+    // Определяем тип виджета
+    editor = qobject_cast<QTextEdit *>(currentWidget);
+    QTableView *tableView = qobject_cast<QTableView *>(currentWidget);
+    if (!editor && !tableView)
     {
         QMessageBox::warning(this, tr("Ошибка"), tr("Текущая вкладка не поддерживает сохранение"));
+        return;
+    }
+    if (tableView && !tableView->property("modified").toBool())
+    {
+        return;
     }
+
+    QString filePath = ui->tabWidget->tabToolTip(ui->tabWidget->currentIndex()); // Получаем путь к файлу из tabToolTip
+    if (filePath.isEmpty())
+    {
+        // Если файл новый, вызываем диалог сохранения
+        filePath = editor ? QFileDialog::getSaveFileName(this, tr("Сохранить файл"), "", tr("Text Files (*.txt);;All Files (*)"))
+                          : QFileDialog::getSaveFileName(this, tr("Сохранить файл таблицы"), "", tr("CSV Files (*.csv);;All Files (*)"));
+        if (filePath.isEmpty())
+        {
+            return;
+        }
+    }
+    saveTab(currentWidget, filePath);
 }
 
 void MainWindow::on_SaveFileAs_triggered()
@@ -433,106 +317,105 @@ void MainWindow::on_SaveFileAs_triggered()
     }
 
     editor = qobject_cast<QTextEdit *>(currentWidget);
-    QTableWidget *tableWidget = qobject_cast<QTableWidget *>(currentWidget);
+    QTableView *tableView = qobject_cast<QTableView *>(currentWidget);
 
     QString filePath;
-    if (tableWidget)
+    if (tableView)
     {
         // Если активна таблица
         filePath = QFileDialog::getSaveFileName(this, tr("Сохранить файл таблицы как"), "", tr("CSV Files (*.csv);;All Files (*)"));
-        if (filePath.isEmpty())
-            return;
-
-        QFile file(filePath);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
-        {
-            QMessageBox::warning(this, tr("Ошибка"), tr("Не удалось открыть файл для записи"));
-            return;
-        }
-
-        QTextStream out(&file);
-        int rows = tableWidget->rowCount();
-        int columns = tableWidget->columnCount();
-
-        QJsonArray cellSettingsArray;
-        for (int i = 0; i < rows; ++i)
-        {
-            QStringList rowContents;
-            QJsonArray rowCellSettings;
-
-            for (int j = 0; j < columns; ++j)
-            {
-                QTableWidgetItem *item = tableWidget->item(i, j);
-
-                // Проверка на nullptr
-                if (!item)
-                {
-                    item = new QTableWidgetItem(""); // Создаем пустую ячейку, если она не существует
-                    tableWidget->setItem(i, j, item);
-                }
-
-                QString cellText = item->text();
-                rowContents << cellText;
-
-                // Сохраняем настройки ячейки
-                QJsonObject cellSettings;
-                cellSettings["textColor"] = item->foreground().color().name();
-                cellSettings["backgroundColor"] = item->background().color().name();
-                cellSettings["font"] = item->font().toString();
-                qDebug() << item->font().toString();
-                cellSettings["alignment"] = item->textAlignment();
-                rowCellSettings.append(cellSettings);
-            }
-
-            out << rowContents.join(",") << "\n";
-            cellSettingsArray.append(rowCellSettings);
-        }
-
-        // Сохраняем настройки в JSON файл
-        QFileInfo fileInfo(filePath);
-        QString relativePath = "../Visual_Lab5/Lab_5/tabSettings";
-
-        QDir settingsDir(relativePath);
-        if (!settingsDir.exists() && !settingsDir.mkpath("."))
-        {
-            qDebug() << "Unable to create directory: " << settingsDir.absolutePath();
-            return;
-        }
-        QString jsonFilePath = settingsDir.absoluteFilePath(fileInfo.fileName() + ".json");
-        QFile settingsFile(jsonFilePath);
-        if (settingsFile.open(QIODevice::WriteOnly))
-        {
-            QJsonDocument settingsDoc(cellSettingsArray);
-            settingsFile.write(settingsDoc.toJson());
-            settingsFile.close();
-        }
-
-        file.close();
-        ui->tabWidget->setTabToolTip(ui->tabWidget->currentIndex(), filePath);
-        ui->tabWidget->setTabText(ui->tabWidget->currentIndex(), QFileInfo(filePath).fileName());
     }
     else if (editor)
     {
         // Если активен текстовый редактор
         filePath = QFileDialog::getSaveFileName(this, tr("Сохранить файл как"), "", tr("Text Files (*.txt);;All Files (*)"));
-        if (filePath.isEmpty())
-            return;
+    }
+    if (filePath.isEmpty())
+        return;
 
-        QFile file(filePath);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
-        {
-            QMessageBox::warning(this, tr("Ошибка"), tr("Не удалось сохранить файл"));
-            return;
-        }
+    saveTab(currentWidget, filePath);
+}
 
-        QTextStream out(&file);
-        out << editor->toPlainText();
-        file.close();
-        saveTextSettings(filePath);
+void MainWindow::saveTab(QWidget *widget, const QString &filePath)
+{
+    if (widget->property("saving").toBool())
+    {
+        statusBar()->showMessage(tr("Сохранение уже выполняется"), 3000);
+        return;
+    }
+
+    QTextEdit *textEdit = qobject_cast<QTextEdit *>(widget);
+    QTableView *table = qobject_cast<QTableView *>(widget);
+    if (textEdit)
+    {
+        EditJournal::forDocument(textEdit->document())->saveStarted();
+    }
+    SaveJob *job = textEdit ? SaveJob::forText(textEdit->document(), filePath, this)
+                            : SaveJob::forTable(tableModelOf(table), filePath, this);
 
-        ui->tabWidget->setTabToolTip(ui->tabWidget->currentIndex(), filePath);
-        ui->tabWidget->setTabText(ui->tabWidget->currentIndex(), QFileInfo(filePath).fileName());
+    // Флаг изменения снимается сразу: правки во время сохранения выставят его снова
+    if (textEdit)
+    {
+        textEdit->document()->setModified(false);
     }
+    else
+    {
+        table->setProperty("modified", false);
+    }
+    widget->setProperty("saving", true);
+
+    QProgressBar *progressBar = new QProgressBar();
+    progressBar->setRange(0, 100);
+    progressBar->setMaximumWidth(200);
+    statusBar()->addPermanentWidget(progressBar);
+    statusBar()->showMessage(tr("Сохранение %1...").arg(QFileInfo(filePath).fileName()));
+    connect(job, &SaveJob::progress, progressBar, &QProgressBar::setValue);
+
+    // Вкладку могут закрыть, пока идёт запись
+    QPointer<QWidget> tab(widget);
+    connect(job, &SaveJob::finished, this, [this, job, progressBar, tab, filePath](bool ok, const QString &error)
+            {
+                statusBar()->removeWidget(progressBar);
+                progressBar->deleteLater();
+                job->deleteLater();
+                statusBar()->clearMessage();
+
+                QTextEdit *textEdit = qobject_cast<QTextEdit *>(tab.data());
+                QTableView *table = qobject_cast<QTableView *>(tab.data());
+                if (tab)
+                {
+                    tab->setProperty("saving", false);
+                }
+                if (!ok)
+                {
+                    if (textEdit)
+                    {
+                        textEdit->document()->setModified(true);
+                    }
+                    else if (table)
+                    {
+                        table->setProperty("modified", true);
+                    }
+                    QMessageBox::warning(this, tr("Ошибка"), error);
+                    return;
+                }
+
+                if (textEdit)
+                {
+                    // Сохранённые правки больше не нужно восстанавливать
+                    EditJournal *journal = EditJournal::forDocument(textEdit->document());
+                    journal->setFilePath(filePath);
+                    journal->saveCommitted();
+                }
+                const int index = ui->tabWidget->indexOf(tab);
+                if (index >= 0)
+                {
+                    // Устанавливаем путь в качестве подсказки на вкладке
+                    ui->tabWidget->setTabToolTip(index, filePath);
+                    ui->tabWidget->setTabText(index, QFileInfo(filePath).fileName());
+                }
+                statusBar()->showMessage(tr("Файл %1 сохранён").arg(QFileInfo(filePath).fileName()), 3000); });
+    job->start();
 }
 
 void MainWindow::closeTab(int index)
@@ -543,7 +426,7 @@ void MainWindow::closeTab(int index)
     {
         // Попытка преобразования в QTextEdit
         QTextEdit *editor = qobject_cast<QTextEdit *>(widget);
-        QTableWidget *table = qobject_cast<QTableWidget *>(widget);
+        QTableView *table = qobject_cast<QTableView *>(widget);
         QString filePath = ui->tabWidget->tabToolTip(index);
 
         // Проверка для QTextEdit
@@ -552,12 +435,18 @@ void MainWindow::closeTab(int index)
             ui->tabWidget->removeTab(index);
             editor->deleteLater(); // Используем deleteLater() вместо delete
         }
-        // Проверка для QTableWidget
-        else if (table && !tableWidget->property("modified").toBool())
+        // Проверка для таблицы
+        else if (table && !table->property("modified").toBool())
         {
             ui->tabWidget->removeTab(index);
             table->deleteLater(); // Используем deleteLater() вместо delete
         }
+        // Просмотр большого файла только читает его, сохранять нечего
+        else if (qobject_cast<LargeFileView *>(widget))
+        {
+            ui->tabWidget->removeTab(index);
+            widget->deleteLater();
+        }
         else
         {
             // Диалоговое окно для подтверждения действий
@@ -605,6 +494,12 @@ void MainWindow::on_Search_triggered()
     QWidget *currentWidget = ui->tabWidget->currentWidget();
     editor = qobject_cast<QTextEdit *>(currentWidget);
 
+    if (LargeFileView *largeFileView = qobject_cast<LargeFileView *>(currentWidget))
+    {
+        searchLargeFile(largeFileView);
+        return;
+    }
+
     if (!editor)
     {
         QMessageBox::warning(this, tr("Ошибка"), tr("Текущая вкладка не поддерживает поиск. Создайте файл с текстом"));
@@ -612,6 +507,9 @@ void MainWindow::on_Search_triggered()
     }
     editor->moveCursor(QTextCursor::Start);
 
+    // Индекс совпадений строится один раз в фоне и обновляется при правках документа
+    SearchEngine *engine = SearchEngine::forDocument(editor->document());
+
     // Создаем диалоговое окно
     QDialog searchDialog(this);
     searchDialog.setWindowTitle("Поиск");
@@ -631,6 +529,13 @@ void MainWindow::on_Search_triggered()
     QCheckBox *wholeWordCheckBox = new QCheckBox("Искать только полные слова", &searchDialog);
     layout->addWidget(wholeWordCheckBox);
 
+    QCheckBox *highlightCheckBox = new QCheckBox("Подсветить все", &searchDialog);
+    layout->addWidget(highlightCheckBox);
+
+    // Количество совпадений
+    QLabel *countLabel = new QLabel(&searchDialog);
+    layout->addWidget(countLabel);
+
     // Добавляем кнопки "Следующее" и "Предыдущее"
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     QPushButton *nextButton = new QPushButton("Следующее", &searchDialog);
@@ -642,112 +547,169 @@ void MainWindow::on_Search_triggered()
     QPushButton *closeButton = new QPushButton("Закрыть", &searchDialog);
     layout->addWidget(closeButton);
 
-    QRegularExpression cyrillicRegex("[\\p{Cyrillic}]");
-    QRegularExpression latinRegex("[a-zA-Z]");
+    // Параметры поиска передаются движку при каждом изменении, индекс перестраивается в фоне
+    auto updateQuery = [&]()
+    {
+        engine->setQuery(searchLineEdit->text(),
+                         caseSensitiveCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive,
+                         wholeWordCheckBox->isChecked());
+    };
+
+    // Подсвечиваем только совпадения, попадающие в видимую часть документа
+    auto highlightVisible = [&]()
+    {
+        QList<QTextEdit::ExtraSelection> selections;
+        const int length = engine->patternLength();
+        if (highlightCheckBox->isChecked() && length > 0)
+        {
+            const int first = editor->cursorForPosition(QPoint(0, 0)).position();
+            const int last = editor->cursorForPosition(QPoint(editor->viewport()->width(), editor->viewport()->height())).position();
+            const QVector<int> &positions = engine->positions();
+
+            QTextCharFormat format;
+            format.setBackground(Qt::yellow);
+            for (auto it = std::lower_bound(positions.constBegin(), positions.constEnd(), first - length);
+                 it != positions.constEnd() && *it <= last; ++it)
+            {
+                QTextEdit::ExtraSelection selection;
+                selection.cursor = QTextCursor(editor->document());
+                selection.cursor.setPosition(*it);
+                selection.cursor.setPosition(*it + length, QTextCursor::KeepAnchor);
+                selection.format = format;
+                selections.append(selection);
+            }
+        }
+        editor->setExtraSelections(selections);
+    };
+
+    // Переход, запрошенный до готовности индекса: 1 - вперёд, -1 - назад
+    int pendingSearch = 0;
 
     //     Лямбда-функция для поиска текста
     auto search = [&](bool forward)
     {
-        QString searchText = searchLineEdit->text();
-
-        if (searchText.isEmpty())
+        if (searchLineEdit->text().isEmpty())
         {
             QMessageBox::information(&searchDialog, "Поиск", "Введите текст для поиска.");
             return;
         }
+        updateQuery();
 
-        // Устанавливаем флаги поиска
-        QTextDocument::FindFlags findFlags;
-        if (caseSensitiveCheckBox->isChecked())
+        // Индекс ещё строится: переход выполнится, когда он будет готов
+        if (!engine->isReady())
         {
-            findFlags |= QTextDocument::FindCaseSensitively;
+            pendingSearch = forward ? 1 : -1;
+            countLabel->setText("Идёт поиск...");
+            return;
         }
 
-        // Если ищем назад, добавляем флаг FindBackward
+        // Ищем следующее совпадение после выделения или предыдущее до него
         QTextCursor cursor = editor->textCursor();
-        QTextDocument *document = editor->document();
-
-        // Если ищем назад
-        if (!forward)
+        int index = forward ? engine->nextMatch(cursor.selectionEnd())
+                            : engine->previousMatch(cursor.selectionStart());
+        if (index < 0)
         {
-            findFlags |= QTextDocument::FindBackward;
-
-            // Проверяем позицию курсора и сдвигаем его на один символ назад, чтобы избежать повторного поиска
-            int currentPosition = cursor.position();
-            if (currentPosition > 0)
-            {
-                cursor.movePosition(QTextCursor::PreviousCharacter);
-                editor->setTextCursor(cursor);
-            }
+            QMessageBox::information(&searchDialog, "Поиск", "Текст не найден.");
+            return;
         }
 
-        // Проверяем, установлен ли флажок "Искать только полные слова"
-        if (wholeWordCheckBox->isChecked())
-        {
-            // Используем регулярное выражение для поиска только целых слов
-            //            QRegularExpression regex("\\b" + QRegularExpression::escape(searchText) + "\\b");
-            QRegularExpression regex;
-            if (cyrillicRegex.match(searchText).hasMatch())
-            {
-                regex.setPattern("((?<![\\p{L}\\d_])" + QRegularExpression::escape(searchText) + "(?![\\p{L}\\d_]))");
+        int position = engine->positions().at(index);
+        cursor.setPosition(position);
+        cursor.setPosition(position + engine->patternLength(), QTextCursor::KeepAnchor);
+        editor->setStyleSheet("selection-background-color: blue; selection-color: white");
+        editor->setTextCursor(cursor);
+        countLabel->setText(QString("Совпадение %1 из %2").arg(index + 1).arg(engine->count()));
+    };
 
-                //                regex.setPattern("(?<!\\w)" + QRegularExpression::escape(searchText) + "(?!\\w)");
-            }
-            else
+    connect(searchLineEdit, &QLineEdit::textChanged, &searchDialog, updateQuery);
+    connect(caseSensitiveCheckBox, &QCheckBox::toggled, &searchDialog, updateQuery);
+    connect(wholeWordCheckBox, &QCheckBox::toggled, &searchDialog, updateQuery);
+    connect(highlightCheckBox, &QCheckBox::toggled, &searchDialog, highlightVisible);
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged, &searchDialog, highlightVisible);
+    connect(engine, &SearchEngine::indexChanged, &searchDialog, [&]()
             {
-                regex.setPattern("\\b" + QRegularExpression::escape(searchText) + "\\b");
-                //                Метасимвол \b (граница слова) может работать корректно с латинскими символами, но при поиске по кириллице он может некорректно обрабатывать границы слов.
-                //                Это связано с тем, что \b ориентирован на латинские символы и цифры, и кириллические символы могут восприниматься неправиль
-            }
+                if (!engine->isReady())
+                {
+                    countLabel->setText("Идёт поиск...");
+                    return;
+                }
+                countLabel->setText(engine->patternLength() > 0 ? QString("Совпадений: %1").arg(engine->count()) : QString());
+                highlightVisible();
+                if (pendingSearch != 0)
+                {
+                    const bool forward = pendingSearch > 0;
+                    pendingSearch = 0;
+                    search(forward);
+                } });
+
+    // Соединяем кнопки "Следующее" и "Предыдущее" с действиями
+    connect(nextButton, &QPushButton::clicked, [&]()
+            { search(true); });
+    connect(prevButton, &QPushButton::clicked, [&]()
+            { search(false); });
+    connect(closeButton, &QPushButton::clicked, &searchDialog, &QDialog::accept);
 
-            // Опции для учета регистра в регулярном выражении
-            QRegularExpression::PatternOption caseOption = caseSensitiveCheckBox->isChecked()
-                                                               ? QRegularExpression::NoPatternOption
-                                                               : QRegularExpression::CaseInsensitiveOption;
+    // Показываем диалог
+    searchDialog.exec();
+    editor->setExtraSelections(QList<QTextEdit::ExtraSelection>());
 
-            regex.setPatternOptions(caseOption);
+    // Без запроса движок не пересчитывает совпадения при правках документа
+    disconnect(engine, nullptr, &searchDialog, nullptr);
+    engine->setQuery(QString(), Qt::CaseInsensitive, false);
+}
 
-            // Поиск с использованием регулярного выражения
-            QTextCursor foundCursor = document->find(regex, cursor, findFlags);
+void MainWindow::searchLargeFile(LargeFileView *largeFileView)
+{
+    QDialog searchDialog(this);
+    searchDialog.setWindowTitle("Поиск");
 
-            if (foundCursor.isNull())
-            {
-                QMessageBox::information(&searchDialog, "Поиск", "Текст не найден.");
-            }
-            else
-            {
-                editor->setStyleSheet("selection-background-color: blue; selection-color: white");
-                editor->setTextCursor(foundCursor);
-            }
-        }
-        else
-        {
-            // Обычный поиск без проверки на полные слова
-            QTextCursor cursor = editor->textCursor();
+    QVBoxLayout *layout = new QVBoxLayout(&searchDialog);
 
-            // Для обратного поиска нужно вручную сдвигать курсор назад перед поиском
-            editor->setStyleSheet("selection-background-color: blue; selection-color: white");
-            if (!forward && cursor.position() > 0)
-            {
-                cursor.movePosition(QTextCursor::PreviousCharacter);
-                editor->setTextCursor(cursor);
-            }
+    QLineEdit *searchLineEdit = new QLineEdit(&searchDialog);
+    layout->addWidget(new QLabel("Введите текст для поиска:", &searchDialog));
+    layout->addWidget(searchLineEdit);
 
-            if (!editor->find(searchText, findFlags))
-            {
-                QMessageBox::information(&searchDialog, "Поиск", "Текст не найден.");
-            }
+    QCheckBox *caseSensitiveCheckBox = new QCheckBox("Учитывать регистр", &searchDialog);
+    layout->addWidget(caseSensitiveCheckBox);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QPushButton *nextButton = new QPushButton("Следующее", &searchDialog);
+    QPushButton *prevButton = new QPushButton("Предыдущее", &searchDialog);
+    buttonLayout->addWidget(prevButton);
+    buttonLayout->addWidget(nextButton);
+    layout->addLayout(buttonLayout);
+
+    QPushButton *closeButton = new QPushButton("Закрыть", &searchDialog);
+    layout->addWidget(closeButton);
+
+    // Поиск идёт в фоне по всему файлу, кнопки блокируются до его окончания
+    auto search = [&](bool forward)
+    {
+        if (searchLineEdit->text().isEmpty())
+        {
+            QMessageBox::information(&searchDialog, "Поиск", "Введите текст для поиска.");
+            return;
         }
+        nextButton->setEnabled(false);
+        prevButton->setEnabled(false);
+        largeFileView->find(searchLineEdit->text(), forward,
+                            caseSensitiveCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive);
     };
 
-    // Соединяем кнопки "Следующее" и "Предыдущее" с действиями
+    connect(largeFileView, &LargeFileView::searchFinished, &searchDialog, [&](bool found)
+            {
+                nextButton->setEnabled(true);
+                prevButton->setEnabled(true);
+                if (!found)
+                {
+                    QMessageBox::information(&searchDialog, "Поиск", "Текст не найден.");
+                } });
     connect(nextButton, &QPushButton::clicked, [&]()
             { search(true); });
     connect(prevButton, &QPushButton::clicked, [&]()
             { search(false); });
     connect(closeButton, &QPushButton::clicked, &searchDialog, &QDialog::accept);
 
-    // Показываем диалог
     searchDialog.exec();
 }
 
@@ -794,9 +756,6 @@ void MainWindow::on_Replace_triggered()
     QPushButton *closeButton = new QPushButton("Закрыть", &replaceDialog);
     layout->addWidget(closeButton);
 
-    // Переменные для хранения флагов поиска
-    QTextDocument::FindFlags findFlags;
-
     // Лямбда-функция для поиска и замены всех совпадений
     auto replaceAll = [&]()
     {
@@ -809,31 +768,37 @@ void MainWindow::on_Replace_triggered()
             return;
         }
 
-        // Настройка флагов поиска
-        findFlags = caseSensitiveCheckBox->isChecked() ? QTextDocument::FindCaseSensitively : QTextDocument::FindFlags();
-        if (wholeWordCheckBox->isChecked())
-        {
-            findFlags |= QTextDocument::FindWholeWords;
-        }
-
-        // Перемещаем курсор в начало документа
-        editor->moveCursor(QTextCursor::Start);
+        QElapsedTimer timer;
+        timer.start();
 
-        bool isReplaced = false;
+        // Все совпадения находим за один проход по тексту документа
+        const QVector<int> positions = SearchEngine::findAll(editor->toPlainText(), searchText,
+                                                             caseSensitiveCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive,
+                                                             wholeWordCheckBox->isChecked());
 
-        // Поиск и замена всех совпадений
-        while (editor->find(searchText, findFlags))
+        // Сообщение, если совпадений не найдено
+        if (positions.isEmpty())
         {
-            QTextCursor cursor = editor->textCursor();
-            cursor.insertText(replaceText); // Замена текста
-            isReplaced = true;
+            QMessageBox::information(&replaceDialog, "Заменить", "Текст для замены не найден.");
+            return;
         }
 
-        // Сообщение, если совпадений не найдено
-        if (!isReplaced)
+        // Заменяем с конца, чтобы не сдвигались позиции ещё не заменённых совпадений.
+        // Весь проход - один блок правки: одна отмена и одна перекомпоновка документа в конце
+        QTextCursor cursor(editor->document());
+        editor->setUpdatesEnabled(false);
+        cursor.beginEditBlock();
+        for (int i = positions.size() - 1; i >= 0; --i)
         {
-            QMessageBox::information(&replaceDialog, "Заменить", "Текст для замены не найден.");
+            cursor.setPosition(positions.at(i));
+            cursor.setPosition(positions.at(i) + searchText.size(), QTextCursor::KeepAnchor);
+            cursor.insertText(replaceText); // Замена текста
         }
+        cursor.endEditBlock();
+        editor->setUpdatesEnabled(true);
+
+        QMessageBox::information(&replaceDialog, "Заменить",
+                                 QString("Заменено совпадений: %1 (%2 мс).").arg(positions.size()).arg(timer.elapsed()));
     };
 
     // Соединение кнопок с действиями
@@ -849,42 +814,44 @@ void MainWindow::on_Clear_triggered()
     pageIndex = ui->tabWidget->currentIndex();
     QWidget *widget = ui->tabWidget->widget(pageIndex);
     editor = qobject_cast<QTextEdit *>(widget);
-    if (!this->tempFile.isOpen() && !this->tempFile.open())
-    {
-        return; // Открываем временный файл
-    }
     if (editor)
     {
-        this->tempFile.write(editor->document()->toPlainText().toUtf8());
-        this->tempFile.flush();
-        this->tempFile.close();
-        editor->document()->clear();
+        // Очистка попадает в журнал документа одной дельтой после отметки
+        EditJournal::forDocument(editor->document())->markClear();
+        QTextCursor cursor(editor->document());
+        cursor.select(QTextCursor::Document);
+        cursor.removeSelectedText();
+        editor->document()->setModified(true);
     }
-    editor->document()->setModified(true);
 }
 
 void MainWindow::on_Undo_triggered()
 {
-    QWidget *widget = ui->tabWidget->widget(pageIndex);
+    QWidget *widget = ui->tabWidget->currentWidget();
     editor = qobject_cast<QTextEdit *>(widget);
     if (editor)
     {
-        if (this->tempFile.exists())
+        // После очистки документ восстанавливается из журнала вместе с оформлением
+        EditJournal *journal = EditJournal::forDocument(editor->document());
+        if (journal->canUndoClear())
         {
-            if (this->tempFile.open())
-            {
-                editor->document()->undo();
-                QString saved = QString::fromUtf8(this->tempFile.readAll());
-                editor->document()->setPlainText(saved);
-                this->tempFile.reset();
-                this->tempFile.close();
-            }
+            journal->undoClear();
         }
         else
         {
             editor->document()->undo();
         }
     }
+    else if (TableModel *model = tableModelOf(widget))
+    {
+        // Правки таблицы отменяются по записанным разницам, вставка из буфера - целиком
+        if (model->undoStack()->canUndo())
+        {
+            model->undoStack()->undo();
+            widget->setProperty("modified", true);
+            showSortIndicator(qobject_cast<QTableView *>(widget), model);
+        }
+    }
 }
 
 void MainWindow::on_Copy_triggered()
@@ -898,6 +865,42 @@ void MainWindow::on_Copy_triggered()
                 textEdit->copy();
             }
         }
+        else if (TableModel *model = tableModelOf(currentWidget))
+        {
+            // Прямоугольник, охватывающий выделение, копируется как текст с табуляциями
+            QTableView *view = qobject_cast<QTableView *>(currentWidget);
+            const QItemSelection selection = view->selectionModel()->selection();
+            if (selection.isEmpty())
+            {
+                return;
+            }
+            int top = selection.first().top();
+            int left = selection.first().left();
+            int bottom = selection.first().bottom();
+            int right = selection.first().right();
+            for (const QItemSelectionRange &range : selection)
+            {
+                top = qMin(top, range.top());
+                left = qMin(left, range.left());
+                bottom = qMax(bottom, range.bottom());
+                right = qMax(right, range.right());
+            }
+
+            QString text;
+            for (int row = top; row <= bottom; ++row)
+            {
+                for (int column = left; column <= right; ++column)
+                {
+                    if (column > left)
+                    {
+                        text += QLatin1Char('\t');
+                    }
+                    text += model->text(row, column);
+                }
+                text += QLatin1Char('\n');
+            }
+            QApplication::clipboard()->setText(text);
+        }
     }
 }
 
@@ -909,6 +912,37 @@ void MainWindow::on_Paste_triggered()
         {
             textEdit->paste();
         }
+        else if (TableModel *model = tableModelOf(currentWidget))
+        {
+            // Текст с табуляциями ложится прямоугольником от текущей ячейки
+            // одной правкой; отменяется тоже целиком
+            QTableView *view = qobject_cast<QTableView *>(currentWidget);
+            QString text = QApplication::clipboard()->text();
+            if (text.endsWith(QLatin1Char('\n')))
+            {
+                text.chop(1);
+            }
+            if (text.isEmpty())
+            {
+                return;
+            }
+
+            QVector<QStringList> cells;
+            for (QString line : text.split(QLatin1Char('\n')))
+            {
+                if (line.endsWith(QLatin1Char('\r')))
+                {
+                    line.chop(1);
+                }
+                cells.append(line.split(QLatin1Char('\t')));
+            }
+
+            const QModelIndex current = view->currentIndex();
+            if (model->pasteCells(current.isValid() ? current.row() : 0, current.isValid() ? current.column() : 0, cells))
+            {
+                currentWidget->setProperty("modified", true);
+            }
+        }
     }
 }
 
@@ -934,6 +968,15 @@ void MainWindow::on_Redo_triggered()
         {
             textEdit->document()->redo();
         }
+        else if (TableModel *model = tableModelOf(currentWidget))
+        {
+            if (model->undoStack()->canRedo())
+            {
+                model->undoStack()->redo();
+                currentWidget->setProperty("modified", true);
+                showSortIndicator(qobject_cast<QTableView *>(currentWidget), model);
+            }
+        }
     }
 }
 
@@ -947,7 +990,7 @@ void MainWindow::closeEvent(QCloseEvent *event)
     {
         QWidget *currentWidget = ui->tabWidget->widget(i);
         editor = qobject_cast<QTextEdit *>(currentWidget);
-        tableWidget = qobject_cast<QTableWidget *>(currentWidget);
+        tableView = qobject_cast<QTableView *>(currentWidget);
 
         if (editor && editor->document()->isModified())
         {
@@ -993,7 +1036,7 @@ void MainWindow::closeEvent(QCloseEvent *event)
                 delete currentWidget;
             }
         }
-        else if (tableWidget && tableWidget->property("modified").toBool())
+        else if (tableView && tableView->property("modified").toBool())
         {
             QString fileName = ui->tabWidget->tabToolTip(i);
 
@@ -1032,7 +1075,7 @@ void MainWindow::closeEvent(QCloseEvent *event)
             {
                 // Пользователь решил не сохранять изменения // Отменяем изменения
                 ui->tabWidget->removeTab(i);
-                tableWidget->deleteLater(); // Закрываем вкладку без сохранения
+                tableView->deleteLater(); // Закрываем вкладку без сохранения
                 delete currentWidget;
             }
         }
@@ -1053,7 +1096,7 @@ void MainWindow::on_Palette_triggered()
 {
     // Получаем текущий редактор или таблицу
     editor = qobject_cast<QTextEdit *>(ui->tabWidget->currentWidget());
-    QTableWidget *table = qobject_cast<QTableWidget *>(ui->tabWidget->currentWidget());
+    QTableView *table = qobject_cast<QTableView *>(ui->tabWidget->currentWidget());
 
     if (!editor && !table)
         return; // Если нет активного редактора или таблицы, выходим
@@ -1117,33 +1160,24 @@ void MainWindow::on_Palette_triggered()
     else if (table)
     {
         // Получаем текущую выбранную ячейку
-        QTableWidgetItem *currentItem = table->currentItem();
-
-        // Если нет активной ячейки, устанавливаем активной первую попавшуюся
-        if (!currentItem)
-        {
-            int row = table->currentRow();
-            int col = table->currentColumn();
-            if (row >= 0 && col >= 0)
-            {
-                table->setCurrentCell(row, col); // Устанавливаем ячейку как текущую
-                currentItem = table->currentItem();
-            }
-        }
+        TableModel *model = tableModelOf(table);
+        QModelIndex currentIndex = table->currentIndex();
 
-        if (!currentItem)
+        if (!model || !currentIndex.isValid())
             return; // Если нет активной ячейки, выходим
 
+        CellStyle style = model->style(currentIndex.row(), currentIndex.column());
+
         // Открываем диалог выбора цвета текста
-        QColor newTextColor = QColorDialog::getColor(currentItem->foreground().color(), this, tr("Выберите цвет текста"));
+        QColor newTextColor = QColorDialog::getColor(style.foreground, this, tr("Выберите цвет текста"));
 
         // Открываем диалог выбора цвета фона
-        QColor newBackgroundColor = QColorDialog::getColor(currentItem->background().color(), this, tr("Выберите цвет фона"));
+        QColor newBackgroundColor = QColorDialog::getColor(style.background, this, tr("Выберите цвет фона"));
 
         // Если текстовый цвет не выбран, оставляем текущий или устанавливаем чёрный по умолчанию
         if (!newTextColor.isValid())
         {
-            newTextColor = currentItem->foreground().color().isValid() ? currentItem->foreground().color() : QColor(Qt::black);
+            newTextColor = style.foreground.isValid() ? style.foreground : QColor(Qt::black);
         }
 
         // Если цвет фона не выбран или прозрачный, устанавливаем белый по умолчанию
@@ -1158,9 +1192,10 @@ void MainWindow::on_Palette_triggered()
             newTextColor = (newBackgroundColor.lightness() > 128) ? QColor(Qt::black) : QColor(Qt::white);
         }
 
-        // Устанавливаем цвета для ячейки
-        currentItem->setForeground(newTextColor);
-        currentItem->setBackground(newBackgroundColor);
+        // Цвета задаются сразу всему выделению: целые строки и столбцы хранятся одним диапазоном
+        style.foreground = newTextColor;
+        style.background = newBackgroundColor;
+        model->applyStyle(selectedRects(table), StyleSpan::Foreground | StyleSpan::Background, style);
     }
 }
 
@@ -1168,7 +1203,7 @@ void MainWindow::on_FontAndSize_triggered()
 {
     // Проверяем текущий редактор
     editor = qobject_cast<QTextEdit *>(ui->tabWidget->currentWidget());
-    QTableWidget *table = qobject_cast<QTableWidget *>(ui->tabWidget->currentWidget());
+    QTableView *table = qobject_cast<QTableView *>(ui->tabWidget->currentWidget());
 
     if (!editor && !table)
         return; // Если нет активного редактора или таблицы, прерываем выполнение
@@ -1206,13 +1241,14 @@ void MainWindow::on_FontAndSize_triggered()
         else if (table)
         {
             // Применяем шрифт к выделенной ячейке таблицы
-            QList<QTableWidgetItem *> selectedItems = table->selectedItems();
-            if (!selectedItems.isEmpty())
+            TableModel *model = tableModelOf(table);
+            const QVector<CellRange> rects = selectedRects(table);
+            if (model && !rects.isEmpty())
             {
-                foreach (QTableWidgetItem *item, selectedItems)
-                {
-                    item->setFont(font); // Устанавливаем шрифт для каждой выбранной ячейки
-                }
+                // Шрифт всего выделения меняется одним шагом отмены
+                CellStyle style;
+                style.font = font;
+                model->applyStyle(rects, StyleSpan::Font, style);
 
                 qDebug() << "Applied Font to Selected Table Items.";
             }
@@ -1224,77 +1260,37 @@ void MainWindow::on_FontAndSize_triggered()
     }
 }
 
-void MainWindow::saveTextSettings(const QString &filePath)
+bool MainWindow::loadTextSettings(const QString &filePath)
 {
-    editor = qobject_cast<QTextEdit *>(ui->tabWidget->currentWidget());
+    QTextEdit *editor = qobject_cast<QTextEdit *>(ui->tabWidget->currentWidget());
     if (!editor)
-        return;
+        return false;
 
     QFileInfo fileInfo(filePath);
     QString relativePath = "../Visual_Lab5/Lab_5/textSettings";
-
     QDir settingsDir(relativePath);
-    if (!settingsDir.exists() && !settingsDir.mkpath("."))
-    {
-        qDebug() << "Unable to create directory: " << settingsDir.absolutePath();
-        return;
-    }
-
-    QString jsonFilePath = settingsDir.absoluteFilePath(fileInfo.fileName() + ".html");
-
-    // Извлекаем HTML код документа
-    QString documentHtml = editor->toHtml();
-
-    // Сохраняем HTML код в JSON объект
-    QJsonObject settingsObject;
-    settingsObject["html"] = documentHtml;
 
-    QJsonDocument settingsDoc(settingsObject);
-    QFile jsonFile(jsonFilePath);
-    if (jsonFile.open(QIODevice::WriteOnly))
-    {
-        jsonFile.write(settingsDoc.toJson());
-        jsonFile.close();
-        qDebug() << "Settings saved to: " << jsonFilePath;
-    }
-    else
+    const QString settingsFilePath = settingsDir.absoluteFilePath(fileInfo.fileName() + ".rtd");
+    if (QFile::exists(settingsFilePath))
     {
-        qDebug() << "Unable to open file for writing: " << jsonFilePath;
+        // Устаревшее оформление отвергается целиком, прежний формат не подставляется
+        return RichTextFormat::read(editor->document(), settingsFilePath, fileInfo);
     }
-}
 
-void MainWindow::loadTextSettings(const QString &filePath)
-{
-    QTextEdit *editor = qobject_cast<QTextEdit *>(ui->tabWidget->currentWidget());
-    if (!editor)
-        return;
-
-    QFileInfo fileInfo(filePath);
-    QString relativePath = "../Visual_Lab5/Lab_5/textSettings";
-    QDir settingsDir(relativePath);
+    // Файл прежнего формата: HTML внутри JSON, без проверки актуальности
     QString jsonFilePath = settingsDir.absoluteFilePath(fileInfo.fileName() + ".html");
-
     QFile jsonFile(jsonFilePath);
     if (!jsonFile.open(QIODevice::ReadOnly))
     {
-        qDebug() << "Unable to open file for reading: " << jsonFilePath;
-        return;
+        return false;
     }
 
-    QByteArray saveData = jsonFile.readAll();
+    QJsonDocument loadDoc(QJsonDocument::fromJson(jsonFile.readAll()));
     jsonFile.close();
-
-    QJsonDocument loadDoc(QJsonDocument::fromJson(saveData));
-    QJsonObject settingsObject = loadDoc.object();
-
-    // Извлекаем HTML из JSON объекта
-    QString documentHtml = settingsObject["html"].toString();
-
-    // Очищаем текстовый редактор и вставляем HTML
-    editor->clear();
-    editor->setHtml(documentHtml);
+    editor->setHtml(loadDoc.object()["html"].toString());
 
     qDebug() << "Settings loaded from: " << jsonFilePath;
+    return true;
 }
 
 void MainWindow::on_Table_triggered()
@@ -1369,28 +1365,24 @@ void MainWindow::on_Table_triggered()
         }
         else if (widgetOption->isChecked())
         {
-            // Создаем таблицу в виде QTableWidget
-            tableWidget = new QTableWidget(rows, columns);
-            tableWidget->setWindowTitle("Таблица");
-            tableWidget->setEditTriggers(QAbstractItemView::DoubleClicked);
-            tableWidget->setProperty("modified", true);
-            for (int i = 0; i < rows; ++i)
-            {
-                for (int j = 0; j < columns; ++j)
-                {
-                    QTableWidgetItem *item = tableWidget->item(i, j);
-                    if (!item)
-                    {
-                        item = new QTableWidgetItem();
-                        tableWidget->setItem(i, j, item);
-                    }
-                    // Установка белого фона, если фон не был изменен
-                    item->setTextAlignment(Qt::AlignLeft | Qt::AlignVCenter);
-                    item->setBackground(QColor(Qt::white));
-                }
-            }
+            // Создаем таблицу на основе модели
+            TableModel *model = new TableModel(rows, columns);
+
+            // Белый фон для всех ячеек задаётся стилем по умолчанию, а не каждой ячейке
+            CellStyle defaultStyle;
+            defaultStyle.alignment = Qt::AlignLeft | Qt::AlignVCenter;
+            defaultStyle.background = QColor(Qt::white);
+            model->setDefaultStyle(defaultStyle);
+
+            tableView = createTableView(model);
+            tableView->setWindowTitle("Таблица");
+            tableView->setEditTriggers(QAbstractItemView::DoubleClicked);
+            tableView->setProperty("modified", true);
+            connect(model, &TableModel::dataChanged, this, [this](const QModelIndex &topLeft)
+                    { onTableCellChanged(topLeft.row(), topLeft.column()); });
+
             // Добавляем новую вкладку с таблицей в QTabWidget
-            int index = ui->tabWidget->addTab(tableWidget, tr("Таблица %1").arg(ui->tabWidget->count() + 1));
+            int index = ui->tabWidget->addTab(tableView, tr("Таблица %1").arg(ui->tabWidget->count() + 1));
             ui->tabWidget->setCurrentIndex(index);
         }
     }
@@ -1401,7 +1393,7 @@ void MainWindow::onTableCellChanged(int row, int column)
     Q_UNUSED(row);    // Если не используете эти параметры
     Q_UNUSED(column); // Если не используете эти параметры
 
-    QTableWidget *currentTable = qobject_cast<QTableWidget *>(ui->tabWidget->currentWidget());
+    QTableView *currentTable = qobject_cast<QTableView *>(ui->tabWidget->currentWidget());
     if (currentTable)
     {
         currentTable->setProperty("modified", true); // Устанавливаем свойство modified в true
@@ -1411,11 +1403,14 @@ void MainWindow::onTableCellChanged(int row, int column)
 void MainWindow::on_AddRow_triggered()
 {
     QWidget *currentWidget = ui->tabWidget->currentWidget();
-    if (QTableWidget *tableWidget = qobject_cast<QTableWidget *>(currentWidget))
+    if (QTableView *tableView = qobject_cast<QTableView *>(currentWidget))
     {
-        // Добавляем строку в QTableWidget
-        tableWidget->insertRow(tableWidget->rowCount());
-        tableWidget->setProperty("modified", true);
+        // Перед каждым участком выделенных строк вставляется столько же новых,
+        // все вставки - одно изменение; без выделения строка добавляется в конец
+        TableModel *model = tableModelOf(tableView);
+        const QVector<IndexRange> ranges = selectedRanges(tableView, Qt::Vertical);
+        model->insertRanges(Qt::Vertical, ranges.isEmpty() ? QVector<IndexRange>{IndexRange{model->rowCount(), 1}} : ranges);
+        tableView->setProperty("modified", true);
     }
     else if (QTextEdit *editor = qobject_cast<QTextEdit *>(currentWidget))
     {
@@ -1436,11 +1431,13 @@ void MainWindow::on_AddRow_triggered()
 void MainWindow::on_AddColumn_triggered()
 {
     QWidget *currentWidget = ui->tabWidget->currentWidget();
-    if (QTableWidget *tableWidget = qobject_cast<QTableWidget *>(currentWidget))
+    if (QTableView *tableView = qobject_cast<QTableView *>(currentWidget))
     {
-        // Добавляем столбец в QTableWidget
-        tableWidget->insertColumn(tableWidget->columnCount());
-        tableWidget->setProperty("modified", true);
+        // Перед каждым участком выделенных столбцов вставляется столько же новых
+        TableModel *model = tableModelOf(tableView);
+        const QVector<IndexRange> ranges = selectedRanges(tableView, Qt::Horizontal);
+        model->insertRanges(Qt::Horizontal, ranges.isEmpty() ? QVector<IndexRange>{IndexRange{model->columnCount(), 1}} : ranges);
+        tableView->setProperty("modified", true);
     }
     else if (QTextEdit *editor = qobject_cast<QTextEdit *>(currentWidget))
     {
@@ -1461,22 +1458,19 @@ void MainWindow::on_AddColumn_triggered()
 void MainWindow::on_DeleteRow_triggered()
 {
     QWidget *currentWidget = ui->tabWidget->currentWidget();
-    if (QTableWidget *tableWidget = qobject_cast<QTableWidget *>(currentWidget))
+    if (QTableView *tableView = qobject_cast<QTableView *>(currentWidget))
     {
-        // Удаляем текущую строку в QTableWidget
-        if (tableWidget->rowCount() > 1)
+        // Удаляем все выделенные строки одним изменением; последняя строка таблицы остаётся
+        TableModel *model = tableModelOf(tableView);
+        const QVector<IndexRange> ranges = selectedRanges(tableView, Qt::Vertical);
+        if (ranges.isEmpty())
         {
-            int currentRow = tableWidget->currentRow();
-            if (currentRow != -1)
-            {
-                tableWidget->removeRow(currentRow);
-            }
-            else
-            {
-                QMessageBox::warning(this, "Ошибка", "Выберите строку для удаления.");
-            }
+            QMessageBox::warning(this, "Ошибка", "Выберите строку для удаления.");
+        }
+        else if (IndexShift(ranges, true).total() < model->rowCount() && model->removeRanges(Qt::Vertical, ranges))
+        {
+            tableView->setProperty("modified", true);
         }
-        tableWidget->setProperty("modified", true);
     }
     else if (QTextEdit *editor = qobject_cast<QTextEdit *>(currentWidget))
     {
@@ -1500,22 +1494,19 @@ void MainWindow::on_DeleteRow_triggered()
 void MainWindow::on_DeleteColumn_triggered()
 {
     QWidget *currentWidget = ui->tabWidget->currentWidget();
-    if (QTableWidget *tableWidget = qobject_cast<QTableWidget *>(currentWidget))
+    if (QTableView *tableView = qobject_cast<QTableView *>(currentWidget))
     {
-        // Удаляем текущий столбец в QTableWidget
-        if (tableWidget->columnCount() > 1)
+        // Удаляем все выделенные столбцы одним изменением; последний столбец таблицы остаётся
+        TableModel *model = tableModelOf(tableView);
+        const QVector<IndexRange> ranges = selectedRanges(tableView, Qt::Horizontal);
+        if (ranges.isEmpty())
         {
-            int currentColumn = tableWidget->currentColumn();
-            if (currentColumn != -1)
-            {
-                tableWidget->removeColumn(currentColumn);
-            }
-            else
-            {
-                QMessageBox::warning(this, "Ошибка", "Выберите столбец для удаления.");
-            }
+            QMessageBox::warning(this, "Ошибка", "Выберите столбец для удаления.");
+        }
+        else if (IndexShift(ranges, true).total() < model->columnCount() && model->removeRanges(Qt::Horizontal, ranges))
+        {
+            tableView->setProperty("modified", true);
         }
-        tableWidget->setProperty("modified", true);
     }
     else if (QTextEdit *editor = qobject_cast<QTextEdit *>(currentWidget))
     {
@@ -1538,15 +1529,16 @@ void MainWindow::on_DeleteColumn_triggered()
 
 void MainWindow::on_Paddins_triggered()
 {
-    QTableWidget *tableWidget = qobject_cast<QTableWidget *>(ui->tabWidget->currentWidget());
-    if (!tableWidget)
+    QTableView *tableView = qobject_cast<QTableView *>(ui->tabWidget->currentWidget());
+    TableModel *model = tableModelOf(tableView);
+    if (!model)
     {
         QMessageBox::warning(this, "Ошибка", "Текущая вкладка не является таблицей.");
         return;
     }
 
-    int currentRow = tableWidget->currentRow();
-    int currentColumn = tableWidget->currentColumn();
+    int currentRow = tableView->currentIndex().row();
+    int currentColumn = tableView->currentIndex().column();
     if (currentRow == -1 || currentColumn == -1)
     {
         QMessageBox::warning(this, "Ошибка", "Выберите ячейку для изменения выравнивания.");
@@ -1599,19 +1591,140 @@ void MainWindow::on_Paddins_triggered()
             alignment = Qt::AlignRight | Qt::AlignVCenter;
         }
 
-        // Устанавливаем выравнивание для выбранной ячейки
-        QTableWidgetItem *item = tableWidget->item(currentRow, currentColumn);
-        if (item)
+        // Устанавливаем выравнивание для выделенных ячеек
+        CellStyle style;
+        style.alignment = static_cast<int>(alignment);
+        model->applyStyle(selectedRects(tableView), StyleSpan::Alignment, style);
+    }
+}
+
+void MainWindow::sortTableByColumn(QTableView *view, int column)
+{
+    TableModel *model = tableModelOf(view);
+    QVector<SortKey> keys = model->sortKeys();
+
+    // Повторный щелчок меняет направление; с Shift столбец добавляется к ключам сортировки
+    auto existing = std::find_if(keys.begin(), keys.end(), [column](const SortKey &key)
+                                 { return key.column == column; });
+    if (QApplication::keyboardModifiers() & Qt::ShiftModifier)
+    {
+        if (existing != keys.end())
         {
-            item->setTextAlignment(static_cast<int>(alignment));
+            existing->order = existing->order == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder;
         }
         else
         {
-            item = new QTableWidgetItem();
-            item->setTextAlignment(static_cast<int>(alignment));
-            tableWidget->setItem(currentRow, currentColumn, item);
+            keys.append(SortKey{column, Qt::AscendingOrder});
         }
     }
+    else
+    {
+        const bool toggle = !keys.isEmpty() && existing == keys.begin() && existing->order == Qt::AscendingOrder;
+        keys = {SortKey{column, toggle ? Qt::DescendingOrder : Qt::AscendingOrder}};
+    }
+    orderTable(view, keys, model->rowFilters());
+}
+
+void MainWindow::orderTable(QTableView *view, const QVector<SortKey> &keys, const QVector<RowFilter> &filters)
+{
+    TableModel *model = tableModelOf(view);
+
+    // Применяется только результат последнего запроса для вкладки
+    const int request = view->property("orderRequest").toInt() + 1;
+    view->setProperty("orderRequest", request);
+
+    if (keys.isEmpty() && filters.isEmpty())
+    {
+        model->clearRowOrder();
+        view->horizontalHeader()->setSortIndicatorShown(false);
+        return;
+    }
+
+    TableSorter *sorter = TableSorter::forModel(model, keys, filters, view);
+    statusBar()->showMessage(tr("Сортировка..."));
+    connect(sorter, &TableSorter::finished, view, [this, view, model, sorter, request](const QVector<int> &order)
+            {
+                sorter->deleteLater();
+                if (view->property("orderRequest").toInt() != request)
+                {
+                    return;
+                }
+                if (model->structureRevision() != sorter->structureRevision())
+                {
+                    statusBar()->showMessage(tr("Таблица изменилась во время сортировки, повторите действие"), 3000);
+                    return;
+                }
+
+                model->setRowOrder(order, sorter->sortKeys(), sorter->rowFilters());
+                showSortIndicator(view, model);
+                statusBar()->showMessage(tr("Показано строк: %1 из %2").arg(model->rowCount()).arg(model->sourceRowCount()), 3000); });
+    sorter->start();
+}
+
+void MainWindow::on_Filter_triggered()
+{
+    QTableView *tableView = qobject_cast<QTableView *>(ui->tabWidget->currentWidget());
+    TableModel *model = tableModelOf(tableView);
+    if (!model || model->columnCount() == 0)
+    {
+        QMessageBox::warning(this, "Ошибка", "Текущая вкладка не является таблицей.");
+        return;
+    }
+
+    // Создаем диалог условия: столбец, сравнение и значение
+    QDialog dialog(this);
+    dialog.setWindowTitle("Фильтр строк");
+
+    QSpinBox *columnBox = new QSpinBox(&dialog);
+    columnBox->setRange(1, model->columnCount());
+    QComboBox *conditionBox = new QComboBox(&dialog);
+    conditionBox->addItems({"содержит", "равно", "не равно", "меньше", "больше"}); // Порядок RowFilter::Condition
+    QLineEdit *valueEdit = new QLineEdit(&dialog);
+
+    QModelIndex currentIndex = tableView->currentIndex();
+    if (currentIndex.isValid())
+    {
+        columnBox->setValue(currentIndex.column() + 1);
+        valueEdit->setText(model->text(currentIndex.row(), currentIndex.column()));
+    }
+
+    QPushButton *okButton = new QPushButton("OK", &dialog);
+    QPushButton *cancelButton = new QPushButton("Отмена", &dialog);
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    QHBoxLayout *conditionLayout = new QHBoxLayout;
+    conditionLayout->addWidget(new QLabel("Столбец", &dialog));
+    conditionLayout->addWidget(columnBox);
+    conditionLayout->addWidget(conditionBox);
+    conditionLayout->addWidget(valueEdit);
+    layout->addLayout(conditionLayout);
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    buttonLayout->addWidget(okButton);
+    buttonLayout->addWidget(cancelButton);
+    layout->addLayout(buttonLayout);
+    dialog.setLayout(layout);
+
+    connect(okButton, &QPushButton::clicked, &dialog, &QDialog::accept);
+    connect(cancelButton, &QPushButton::clicked, &dialog, &QDialog::reject);
+
+    // Условие добавляется к уже заданным
+    if (dialog.exec() == QDialog::Accepted)
+    {
+        QVector<RowFilter> filters = model->rowFilters();
+        filters.append(RowFilter{columnBox->value() - 1, RowFilter::Condition(conditionBox->currentIndex()), valueEdit->text()});
+        orderTable(tableView, model->sortKeys(), filters);
+    }
+}
+
+void MainWindow::on_ResetOrder_triggered()
+{
+    QTableView *tableView = qobject_cast<QTableView *>(ui->tabWidget->currentWidget());
+    if (!tableModelOf(tableView))
+    {
+        QMessageBox::warning(this, "Ошибка", "Текущая вкладка не является таблицей.");
+        return;
+    }
+    orderTable(tableView, QVector<SortKey>(), QVector<RowFilter>());
 }
 
 void MainWindow::on_GoToGraphic_clicked(){
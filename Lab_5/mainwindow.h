@@ -2,10 +2,10 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QApplication>
 #include <QTextEdit>
 #include <QFile>
-#include <QTableWidget>
-#include <QTableWidgetItem>
+#include <QTableView>
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QInputDialog>
@@ -13,6 +13,8 @@
 #include <QDebug>
 #include <QPushButton>
 #include <QCheckBox>
+#include <QComboBox>
+#include <QClipboard>
 #include <QCloseEvent>
 #include <QTemporaryFile>
 #include <QFontDialog>
@@ -20,6 +22,8 @@
 #include <QSettings>
 #include <QVBoxLayout>
 #include <QLabel>
+#include <QLineEdit>
+#include <QHeaderView>
 #include <QTextBlock>
 #include <QJsonObject>
 #include <QJsonDocument>
@@ -28,8 +32,26 @@
 #include <QTextTableCell>
 #include <QRadioButton>
 #include <QTemporaryFile>
-
+#include <QProgressDialog>
+#include <QProgressBar>
+#include <QPointer>
+#include <QStatusBar>
+#include <QThread>
+#include <QScrollBar>
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+#include "csvloader.h"
+#include "editjournal.h"
 #include "graphicseditor.h"
+#include "largefileview.h"
+#include "richtextformat.h"
+#include "savejob.h"
+#include "searchengine.h"
+#include "stylesidecar.h"
+#include "tablemodel.h"
+#include "tablesorter.h"
 
 namespace Ui {
 class MainWindow;
@@ -50,12 +72,22 @@ private slots:
 
     void on_OpenFile_triggered();
 
+    void openCsvFile(const QString &fileName);
+
+    QTableView *createTableView(TableModel *model);
+
+    void applyTableSettings(TableModel *model, const QString &fileName);
+
     void on_SaveFile_triggered();
 
     void on_SaveFileAs_triggered();
 
+    void saveTab(QWidget *widget, const QString &filePath);
+
     void on_Search_triggered();
 
+    void searchLargeFile(LargeFileView *largeFileView);
+
     void on_Replace_triggered();
 
     void on_Copy_triggered();
@@ -76,9 +108,7 @@ private slots:
 
     void on_Clear_triggered();
 
-    void loadTextSettings(const QString& filePath);
-
-    void saveTextSettings(const QString& filePath);
+    bool loadTextSettings(const QString& filePath);
 
     void closeEvent(QCloseEvent *event);
 
@@ -98,6 +128,14 @@ private slots:
 
     void on_Paddins_triggered();
 
+    void sortTableByColumn(QTableView *view, int column);
+
+    void orderTable(QTableView *view, const QVector<SortKey> &keys, const QVector<RowFilter> &filters);
+
+    void on_Filter_triggered();
+
+    void on_ResetOrder_triggered();
+
     void on_GoToGraphic_clicked();
 
     void resetEditorWindow();
@@ -106,13 +144,12 @@ private:
     Ui::MainWindow *ui;
     int pageIndex;
     QTextEdit *editor;
-    QTableWidget *tableWidget;
+    QTableView *tableView;
     QFont currentFont;
     QColor textColor;
     QColor backgroundColor;
     QString appDir = "Laboratory_5";
     bool tableModified = true;
-    static QTemporaryFile tempFile;
     GraphicsEditor *graphicEditor;
 };
 
@@ -0,0 +1,203 @@
+#include "richtextformat.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextFrame>
+
+enum ContentKind : quint8
+{
+    FormatRuns = 0,
+    Html = 1
+};
+
+bool RichTextFormat::hasStructure(const QTextDocument *document)
+{
+    if (!document->rootFrame()->childFrames().isEmpty())
+    {
+        return true; // Таблицы и вложенные фреймы
+    }
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next())
+    {
+        if (block.textList())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RichTextFormat::write(const QTextDocument *document, const QString &path, const QFileInfo &source)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << Magic << Version << qint64(source.size()) << qint64(source.lastModified().toMSecsSinceEpoch());
+    writeDocument(out, document);
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+void RichTextFormat::writeDocument(QDataStream &out, const QTextDocument *document)
+{
+    if (hasStructure(document))
+    {
+        out << quint8(Html) << document->toHtml();
+        return;
+    }
+
+    // Номера форматов - индексы общей палитры документа
+    out << quint8(FormatRuns) << document->allFormats();
+
+    QString text;
+    QVector<qint32> runs; // На блок: формат блока, формат символов блока, число фрагментов, затем пары (длина, формат)
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next())
+    {
+        const int header = runs.size();
+        runs << block.blockFormatIndex() << block.charFormatIndex() << 0;
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it)
+        {
+            const QTextFragment fragment = it.fragment();
+            if (!fragment.isValid())
+            {
+                continue;
+            }
+            text += fragment.text();
+            runs << fragment.length() << fragment.charFormatIndex();
+            ++runs[header + 2];
+        }
+    }
+    out << text << runs;
+}
+
+bool RichTextFormat::read(QTextDocument *document, const QString &path, const QFileInfo &source)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic;
+    quint16 version;
+    qint64 size, modified;
+    in >> magic >> version >> size >> modified;
+    if (in.status() != QDataStream::Ok || magic != Magic || version != Version)
+    {
+        return false;
+    }
+    if (size != source.size() || modified != source.lastModified().toMSecsSinceEpoch())
+    {
+        return false; // Текст менялся без нас
+    }
+    return readDocument(in, document);
+}
+
+bool RichTextFormat::readDocument(QDataStream &in, QTextDocument *document)
+{
+    quint8 kind;
+    in >> kind;
+    if (in.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    if (kind == Html)
+    {
+        QString html;
+        in >> html;
+        if (in.status() != QDataStream::Ok)
+        {
+            return false;
+        }
+        document->setHtml(html);
+        return true;
+    }
+
+    QVector<QTextFormat> formats;
+    QString text;
+    QVector<qint32> runs;
+    in >> formats >> text >> runs;
+    if (in.status() != QDataStream::Ok || kind != FormatRuns)
+    {
+        return false;
+    }
+
+    // Проверяем серии до изменения документа, чтобы не оставить его наполовину загруженным
+    auto validFormat = [&formats](qint32 index)
+    {
+        return index >= 0 && index < formats.size();
+    };
+    int textLength = 0;
+    for (int i = 0; i < runs.size();)
+    {
+        if (i + 3 > runs.size())
+        {
+            return false;
+        }
+        const int fragments = runs.at(i + 2);
+        if (!validFormat(runs.at(i)) || !validFormat(runs.at(i + 1)) ||
+            fragments < 0 || fragments > (runs.size() - i - 3) / 2)
+        {
+            return false;
+        }
+        for (int k = 0; k < fragments; ++k)
+        {
+            const int length = runs.at(i + 3 + 2 * k);
+            if (length < 0 || !validFormat(runs.at(i + 4 + 2 * k)))
+            {
+                return false;
+            }
+            textLength += length;
+        }
+        i += 3 + 2 * fragments;
+    }
+    if (textLength != text.size())
+    {
+        return false;
+    }
+
+    const bool undoRedo = document->isUndoRedoEnabled();
+    document->setUndoRedoEnabled(false);
+    document->clear();
+
+    QTextCursor cursor(document);
+    int position = 0;
+    bool firstBlock = true;
+    for (int i = 0; i < runs.size();)
+    {
+        const QTextBlockFormat blockFormat = formats.at(runs.at(i)).toBlockFormat();
+        const QTextCharFormat blockCharFormat = formats.at(runs.at(i + 1)).toCharFormat();
+        const int fragments = runs.at(i + 2);
+        if (firstBlock)
+        {
+            cursor.setBlockFormat(blockFormat);
+            cursor.setBlockCharFormat(blockCharFormat);
+            firstBlock = false;
+        }
+        else
+        {
+            cursor.insertBlock(blockFormat, blockCharFormat);
+        }
+
+        for (int k = 0; k < fragments; ++k)
+        {
+            const int length = runs.at(i + 3 + 2 * k);
+            cursor.insertText(text.mid(position, length), formats.at(runs.at(i + 4 + 2 * k)).toCharFormat());
+            position += length;
+        }
+        i += 3 + 2 * fragments;
+    }
+
+    document->setUndoRedoEnabled(undoRedo);
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef RICHTEXTFORMAT_H
+#define RICHTEXTFORMAT_H
+
+#include <QDataStream>
+#include <QFileInfo>
+#include <QTextDocument>
+
+// Собственный двоичный формат оформленного документа.
+// Хранит текст, палитру форматов документа и для каждого блока серии
+// фрагментов (длина, номер формата), поэтому загружается за один проход без
+// разбора HTML. Документы со списками и таблицами, которые не выражаются
+// форматами блоков, сохраняются внутри того же файла как HTML.
+// В заголовке записаны размер и время изменения исходного файла: файл
+// оформления от другой версии текста не загружается.
+class RichTextFormat
+{
+public:
+    static const quint32 Magic = 0x4c525444; // "LRTD"
+    static const quint16 Version = 1;
+
+    static bool write(const QTextDocument *document, const QString &path, const QFileInfo &source);
+    // Документ не меняется, если файла нет, он устарел или повреждён
+    static bool read(QTextDocument *document, const QString &path, const QFileInfo &source);
+
+    // Содержимое документа без заголовка, для встраивания в другие файлы
+    static void writeDocument(QDataStream &out, const QTextDocument *document);
+    static bool readDocument(QDataStream &in, QTextDocument *document);
+
+private:
+    static bool hasStructure(const QTextDocument *document);
+};
+
+#endif // RICHTEXTFORMAT_H
@@ -0,0 +1,173 @@
+#include "savejob.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextCodec>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "csvwriter.h"
+#include "richtextformat.h"
+#include "stylesidecar.h"
+
+static const char *TextSettingsDirectory = "../Visual_Lab5/Lab_5/textSettings";
+
+// Накопитель текста: кодирует и пишет на диск блоками по BufferSize байт
+class BufferedWriter
+{
+public:
+    explicit BufferedWriter(QSaveFile &file) : file(file), codec(QTextCodec::codecForLocale())
+    {
+        buffer.reserve(SaveJob::BufferSize);
+    }
+
+    void append(const QString &text)
+    {
+        buffer += text;
+        if (buffer.size() >= SaveJob::BufferSize / 2)
+        {
+            flush();
+        }
+    }
+
+    bool flush()
+    {
+        if (!buffer.isEmpty())
+        {
+            // Состояние кодека переносит суррогатные пары через границу блоков
+            ok = ok && file.write(codec->fromUnicode(buffer.constData(), buffer.size(), &state)) >= 0;
+            buffer.clear();
+        }
+        return ok;
+    }
+
+private:
+    QSaveFile &file;
+    QTextCodec *codec;
+    QTextCodec::ConverterState state;
+    QString buffer;
+    bool ok = true;
+};
+
+SaveJob::SaveJob(const QString &filePath, QObject *parent) : QObject(parent),
+                                                            path(filePath),
+                                                            document(nullptr),
+                                                            rows(0),
+                                                            delimiter(','),
+                                                            lastPercent(-1)
+{
+    connect(&watcher, &QFutureWatcher<QString>::finished, this, [this]()
+            {
+                const QString error = watcher.result();
+                emit finished(error.isEmpty(), error); });
+}
+
+SaveJob::~SaveJob()
+{
+    watcher.waitForFinished();
+    delete document;
+}
+
+SaveJob *SaveJob::forText(const QTextDocument *document, const QString &filePath, QObject *parent)
+{
+    SaveJob *job = new SaveJob(filePath, parent);
+    job->document = document->clone(); // Копия не меняется, пока рабочий поток её читает
+    return job;
+}
+
+SaveJob *SaveJob::forTable(const TableModel *model, const QString &filePath, QObject *parent)
+{
+    SaveJob *job = new SaveJob(filePath, parent);
+    job->columns = model->columns();
+    job->rows = model->sourceRowCount();
+    job->delimiter = model->delimiter();
+    job->styles = model->styles();
+    job->styledCells = model->styledCells();
+    job->spans = model->styleSpans();
+    return job;
+}
+
+void SaveJob::start()
+{
+    watcher.setFuture(QtConcurrent::run(this, &SaveJob::run));
+}
+
+QString SaveJob::run()
+{
+    return document ? writeText() : writeTable();
+}
+
+void SaveJob::reportProgress(qint64 done, qint64 total)
+{
+    const int percent = total > 0 ? int(done * 100 / total) : 100;
+    if (percent != lastPercent)
+    {
+        lastPercent = percent;
+        emit progress(percent);
+    }
+}
+
+QString SaveJob::writeText()
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return tr("Не удалось сохранить текстовый файл");
+    }
+
+    const QString text = document->toPlainText();
+    BufferedWriter out(file);
+    const int step = BufferSize / 2;
+    for (int position = 0; position < text.size(); position += step)
+    {
+        out.append(text.mid(position, step));
+        reportProgress(position, text.size());
+    }
+    if (!out.flush() || !file.commit())
+    {
+        return tr("Не удалось сохранить текстовый файл");
+    }
+    reportProgress(1, 1);
+
+    // Файл оформления помечается размером и временем уже записанного файла
+    QDir settingsDir(TextSettingsDirectory);
+    if (!settingsDir.exists() && !settingsDir.mkpath("."))
+    {
+        qDebug() << "Unable to create directory: " << settingsDir.absolutePath();
+        return QString();
+    }
+    QFileInfo fileInfo(path);
+    QString settingsFilePath = settingsDir.absoluteFilePath(fileInfo.fileName() + ".rtd");
+    if (!RichTextFormat::write(document, settingsFilePath, fileInfo))
+    {
+        qDebug() << "Unable to open file for writing: " << settingsFilePath;
+        return QString();
+    }
+
+    // Оформление прежнего формата заменено новым
+    QFile::remove(settingsDir.absoluteFilePath(fileInfo.fileName() + ".html"));
+    return QString();
+}
+
+QString SaveJob::writeTable()
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return tr("Не удалось открыть файл для записи");
+    }
+
+    CsvWriter writer(columns, rows, delimiter);
+    const bool written = writer.write(&file, [this](qint64 done, qint64 total)
+                                      { reportProgress(done, total); });
+    if (!written || !file.commit())
+    {
+        return tr("Не удалось открыть файл для записи");
+    }
+    reportProgress(1, 1);
+
+    // Оформление ячеек сохраняется в отдельный файл
+    StyleSidecar::write(styles, styledCells, spans, rows, columns.size(), path);
+    return QString();
+}
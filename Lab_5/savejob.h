@@ -0,0 +1,61 @@
+#ifndef SAVEJOB_H
+#define SAVEJOB_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QTextDocument>
+#include <QVector>
+
+#include "tablemodel.h"
+
+// Фоновое сохранение вкладки.
+// В потоке GUI снимается неизменяемый снимок документа или таблицы, всё
+// остальное - преобразование в текст, запись крупными блоками и атомарная
+// замена файла через QSaveFile - выполняется в рабочем потоке. Пока идёт
+// сохранение, вкладку можно продолжать редактировать.
+class SaveJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int BufferSize = 1 << 20; // Размер одной записи на диск (1 МиБ)
+
+    static SaveJob *forText(const QTextDocument *document, const QString &filePath, QObject *parent = nullptr);
+    static SaveJob *forTable(const TableModel *model, const QString &filePath, QObject *parent = nullptr);
+    ~SaveJob() override;
+
+    QString filePath() const { return path; }
+    void start();
+
+signals:
+    // Сигналы приходят в поток GUI; progress испускается из рабочего потока
+    void progress(int percent);
+    void finished(bool ok, const QString &error);
+
+private:
+    SaveJob(const QString &filePath, QObject *parent);
+
+    QString run();
+    QString writeText();
+    QString writeTable();
+    void reportProgress(qint64 done, qint64 total);
+
+    QString path;
+
+    // Снимок текстовой вкладки
+    QTextDocument *document;
+
+    // Снимок таблицы
+    QVector<TableColumn> columns;
+    int rows;
+    char delimiter;
+    QVector<CellStyle> styles;
+    QHash<quint64, int> styledCells;
+    QVector<StyleSpan> spans;
+
+    QFutureWatcher<QString> watcher;
+    int lastPercent;
+};
+
+#endif // SAVEJOB_H
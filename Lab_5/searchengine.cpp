@@ -0,0 +1,312 @@
+#include "searchengine.h"
+
+#include <QTextCursor>
+#include <QtAlgorithms>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Символ, который считается частью слова при поиске целых слов
+static bool isWordChar(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_');
+}
+
+// Посимвольная свёртка регистра: длина строки и позиции символов не меняются
+static QString foldCase(const QString &text)
+{
+    QString folded(text.size(), Qt::Uninitialized);
+    QChar *out = folded.data();
+    for (const QChar ch : text)
+    {
+        *out++ = ch.toCaseFolded();
+    }
+    return folded;
+}
+
+SearchEngine::SearchEngine(QTextDocument *document) : QObject(document),
+                                                      document(document),
+                                                      caseSensitivity(Qt::CaseInsensitive),
+                                                      wholeWords(false),
+                                                      building(false),
+                                                      stale(false)
+{
+    connect(document, &QTextDocument::contentsChange, this, &SearchEngine::onContentsChange);
+    connect(&watcher, &QFutureWatcher<QVector<int>>::finished, this, [this]() {
+        if (building && watcher.isFinished())
+        {
+            takeResult();
+        }
+    });
+}
+
+SearchEngine::~SearchEngine()
+{
+    watcher.waitForFinished();
+}
+
+SearchEngine *SearchEngine::forDocument(QTextDocument *document)
+{
+    SearchEngine *engine = document->findChild<SearchEngine *>(QString(), Qt::FindDirectChildrenOnly);
+    return engine ? engine : new SearchEngine(document);
+}
+
+QVector<int> SearchEngine::findAll(const QString &text, const QString &pattern,
+                                   Qt::CaseSensitivity cs, bool wholeWords, int from)
+{
+    QVector<int> result;
+    const int textLength = text.size();
+    const int length = pattern.size();
+    if (length == 0 || textLength < length)
+    {
+        return result;
+    }
+
+    const QString haystack = cs == Qt::CaseSensitive ? text : foldCase(text);
+    const QString needle = cs == Qt::CaseSensitive ? pattern : foldCase(pattern);
+    const ushort *h = haystack.utf16();
+    const ushort *p = needle.utf16();
+
+    int nextAllowed = from; // Совпадения не перекрываются, как при последовательном поиске
+    auto consider = [&](int position)
+    {
+        if (position < nextAllowed || std::memcmp(h + position, p, size_t(length) * sizeof(ushort)) != 0)
+        {
+            return;
+        }
+        if (wholeWords &&
+            ((position > 0 && isWordChar(text.at(position - 1))) ||
+             (position + length < textLength && isWordChar(text.at(position + length)))))
+        {
+            return;
+        }
+        result.append(position);
+        nextAllowed = position + length;
+    };
+
+    int i = qMax(0, from);
+#ifdef __SSE2__
+    // Сравниваем сразу 8 позиций по первому и последнему символу образца,
+    // полное сравнение выполняется только для кандидатов
+    const __m128i firstChar = _mm_set1_epi16(short(p[0]));
+    const __m128i lastChar = _mm_set1_epi16(short(p[length - 1]));
+    for (; i + length - 1 + 8 <= textLength; i += 8)
+    {
+        const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i));
+        const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i + length - 1));
+        const __m128i equal = _mm_and_si128(_mm_cmpeq_epi16(blockFirst, firstChar), _mm_cmpeq_epi16(blockLast, lastChar));
+        quint32 mask = quint32(_mm_movemask_epi8(equal)) & 0x5555u; // Один бит на 16-битную позицию
+        while (mask)
+        {
+            consider(i + int(qCountTrailingZeroBits(mask)) / 2);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i + length <= textLength; ++i)
+    {
+        if (h[i] == p[0])
+        {
+            consider(i);
+        }
+    }
+    return result;
+}
+
+void SearchEngine::setQuery(const QString &pattern, Qt::CaseSensitivity cs, bool words)
+{
+    if (pattern == query && cs == caseSensitivity && words == wholeWords)
+    {
+        return;
+    }
+    query = pattern;
+    caseSensitivity = cs;
+    wholeWords = words;
+    rebuild();
+}
+
+int SearchEngine::nextMatch(int position) const
+{
+    auto it = std::lower_bound(matches.constBegin(), matches.constEnd(), position);
+    return it != matches.constEnd() ? int(it - matches.constBegin()) : -1;
+}
+
+int SearchEngine::previousMatch(int position) const
+{
+    auto it = std::upper_bound(matches.constBegin(), matches.constEnd(), position - query.size());
+    return it != matches.constBegin() ? int(it - matches.constBegin()) - 1 : -1;
+}
+
+void SearchEngine::rebuild()
+{
+    stale = false;
+    if (query.isEmpty())
+    {
+        building = false; // Результат фонового построения больше не нужен
+        matches.clear();
+        emit indexChanged();
+        return;
+    }
+
+    // Прежние позиции больше не верны: до готовности индекса совпадений нет
+    building = true;
+    matches.clear();
+    emit indexChanged();
+    watcher.setFuture(QtConcurrent::run(&SearchEngine::findAll, document->toPlainText(),
+                                        query, caseSensitivity, wholeWords));
+}
+
+void SearchEngine::takeResult()
+{
+    building = false;
+    if (stale)
+    {
+        rebuild(); // Результат устарел, пока строился
+        return;
+    }
+    matches = watcher.result();
+    emit indexChanged();
+}
+
+void SearchEngine::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if (query.isEmpty())
+    {
+        return;
+    }
+    if (building)
+    {
+        stale = true;
+        return;
+    }
+    if (charsRemoved > IncrementalLimit || charsAdded > IncrementalLimit)
+    {
+        rebuild();
+        return;
+    }
+
+    const int length = query.size();
+    const int delta = charsAdded - charsRemoved;
+    const int documentLength = document->characterCount() - 1;
+
+    // Совпадения до правки не меняются, если вместе с символом после них
+    // (граница слова) лежат до неё; поиск продолжается с конца последнего
+    // из них, как при последовательном просмотре
+    const auto keptEnd = std::lower_bound(matches.constBegin(), matches.constEnd(), position - length);
+    const int kept = int(keptEnd - matches.constBegin());
+    const int scanFrom = kept > 0 ? matches.at(kept - 1) + length : 0;
+
+    // За правкой текст тот же, что прежде, только сдвинут на delta. В точке за
+    // ней, которую не перекрывает ни новое, ни прежнее совпадение, обе цепочки
+    // свободны, и дальше просмотр повторил бы прежний: пересчёт заканчивается,
+    // а от этой точки берутся сдвинутые прежние совпадения
+    const int editEnd = position + charsAdded + 1; // Символ перед совпадением тоже за правкой
+    auto freePoint = [&](int lo, int hi)
+    {
+        int point = qMax(lo, editEnd);
+        auto it = matches.constBegin();
+        while (point <= hi)
+        {
+            it = std::upper_bound(it, matches.constEnd(), point - delta);
+            if (it == matches.constBegin() || *(it - 1) + length <= point - delta)
+            {
+                return point;
+            }
+            point = *(it - 1) + length + delta; // Конец прежнего совпадения, перекрывающего точку
+        }
+        return -1;
+    };
+
+    QVector<int> found;
+    int syncPoint = -1;
+    int from = scanFrom;
+    int windowEnd = position + charsAdded + length + 1;
+    int step = RescanWindow;
+    while (syncPoint < 0)
+    {
+        windowEnd = qMin(documentLength, windowEnd);
+        if (windowEnd - (position + charsAdded) > IncrementalLimit)
+        {
+            rebuild(); // Совпадения не сходятся с прежними на большом участке
+            return;
+        }
+
+        // Совпадение решено, только если символ после него уже в окне или это конец документа
+        const int windowStart = qMax(0, from - 1);
+        const QVector<int> windowMatches = findAll(documentText(windowStart, windowEnd), query, caseSensitivity,
+                                                   wholeWords, from - windowStart);
+        int nextAllowed = from;
+        for (int offset : windowMatches)
+        {
+            const int start = windowStart + offset;
+            if (start + length >= windowEnd && windowEnd < documentLength)
+            {
+                break;
+            }
+            syncPoint = freePoint(nextAllowed, start);
+            if (syncPoint >= 0)
+            {
+                break;
+            }
+            found.append(start);
+            nextAllowed = start + length;
+        }
+        if (syncPoint >= 0 || windowEnd >= documentLength)
+        {
+            break;
+        }
+
+        // Следующее окно начинается с первой нерешённой позиции
+        from = qMax(nextAllowed, windowEnd - length);
+        syncPoint = freePoint(nextAllowed, from);
+        windowEnd += step;
+        step *= 2;
+    }
+
+    QVector<int> updated;
+    updated.reserve(kept + found.size());
+    std::copy(matches.constBegin(), keptEnd, std::back_inserter(updated));
+    updated += found;
+    if (syncPoint >= 0)
+    {
+        const auto tailBegin = std::lower_bound(matches.constBegin(), matches.constEnd(), syncPoint - delta);
+        std::transform(tailBegin, matches.constEnd(), std::back_inserter(updated), [delta](int start)
+                       { return start + delta; });
+    }
+    matches.swap(updated);
+    emit indexChanged();
+}
+
+QString SearchEngine::documentText(int from, int to) const
+{
+    QTextCursor cursor(document);
+    cursor.setPosition(from);
+    cursor.setPosition(to, QTextCursor::KeepAnchor);
+    QString text = cursor.selectedText();
+
+    // Приводим фрагмент к виду QTextDocument::toPlainText(), чтобы позиции совпадали
+    for (QChar &ch : text)
+    {
+        switch (ch.unicode())
+        {
+        case 0xfdd0: // Начало фрейма
+        case 0xfdd1: // Конец фрейма
+        case QChar::ParagraphSeparator:
+        case QChar::LineSeparator:
+            ch = QLatin1Char('\n');
+            break;
+        case QChar::Nbsp:
+            ch = QLatin1Char(' ');
+            break;
+        default:
+            break;
+        }
+    }
+    return text;
+}
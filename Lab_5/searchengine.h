@@ -0,0 +1,63 @@
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QTextDocument>
+#include <QVector>
+
+// Индекс всех совпадений строки поиска в документе.
+// Полный индекс строится один раз в рабочем потоке, после правок документа
+// пересчитывается только участок от изменения до места, где совпадения
+// снова сходятся с прежними. Запросы не ждут построения: пока индекс не
+// готов, совпадений нет, а готовый индекс объявляется через indexChanged().
+class SearchEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SearchEngine(QTextDocument *document);
+    ~SearchEngine() override;
+
+    // Движок, закреплённый за документом (создаётся при первом обращении)
+    static SearchEngine *forDocument(QTextDocument *document);
+
+    // Все непересекающиеся вхождения pattern в text, начинающиеся не раньше from;
+    // символы до from нужны только для проверки границы слова
+    static QVector<int> findAll(const QString &text, const QString &pattern,
+                                Qt::CaseSensitivity cs, bool wholeWords, int from = 0);
+
+    void setQuery(const QString &pattern, Qt::CaseSensitivity cs, bool wholeWords);
+    int patternLength() const { return query.size(); }
+
+    // Индекс построен; до этого запросы ниже ничего не находят
+    bool isReady() const { return !building; }
+    int count() const { return matches.size(); }
+    const QVector<int> &positions() const { return matches; }
+    int nextMatch(int position) const;     // Первое совпадение, начинающееся не раньше position
+    int previousMatch(int position) const; // Последнее совпадение, заканчивающееся не позже position
+
+signals:
+    void indexChanged();
+
+private:
+    static const int IncrementalLimit = 64 * 1024; // Правки и пересчёты крупнее этого перестраивают индекс целиком
+    static const int RescanWindow = 4096;          // Начальный шаг пересчёта после правки
+
+    void rebuild();
+    void takeResult();
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    QString documentText(int from, int to) const;
+
+    QTextDocument *document;
+    QString query;
+    Qt::CaseSensitivity caseSensitivity;
+    bool wholeWords;
+
+    QVector<int> matches; // Начала совпадений по возрастанию
+    QFutureWatcher<QVector<int>> watcher;
+    bool building;
+    bool stale; // Документ изменился во время фонового построения
+};
+
+#endif // SEARCHENGINE_H
@@ -0,0 +1,131 @@
+#include "simulation.h"
+
+#include <algorithm>
+
+static const qint64 StepNs = 1000000000LL / Simulation::StepRate;
+
+Simulation::Simulation(QObject *parent)
+    : QObject(parent), timer(nullptr), lastTime(0), accumulator(0),
+      stateTime(0), collisions(0) {}
+
+void Simulation::setArea(const QRectF &area) {
+  QMutexLocker locker(&mutex);
+  world.setArea(area);
+}
+
+void Simulation::setObstacles(const QVector<QRectF> &bounds,
+                              const QVector<QPainterPath> &shapes) {
+  QMutexLocker locker(&mutex);
+  world.clearObstacles();
+  for (int i = 0; i < bounds.size(); ++i) {
+    world.addObstacle(bounds.at(i), shapes.value(i));
+  }
+}
+
+void Simulation::addBody(QGraphicsItemGroup *item, const QPointF &position,
+                         const QRectF &bounds, const QPointF &velocity) {
+  QMutexLocker locker(&mutex);
+  bodies.add(item, position, bounds, velocity);
+  previousX.append(position.x());
+  previousY.append(position.y());
+}
+
+bool Simulation::removeBody(const QGraphicsItem *item) {
+  QMutexLocker locker(&mutex);
+  int index = bodies.indexOf(item);
+  if (index < 0) {
+    return false;
+  }
+
+  // Предыдущие положения переставляем так же, как хранилище
+  bodies.remove(index);
+  previousX[index] = previousX.last();
+  previousX.removeLast();
+  previousY[index] = previousY.last();
+  previousY.removeLast();
+  return true;
+}
+
+void Simulation::clearBodies() {
+  QMutexLocker locker(&mutex);
+  bodies.clear();
+  previousX.clear();
+  previousY.clear();
+}
+
+bool Simulation::setBodyPosition(const QGraphicsItem *item,
+                                 const QPointF &position) {
+  QMutexLocker locker(&mutex);
+  int index = bodies.indexOf(item);
+  if (index < 0) {
+    return false;
+  }
+  bodies.setPosition(index, position);
+  previousX[index] = position.x(); // Без интерполяции от старого места
+  previousY[index] = position.y();
+  return true;
+}
+
+bool Simulation::containsBody(const QGraphicsItem *item) {
+  QMutexLocker locker(&mutex);
+  return bodies.contains(item);
+}
+
+QList<QGraphicsItemGroup *> Simulation::bodyItems() {
+  QMutexLocker locker(&mutex);
+  return bodies.itemList();
+}
+
+int Simulation::interpolate(QVector<QGraphicsItemGroup *> &items,
+                            QVector<QPointF> &positions) {
+  QMutexLocker locker(&mutex);
+
+  qreal alpha = clock.isValid()
+                    ? qreal(clock.nsecsElapsed() - stateTime) / StepNs
+                    : 1;
+  alpha = qBound<qreal>(0, alpha, 1);
+
+  const int count = bodies.size();
+  items.resize(count);
+  positions.resize(count);
+  for (int i = 0; i < count; ++i) {
+    items[i] = bodies.item(i);
+    positions[i] = QPointF(previousX.at(i) + (bodies.x.at(i) - previousX.at(i)) * alpha,
+                           previousY.at(i) + (bodies.y.at(i) - previousY.at(i)) * alpha);
+  }
+
+  int result = collisions;
+  collisions = 0;
+  return result;
+}
+
+void Simulation::start() {
+  // Таймер создаётся здесь, чтобы жить в потоке симуляции
+  timer = new QTimer(this);
+  timer->setTimerType(Qt::PreciseTimer);
+  connect(timer, &QTimer::timeout, this, &Simulation::advance);
+
+  clock.start();
+  timer->start(1000 / StepRate);
+}
+
+void Simulation::advance() {
+  QMutexLocker locker(&mutex);
+
+  qint64 now = clock.nsecsElapsed();
+  accumulator += now - lastTime;
+  lastTime = now;
+
+  int steps = 0;
+  while (accumulator >= StepNs && steps < MaxStepsPerTick) {
+    std::copy(bodies.x.constBegin(), bodies.x.constEnd(), previousX.begin());
+    std::copy(bodies.y.constBegin(), bodies.y.constEnd(), previousY.begin());
+    collisions += world.step(bodies, qreal(StepNs) / 1000000000LL);
+    accumulator -= StepNs;
+    ++steps;
+  }
+  if (steps == MaxStepsPerTick) {
+    accumulator %= StepNs; // Отставание не догоняем, иначе шаги будут копиться
+  }
+  stateTime = now - accumulator;
+}
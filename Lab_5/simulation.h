@@ -0,0 +1,64 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+#include "collisionworld.h"
+
+// Цикл физики с фиксированным шагом.
+// Реальное время копится в аккумуляторе и расходуется шагами по 1/StepRate с,
+// поэтому движение не зависит от дрожания таймера. Отрисовка берёт положения,
+// интерполированные между двумя последними шагами. Объект может жить в
+// рабочем потоке: открытые методы защищены мьютексом.
+class Simulation : public QObject {
+  Q_OBJECT
+
+public:
+  static const int StepRate = 120;       // Шагов симуляции в секунду
+  static const int MaxStepsPerTick = 8;  // Защита от лавины шагов после задержки
+
+  explicit Simulation(QObject *parent = nullptr);
+
+  void setArea(const QRectF &area);
+  void setObstacles(const QVector<QRectF> &bounds,
+                    const QVector<QPainterPath> &shapes);
+
+  // Тела адресуются элементами сцены; элементы только хранятся и
+  // никогда не разыменовываются вне потока GUI
+  void addBody(QGraphicsItemGroup *item, const QPointF &position,
+               const QRectF &bounds, const QPointF &velocity);
+  bool removeBody(const QGraphicsItem *item);
+  void clearBodies();
+  bool setBodyPosition(const QGraphicsItem *item, const QPointF &position);
+  bool containsBody(const QGraphicsItem *item);
+  QList<QGraphicsItemGroup *> bodyItems();
+
+  // Элементы и их положения для отрисовки. Возвращает число столкновений
+  // с прошлого вызова
+  int interpolate(QVector<QGraphicsItemGroup *> &items,
+                  QVector<QPointF> &positions);
+
+public slots:
+  void start();
+
+private:
+  void advance();
+
+  QMutex mutex;
+  CollisionWorld world;
+  BodyStore bodies;
+  QVector<qreal> previousX, previousY; // Положения на предыдущем шаге
+
+  QTimer *timer;
+  QElapsedTimer clock;
+  qint64 lastTime;    // Время прошлого тика таймера, нс
+  qint64 accumulator; // Ещё не просчитанное время, нс
+  qint64 stateTime;   // Момент, которому соответствует текущее состояние, нс
+  int collisions;
+};
+
+#endif // SIMULATION_H
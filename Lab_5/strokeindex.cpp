@@ -0,0 +1,125 @@
+#include "strokeindex.h"
+
+#include <QSet>
+#include <QtMath>
+
+#include "strokeitem.h"
+
+StrokeIndex::StrokeIndex(qreal cellSize) : cellSize(cellSize) {}
+
+StrokeIndex::~StrokeIndex() { clear(); }
+
+void StrokeIndex::insert(StrokeItem *stroke) {
+  const QVector<QPointF> &points = stroke->points();
+  stroke->setIndex(this);
+  if (points.size() == 1) {
+    insertSegment(stroke, points.first(), points.first());
+  }
+  for (int i = 1; i < points.size(); ++i) {
+    insertSegment(stroke, points.at(i - 1), points.at(i));
+  }
+}
+
+void StrokeIndex::insertLastSegment(StrokeItem *stroke) {
+  const QVector<QPointF> &points = stroke->points();
+  if (points.isEmpty()) {
+    return;
+  }
+  stroke->setIndex(this);
+
+  // Хвост, сдвинутый прореживанием, добавляется как новый отрезок: старые
+  // ячейки остаются, лишние кандидаты отсеет точная проверка
+  const QPointF from = points.size() >= 2 ? points.at(points.size() - 2)
+                                          : points.last();
+  insertSegment(stroke, from, points.last());
+}
+
+void StrokeIndex::remove(StrokeItem *stroke) {
+  auto it = strokeCells.find(stroke);
+  if (it == strokeCells.end()) {
+    return;
+  }
+
+  for (quint64 key : it.value()) {
+    auto cell = cells.find(key);
+    if (cell == cells.end()) {
+      continue;
+    }
+    cell.value().removeOne(stroke);
+    if (cell.value().isEmpty()) {
+      cells.erase(cell);
+    }
+  }
+  strokeCells.erase(it);
+  stroke->setIndex(nullptr);
+}
+
+void StrokeIndex::clear() {
+  for (auto it = strokeCells.constBegin(); it != strokeCells.constEnd(); ++it) {
+    it.key()->setIndex(nullptr);
+  }
+  strokeCells.clear();
+  cells.clear();
+}
+
+QVector<StrokeItem *> StrokeIndex::query(const QRectF &rect) const {
+  QVector<StrokeItem *> result;
+  QSet<StrokeItem *> seen;
+
+  int left = cellOf(rect.left());
+  int right = cellOf(rect.right());
+  int top = cellOf(rect.top());
+  int bottom = cellOf(rect.bottom());
+  for (int x = left; x <= right; ++x) {
+    for (int y = top; y <= bottom; ++y) {
+      auto cell = cells.constFind(cellKey(x, y));
+      if (cell == cells.constEnd()) {
+        continue;
+      }
+      for (StrokeItem *stroke : cell.value()) {
+        if (!seen.contains(stroke)) {
+          seen.insert(stroke);
+          result.append(stroke);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+quint64 StrokeIndex::cellKey(int x, int y) {
+  return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+int StrokeIndex::cellOf(qreal coordinate) const {
+  return qFloor(coordinate / cellSize);
+}
+
+void StrokeIndex::insertSegment(StrokeItem *stroke, const QPointF &from,
+                                const QPointF &to) {
+  // Ячейки габаритов отрезка с запасом на толщину пера
+  const qreal margin = qMax<qreal>(stroke->pen().widthF(), 1) / 2;
+  QRectF rect = QRectF(from, to).normalized().adjusted(-margin, -margin,
+                                                       margin, margin);
+
+  QVector<quint64> &occupied = strokeCells[stroke];
+  int left = cellOf(rect.left());
+  int right = cellOf(rect.right());
+  int top = cellOf(rect.top());
+  int bottom = cellOf(rect.bottom());
+  for (int x = left; x <= right; ++x) {
+    for (int y = top; y <= bottom; ++y) {
+      quint64 key = cellKey(x, y);
+      QVector<StrokeItem *> &cell = cells[key];
+      // Соседние отрезки штриха обычно попадают в те же ячейки
+      if (!cell.isEmpty() && cell.last() == stroke) {
+        continue;
+      }
+      if (cell.contains(stroke)) {
+        continue;
+      }
+      cell.append(stroke);
+      occupied.append(key);
+    }
+  }
+}
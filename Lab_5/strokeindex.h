@@ -0,0 +1,37 @@
+#ifndef STROKEINDEX_H
+#define STROKEINDEX_H
+
+#include <QHash>
+#include <QRectF>
+#include <QVector>
+
+class StrokeItem;
+
+// Пространственный индекс штрихов на равномерной сетке.
+// Штрих попадает в ячейки, через которые проходят его отрезки, поэтому
+// запрос ластика возвращает только штрихи рядом с ним, а не все, чьи
+// габариты случайно накрывают точку.
+class StrokeIndex {
+public:
+  explicit StrokeIndex(qreal cellSize = 64);
+  ~StrokeIndex();
+
+  void insert(StrokeItem *stroke);            // Все отрезки штриха
+  void insertLastSegment(StrokeItem *stroke); // Отрезок, только что добавленный при рисовании
+  void remove(StrokeItem *stroke);
+  void clear();
+
+  // Штрихи, отрезки которых могут пересекать прямоугольник (без повторов)
+  QVector<StrokeItem *> query(const QRectF &rect) const;
+
+private:
+  static quint64 cellKey(int x, int y);
+  int cellOf(qreal coordinate) const;
+  void insertSegment(StrokeItem *stroke, const QPointF &from, const QPointF &to);
+
+  qreal cellSize;
+  QHash<quint64, QVector<StrokeItem *>> cells;
+  QHash<StrokeItem *, QVector<quint64>> strokeCells; // Ячейки каждого штриха
+};
+
+#endif // STROKEINDEX_H
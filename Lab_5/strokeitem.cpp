@@ -0,0 +1,257 @@
+#include "strokeitem.h"
+
+#include <QPainterPathStroker>
+
+#include "strokeindex.h"
+
+// Минимальное расстояние между соседними вершинами штриха
+static const qreal MinDistance = 2.0;
+
+StrokeItem::StrokeItem(const QPen &pen, QGraphicsItem *parent)
+    : QGraphicsItem(parent), strokePen(pen), index(nullptr) {
+  setZValue(1);
+  setData(0, "user");
+}
+
+StrokeItem::~StrokeItem() {
+  if (index) {
+    index->remove(this);
+  }
+}
+
+void StrokeItem::addPoint(const QPointF &point) {
+  const int count = strokePoints.size();
+  if (count >= 2 &&
+      QLineF(strokePoints.at(count - 2), point).length() < MinDistance) {
+    strokePoints.last() = point; // Прореживание: двигаем хвост штриха
+  } else {
+    strokePoints.append(point);
+  }
+  outline = QPainterPath();
+
+  // Границы только растут, поэтому пересчёт индекса сцены нужен лишь при
+  // выходе точки за текущие габариты
+  if (count == 0) {
+    prepareGeometryChange();
+    pointsRect = QRectF(point, point);
+  } else if (!pointsRect.contains(point)) {
+    prepareGeometryChange();
+    pointsRect.setLeft(qMin(pointsRect.left(), point.x()));
+    pointsRect.setRight(qMax(pointsRect.right(), point.x()));
+    pointsRect.setTop(qMin(pointsRect.top(), point.y()));
+    pointsRect.setBottom(qMax(pointsRect.bottom(), point.y()));
+  }
+
+  // Перерисовываем только последний отрезок
+  const QPointF previous =
+      strokePoints.size() >= 2 ? strokePoints.at(strokePoints.size() - 2)
+                               : point;
+  const qreal m = margin();
+  update(QRectF(previous, point).normalized().adjusted(-m, -m, m, m));
+}
+
+void StrokeItem::setPoints(const QVector<QPointF> &points) {
+  prepareGeometryChange();
+  strokePoints = points;
+  outline = QPainterPath();
+
+  if (points.isEmpty()) {
+    pointsRect = QRectF();
+    return;
+  }
+  qreal left = points.first().x();
+  qreal right = left;
+  qreal top = points.first().y();
+  qreal bottom = top;
+  for (const QPointF &point : points) {
+    left = qMin(left, point.x());
+    right = qMax(right, point.x());
+    top = qMin(top, point.y());
+    bottom = qMax(bottom, point.y());
+  }
+  pointsRect = QRectF(QPointF(left, top), QPointF(right, bottom));
+}
+
+// Расстояние от точки до отрезка
+static qreal pointDistance(const QPointF &point, const QPointF &a,
+                           const QPointF &b) {
+  QPointF ab = b - a;
+  qreal length2 = QPointF::dotProduct(ab, ab);
+  qreal t = length2 > 0 ? QPointF::dotProduct(point - a, ab) / length2 : 0;
+  QPointF closest = a + ab * qBound<qreal>(0, t, 1);
+  return QLineF(point, closest).length();
+}
+
+// Расстояние между отрезками
+static qreal segmentDistance(const QPointF &p0, const QPointF &p1,
+                             const QPointF &a, const QPointF &b) {
+  if (QLineF(p0, p1).intersect(QLineF(a, b), nullptr) ==
+      QLineF::BoundedIntersection) {
+    return 0;
+  }
+  return qMin(qMin(pointDistance(p0, a, b), pointDistance(p1, a, b)),
+              qMin(pointDistance(a, p0, p1), pointDistance(b, p0, p1)));
+}
+
+// Участок [t0, t1] отрезка p0-p1, лежащий внутри капсулы. Расстояние до
+// капсулы вдоль прямой выпукло, поэтому участок один: ищем минимум
+// тернарным поиском, а границы - делением пополам
+static bool erasedInterval(const QPointF &p0, const QPointF &p1,
+                           const QPointF &a, const QPointF &b, qreal radius,
+                           qreal *t0, qreal *t1) {
+  auto distance = [&](qreal t) {
+    return pointDistance(p0 + (p1 - p0) * t, a, b);
+  };
+
+  qreal low = 0;
+  qreal high = 1;
+  for (int i = 0; i < 40; ++i) {
+    qreal m1 = low + (high - low) / 3;
+    qreal m2 = high - (high - low) / 3;
+    if (distance(m1) < distance(m2)) {
+      high = m2;
+    } else {
+      low = m1;
+    }
+  }
+  const qreal inside = (low + high) / 2;
+  if (distance(inside) > radius) {
+    return false;
+  }
+
+  *t0 = 0;
+  if (distance(0) > radius) {
+    qreal outside = 0;
+    qreal in = inside;
+    for (int i = 0; i < 30; ++i) {
+      qreal middle = (outside + in) / 2;
+      if (distance(middle) > radius) {
+        outside = middle;
+      } else {
+        in = middle;
+      }
+    }
+    *t0 = outside;
+  }
+
+  *t1 = 1;
+  if (distance(1) > radius) {
+    qreal in = inside;
+    qreal outside = 1;
+    for (int i = 0; i < 30; ++i) {
+      qreal middle = (in + outside) / 2;
+      if (distance(middle) > radius) {
+        outside = middle;
+      } else {
+        in = middle;
+      }
+    }
+    *t1 = outside;
+  }
+  return true;
+}
+
+QVector<QVector<QPointF>> StrokeItem::erase(const QPointF &from,
+                                            const QPointF &to, qreal radius,
+                                            bool *touched) const {
+  QVector<QVector<QPointF>> pieces;
+  *touched = false;
+
+  // Задевание краёв линии тоже стирает её
+  const qreal reach = radius + qMax<qreal>(strokePen.widthF(), 1) / 2;
+  if (!boundingRect().intersects(QRectF(from, to).normalized().adjusted(
+          -reach, -reach, reach, reach))) {
+    return pieces;
+  }
+
+  if (strokePoints.size() == 1) {
+    *touched = pointDistance(strokePoints.first(), from, to) <= reach;
+    if (!*touched) {
+      pieces.append(strokePoints);
+    }
+    return pieces;
+  }
+
+  QVector<QPointF> current;
+  for (int i = 1; i < strokePoints.size(); ++i) {
+    const QPointF &p0 = strokePoints.at(i - 1);
+    const QPointF &p1 = strokePoints.at(i);
+    qreal t0 = 0;
+    qreal t1 = 0;
+    if (segmentDistance(p0, p1, from, to) > reach ||
+        !erasedInterval(p0, p1, from, to, reach, &t0, &t1)) {
+      // Отрезок цел
+      if (current.isEmpty()) {
+        current.append(p0);
+      }
+      current.append(p1);
+      continue;
+    }
+
+    *touched = true;
+    if (t0 > 0) {
+      if (current.isEmpty()) {
+        current.append(p0);
+      }
+      current.append(p0 + (p1 - p0) * t0);
+    }
+    if (current.size() >= 2) {
+      pieces.append(current);
+    }
+    current.clear();
+    if (t1 < 1) {
+      current.append(p0 + (p1 - p0) * t1);
+      current.append(p1);
+    }
+  }
+  if (current.size() >= 2) {
+    pieces.append(current);
+  }
+
+  if (!*touched) {
+    pieces.clear();
+    pieces.append(strokePoints);
+  }
+  return pieces;
+}
+
+QRectF StrokeItem::boundingRect() const {
+  if (strokePoints.isEmpty()) {
+    return QRectF();
+  }
+  const qreal m = margin();
+  return pointsRect.adjusted(-m, -m, m, m);
+}
+
+QPainterPath StrokeItem::shape() const {
+  if (outline.isEmpty() && !strokePoints.isEmpty()) {
+    QPainterPath path;
+    path.addPolygon(QPolygonF(strokePoints));
+
+    QPainterPathStroker stroker;
+    stroker.setWidth(qMax<qreal>(strokePen.widthF(), 1));
+    stroker.setCapStyle(strokePen.capStyle());
+    stroker.setJoinStyle(strokePen.joinStyle());
+    outline = stroker.createStroke(path);
+  }
+  return outline;
+}
+
+void StrokeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *,
+                       QWidget *) {
+  painter->setPen(strokePen);
+  if (strokePoints.size() == 1) {
+    painter->drawPoint(strokePoints.first());
+  } else {
+    painter->drawPolyline(strokePoints.constData(), strokePoints.size());
+  }
+}
+
+qreal StrokeItem::margin() const {
+  // Половина толщины пера с учётом выступа острых соединений и сглаживания
+  const qreal width = qMax<qreal>(strokePen.widthF(), 1);
+  const qreal extent = strokePen.joinStyle() == Qt::MiterJoin
+                           ? width * qMax<qreal>(strokePen.miterLimit(), 1)
+                           : width;
+  return extent / 2 + 2;
+}
@@ -0,0 +1,57 @@
+#ifndef STROKEITEM_H
+#define STROKEITEM_H
+
+#include <QGraphicsItem>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPen>
+#include <QVector>
+
+class StrokeIndex;
+
+// Штрих свободного рисования: одна ломаная вместо отдельного элемента сцены
+// на каждый отрезок. Длинные штрихи делятся на куски по MaxPoints точек,
+// чтобы перерисовка и пересчёт формы оставались дешёвыми.
+class StrokeItem : public QGraphicsItem {
+public:
+  enum { Type = UserType + 1 };
+
+  static const int MaxPoints = 512; // Точек в одном куске штриха
+
+  explicit StrokeItem(const QPen &pen, QGraphicsItem *parent = nullptr);
+  ~StrokeItem() override;
+
+  int type() const override { return Type; }
+  QPen pen() const { return strokePen; }
+  const QVector<QPointF> &points() const { return strokePoints; }
+  bool isFull() const { return strokePoints.size() >= MaxPoints; }
+
+  // Добавляет точку. Точка ближе MinDistance к предыдущей заменяет
+  // последнюю, поэтому предпросмотр следует за курсором без лишних вершин
+  void addPoint(const QPointF &point);
+  void setPoints(const QVector<QPointF> &points);
+
+  // Стирание капсулой (отрезок from-to с радиусом radius). Возвращает
+  // уцелевшие куски ломаной; touched == false, если штрих не задет
+  QVector<QVector<QPointF>> erase(const QPointF &from, const QPointF &to,
+                                  qreal radius, bool *touched) const;
+
+  // Индекс, в котором зарегистрирован штрих; удалённый штрих убирает себя сам
+  void setIndex(StrokeIndex *strokeIndex) { index = strokeIndex; }
+
+  QRectF boundingRect() const override;
+  QPainterPath shape() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+             QWidget *widget = nullptr) override;
+
+private:
+  qreal margin() const;
+
+  QPen strokePen;
+  QVector<QPointF> strokePoints;
+  QRectF pointsRect;           // Габариты вершин без учёта толщины пера
+  mutable QPainterPath outline; // Кэш формы для выделения и ластика
+  StrokeIndex *index;
+};
+
+#endif // STROKEITEM_H
@@ -0,0 +1,309 @@
+#include "stylesidecar.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <algorithm>
+
+static const char *SettingsDirectory = "../Visual_Lab5/Lab_5/tabSettings";
+
+QString StyleSidecar::settingsPath(const QString &tableFile, const QString &extension)
+{
+    QDir settingsDir(SettingsDirectory);
+    return settingsDir.absoluteFilePath(QFileInfo(tableFile).fileName() + extension);
+}
+
+bool StyleSidecar::write(const TableModel *model, const QString &tableFile)
+{
+    return write(model->styles(), model->styledCells(), model->styleSpans(), model->sourceRowCount(),
+                 model->columnCount(), tableFile);
+}
+
+void StyleSidecar::writeStyle(QDataStream &out, const CellStyle &style)
+{
+    out << style.foreground << style.background << style.font.toString() << qint32(style.alignment);
+}
+
+CellStyle StyleSidecar::readStyle(QDataStream &in)
+{
+    CellStyle style;
+    QString font;
+    qint32 alignment;
+    in >> style.foreground >> style.background >> font >> alignment;
+    style.font.fromString(font);
+    style.alignment = alignment;
+    return style;
+}
+
+bool StyleSidecar::write(const QVector<CellStyle> &styles, const QHash<quint64, int> &styledCells,
+                         const QVector<StyleSpan> &spans, int rows, int columns, const QString &tableFile)
+{
+    QDir settingsDir(SettingsDirectory);
+    if (!settingsDir.exists() && !settingsDir.mkpath("."))
+    {
+        qDebug() << "Unable to create directory: " << settingsDir.absolutePath();
+        return false;
+    }
+
+    QSaveFile file(settingsPath(tableFile, ".styles"));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    // Ключи ячеек упорядочены так же, как ячейки при построчном обходе
+    QVector<quint64> keys;
+    keys.reserve(styledCells.size());
+    for (auto it = styledCells.constBegin(); it != styledCells.constEnd(); ++it)
+    {
+        keys.append(it.key());
+    }
+    std::sort(keys.begin(), keys.end());
+
+    // В файл попадают только используемые стили, номер 0 - стиль по умолчанию
+    QVector<int> remap(styles.size(), -1);
+    QVector<CellStyle> palette;
+    palette.append(styles.first());
+    remap[0] = 0;
+    for (quint64 key : keys)
+    {
+        int &id = remap[styledCells.value(key)];
+        if (id < 0)
+        {
+            id = palette.size();
+            palette.append(styles.at(styledCells.value(key)));
+        }
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << Magic << Version << qint32(rows) << qint32(columns) << quint32(palette.size());
+    for (const CellStyle &style : palette)
+    {
+        writeStyle(out, style);
+    }
+
+    // Серии (длина, номер стиля) покрывают всю таблицу
+    const quint64 cells = quint64(rows) * quint64(columns);
+    quint64 position = 0;
+    quint64 runLength = 0;
+    quint32 runId = 0;
+    auto emitRun = [&](quint64 length, quint32 id)
+    {
+        if (length == 0)
+        {
+            return;
+        }
+        if (id == runId)
+        {
+            runLength += length;
+            return;
+        }
+        if (runLength > 0)
+        {
+            out << runLength << runId;
+        }
+        runLength = length;
+        runId = id;
+    };
+    for (quint64 key : keys)
+    {
+        const quint64 row = key >> 32;
+        const quint64 column = key & 0xffffffffu;
+        if (row >= quint64(rows) || column >= quint64(columns))
+        {
+            continue;
+        }
+        const quint64 cell = row * quint64(columns) + column;
+        emitRun(cell - position, 0);
+        emitRun(1, quint32(remap.at(styledCells.value(key))));
+        position = cell + 1;
+    }
+    emitRun(cells - position, 0);
+    if (runLength > 0)
+    {
+        out << runLength << runId;
+    }
+
+    // Диапазоны - в порядке применения, граница "до конца" пишется как есть
+    out << quint32(spans.size());
+    for (const StyleSpan &span : spans)
+    {
+        out << qint32(span.range.top) << qint32(span.range.left) << qint32(span.range.bottom)
+            << qint32(span.range.right) << qint32(span.fields);
+        writeStyle(out, span.style);
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool StyleSidecar::read(TableModel *model, const QString &tableFile)
+{
+    const QString binaryPath = settingsPath(tableFile, ".styles");
+    if (QFileInfo::exists(binaryPath))
+    {
+        return readBinary(model, binaryPath);
+    }
+    const QString jsonPath = settingsPath(tableFile, ".json");
+    if (QFileInfo::exists(jsonPath))
+    {
+        return importJson(model, jsonPath);
+    }
+    return false;
+}
+
+bool StyleSidecar::readBinary(TableModel *model, const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic;
+    quint16 version;
+    qint32 rows, columns;
+    quint32 paletteSize;
+    in >> magic >> version >> rows >> columns >> paletteSize;
+    if (in.status() != QDataStream::Ok || magic != Magic || version < 1 || version > Version ||
+        rows < 0 || columns < 0 || paletteSize == 0)
+    {
+        qDebug() << "Unsupported style file: " << path;
+        return false;
+    }
+
+    QVector<CellStyle> palette;
+    palette.reserve(int(qMin<quint32>(paletteSize, 4096)));
+    for (quint32 i = 0; i < paletteSize && in.status() == QDataStream::Ok; ++i)
+    {
+        palette.append(readStyle(in));
+    }
+
+    // Таблица могла измениться с момента сохранения: лишние ячейки отбрасываются
+    const int modelRows = model->sourceRowCount();
+    const int modelColumns = model->columnCount();
+    const quint64 cells = quint64(rows) * quint64(columns);
+    QHash<quint64, int> cellStyles;
+    quint64 position = 0;
+    while (position < cells && in.status() == QDataStream::Ok)
+    {
+        quint64 length;
+        quint32 id;
+        in >> length >> id;
+        if (in.status() != QDataStream::Ok || length == 0 || length > cells - position ||
+            id >= quint32(palette.size()))
+        {
+            qDebug() << "Corrupted style file: " << path;
+            return false;
+        }
+        if (id != 0)
+        {
+            for (quint64 cell = position; cell < position + length; ++cell)
+            {
+                const int row = int(cell / quint64(columns));
+                const int column = int(cell % quint64(columns));
+                if (row < modelRows && column < modelColumns)
+                {
+                    cellStyles.insert(TableModel::cellKey(row, column), int(id));
+                }
+            }
+        }
+        position += length;
+    }
+
+    QVector<StyleSpan> spans;
+    if (version >= 2)
+    {
+        quint32 count = 0;
+        in >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+        {
+            qint32 top, left, bottom, right, fields;
+            in >> top >> left >> bottom >> right >> fields;
+            const CellStyle style = readStyle(in);
+            if (top < 0 || left < 0 || top > bottom || left > right)
+            {
+                continue;
+            }
+            spans.append(StyleSpan{CellRange{top, left, bottom, right}, fields & StyleSpan::AllFields, style});
+        }
+        if (in.status() != QDataStream::Ok)
+        {
+            qDebug() << "Corrupted style file: " << path;
+            return false;
+        }
+    }
+
+    model->setStyles(palette, cellStyles, spans);
+    return true;
+}
+
+bool StyleSidecar::importJson(TableModel *model, const QString &path)
+{
+    QFile settingsFile(path);
+    if (!settingsFile.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QJsonDocument settingsDoc = QJsonDocument::fromJson(settingsFile.readAll());
+    QJsonArray cellSettingsArray = settingsDoc.array();
+
+    // Одинаковые оформления сводятся в палитру, шрифт разбирается один раз на строку
+    QVector<CellStyle> palette;
+    palette.append(model->styles().first());
+    QHash<CellStyle, int> paletteIds;
+    paletteIds.insert(palette.first(), 0);
+    QHash<QString, QFont> fonts;
+    QHash<quint64, int> cellStyles;
+
+    const int rows = qMin(cellSettingsArray.size(), model->sourceRowCount());
+    for (int i = 0; i < rows; ++i)
+    {
+        QJsonArray rowSettings = cellSettingsArray[i].toArray();
+        const int columns = qMin(rowSettings.size(), model->columnCount());
+        for (int j = 0; j < columns; ++j)
+        {
+            QJsonObject cellSettings = rowSettings[j].toObject();
+            CellStyle style;
+            style.foreground = QColor(cellSettings["textColor"].toString());
+            style.background = QColor(cellSettings["backgroundColor"].toString());
+            const QString fontString = cellSettings["font"].toString();
+            auto font = fonts.constFind(fontString);
+            if (font == fonts.constEnd())
+            {
+                QFont parsed;
+                parsed.fromString(fontString);
+                font = fonts.insert(fontString, parsed);
+            }
+            style.font = font.value();
+            if (cellSettings["alignment"].toInt() != 0)
+            {
+                style.alignment = cellSettings["alignment"].toInt();
+            }
+
+            auto id = paletteIds.constFind(style);
+            if (id == paletteIds.constEnd())
+            {
+                palette.append(style);
+                id = paletteIds.insert(style, palette.size() - 1);
+            }
+            if (id.value() != 0)
+            {
+                cellStyles.insert(TableModel::cellKey(i, j), id.value());
+            }
+        }
+    }
+
+    model->setStyles(palette, cellStyles);
+    return true;
+}
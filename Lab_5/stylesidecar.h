@@ -0,0 +1,35 @@
+#ifndef STYLESIDECAR_H
+#define STYLESIDECAR_H
+
+#include <QDataStream>
+#include <QString>
+
+#include "tablemodel.h"
+
+// Файл оформления таблицы, хранящийся рядом с настройками вкладок.
+// Двоичный формат: палитра уникальных стилей и номера стилей ячеек,
+// сжатые по сериям в построчном порядке, за ними (с версии 2) диапазоны
+// оформления строк, столбцов и прямоугольников. Файлы версии 1 читаются
+// без диапазонов, старые JSON-файлы с объектом на каждую ячейку - импортёром.
+class StyleSidecar
+{
+public:
+    static const quint32 Magic = 0x4c535459; // "LSTY"
+    static const quint16 Version = 2;
+
+    static bool write(const TableModel *model, const QString &tableFile);
+    // Запись по снимку оформления; безопасна в рабочем потоке
+    static bool write(const QVector<CellStyle> &styles, const QHash<quint64, int> &styledCells,
+                      const QVector<StyleSpan> &spans, int rows, int columns, const QString &tableFile);
+    // Двоичный файл, если он есть, иначе JSON прежнего формата
+    static bool read(TableModel *model, const QString &tableFile);
+
+private:
+    static QString settingsPath(const QString &tableFile, const QString &extension);
+    static bool readBinary(TableModel *model, const QString &path);
+    static void writeStyle(QDataStream &out, const CellStyle &style);
+    static CellStyle readStyle(QDataStream &in);
+    static bool importJson(TableModel *model, const QString &path);
+};
+
+#endif // STYLESIDECAR_H
@@ -0,0 +1,649 @@
+#include "tablecolumn.h"
+
+#include <QDate>
+#include <QLocale>
+#include <QtNumeric>
+
+#include <algorithm>
+
+// Кратчайшая запись, из которой число читается обратно без потерь
+static QString formatFloat(double value)
+{
+    return QString::number(value, 'g', QLocale::FloatingPointShortest);
+}
+
+TableColumn::TableColumn() : TableColumn(0)
+{
+}
+
+TableColumn::TableColumn(int rows) : columnType(Integer),
+                                     rows(rows),
+                                     values(0),
+                                     nulls((rows + 63) / 64, ~quint64(0)),
+                                     integers(rows, 0),
+                                     garbage(0)
+{
+}
+
+bool TableColumn::isEmpty(int row) const
+{
+    if (columnType == String)
+    {
+        return lengths.at(row) == 0;
+    }
+    return nulls.at(row >> 6) & (quint64(1) << (row & 63));
+}
+
+QString TableColumn::text(int row) const
+{
+    if (columnType == String)
+    {
+        return arena.mid(offsets.at(row), lengths.at(row));
+    }
+    if (isEmpty(row))
+    {
+        return QString();
+    }
+    if (!others.isEmpty())
+    {
+        auto it = others.constFind(row);
+        if (it != others.constEnd())
+        {
+            return it.value();
+        }
+    }
+
+    switch (columnType)
+    {
+    case Integer:
+        return QString::number(integers.at(row));
+    case Float:
+        return formatFloat(floats.at(row));
+    case Date:
+        return QDate::fromJulianDay(integers.at(row)).toString(Qt::ISODate);
+    default:
+        return QString();
+    }
+}
+
+double TableColumn::number(int row) const
+{
+    return columnType == Float ? floats.at(row) : double(integers.at(row));
+}
+
+bool TableColumn::toNumber(const QString &text, double &value) const
+{
+    switch (columnType)
+    {
+    case Integer:
+    case Float:
+    {
+        bool ok = false;
+        value = text.trimmed().toDouble(&ok);
+        return ok;
+    }
+    case Date:
+    {
+        const QDate date = QDate::fromString(text.trimmed(), Qt::ISODate);
+        value = double(date.toJulianDay());
+        return date.isValid();
+    }
+    default:
+        return false;
+    }
+}
+
+void TableColumn::setText(int row, const QString &text)
+{
+    if (!store(row, text))
+    {
+        // Значение не укладывается в тип столбца: столбец расширяется
+        convert(widerType(text));
+        store(row, text);
+    }
+}
+
+void TableColumn::append(const QString &text)
+{
+    if (columnType == String)
+    {
+        offsets.append(text.isEmpty() ? 0 : arena.size());
+        lengths.append(text.size());
+        arena.append(text);
+        ++rows;
+        return;
+    }
+
+    if (columnType == Float)
+    {
+        floats.append(0.0);
+    }
+    else
+    {
+        integers.append(0);
+    }
+    if ((rows & 63) == 0)
+    {
+        nulls.append(~quint64(0));
+    }
+    else
+    {
+        setNull(rows, true);
+    }
+    ++rows;
+
+    if (!text.isEmpty())
+    {
+        setText(rows - 1, text);
+    }
+}
+
+void TableColumn::insert(const IndexShift &shift)
+{
+    const int count = shift.total();
+    const QVector<IndexRange> &ranges = shift.ranges();
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Ячейки переносятся на новые места с конца за один проход, новые ячейки пустые
+    if (columnType == String)
+    {
+        offsets.resize(rows + count);
+        lengths.resize(rows + count);
+        for (int i = rows - 1; i >= 0; --i)
+        {
+            const int target = shift.map(i);
+            offsets[target] = offsets.at(i);
+            lengths[target] = lengths.at(i);
+        }
+        for (int k = 0; k < ranges.size(); ++k)
+        {
+            const int first = shift.map(ranges.at(k).first) - ranges.at(k).count;
+            std::fill(offsets.begin() + first, offsets.begin() + first + ranges.at(k).count, 0);
+            std::fill(lengths.begin() + first, lengths.begin() + first + ranges.at(k).count, 0);
+        }
+        rows += count;
+        return;
+    }
+
+    nulls.resize((rows + count + 63) / 64);
+    if (columnType == Float)
+    {
+        floats.resize(rows + count);
+    }
+    else
+    {
+        integers.resize(rows + count);
+    }
+    for (int i = rows - 1; i >= 0; --i)
+    {
+        const int target = shift.map(i);
+        if (columnType == Float)
+        {
+            floats[target] = floats.at(i);
+        }
+        else
+        {
+            integers[target] = integers.at(i);
+        }
+        setNull(target, isEmpty(i));
+    }
+    for (const IndexRange &range : ranges)
+    {
+        const int first = shift.map(range.first) - range.count;
+        for (int i = first; i < first + range.count; ++i)
+        {
+            setNull(i, true);
+        }
+    }
+    rows += count;
+    shiftOthers(shift);
+}
+
+void TableColumn::remove(const IndexShift &shift)
+{
+    const QVector<IndexRange> &ranges = shift.ranges();
+    if (shift.total() == 0)
+    {
+        return;
+    }
+
+    // Оставшиеся ячейки сдвигаются к началу за один проход
+    int write = 0;
+    int next = 0; // Ближайший участок, который ещё не пройден
+    for (int read = 0; read < rows; ++read)
+    {
+        if (next < ranges.size() && read == ranges.at(next).first + ranges.at(next).count)
+        {
+            ++next;
+        }
+        if (next < ranges.size() && read >= ranges.at(next).first)
+        {
+            if (columnType == String)
+            {
+                garbage += lengths.at(read);
+            }
+            else if (hasValue(read))
+            {
+                --values;
+            }
+            continue;
+        }
+
+        if (write != read)
+        {
+            switch (columnType)
+            {
+            case String:
+                offsets[write] = offsets.at(read);
+                lengths[write] = lengths.at(read);
+                break;
+            case Float:
+                floats[write] = floats.at(read);
+                setNull(write, isEmpty(read));
+                break;
+            default:
+                integers[write] = integers.at(read);
+                setNull(write, isEmpty(read));
+                break;
+            }
+        }
+        ++write;
+    }
+    rows = write;
+
+    if (columnType == String)
+    {
+        offsets.resize(rows);
+        lengths.resize(rows);
+        if (garbage > 4096 && garbage > arena.size() / 2)
+        {
+            compact();
+        }
+        return;
+    }
+
+    if (columnType == Float)
+    {
+        floats.resize(rows);
+    }
+    else
+    {
+        integers.resize(rows);
+    }
+    nulls.resize((rows + 63) / 64);
+    shiftOthers(shift);
+}
+
+void TableColumn::reserve(int rows)
+{
+    switch (columnType)
+    {
+    case String:
+        offsets.reserve(rows);
+        lengths.reserve(rows);
+        break;
+    case Float:
+        floats.reserve(rows);
+        nulls.reserve((rows + 63) / 64);
+        break;
+    default:
+        integers.reserve(rows);
+        nulls.reserve((rows + 63) / 64);
+        break;
+    }
+}
+
+void TableColumn::write(QDataStream &stream) const
+{
+    stream << qint32(columnType) << qint32(rows) << qint32(values);
+    if (columnType == String)
+    {
+        stream << arena << offsets << lengths << qint32(garbage);
+    }
+    else
+    {
+        stream << nulls << integers << floats << others;
+    }
+}
+
+bool TableColumn::read(QDataStream &stream)
+{
+    qint32 type = 0;
+    qint32 size = 0;
+    qint32 count = 0;
+    stream >> type >> size >> count;
+    if (stream.status() != QDataStream::Ok || type < Integer || type > String || size < 0 || count < 0)
+    {
+        return false;
+    }
+
+    TableColumn column;
+    column.columnType = Type(type);
+    column.rows = size;
+    column.values = count;
+    column.nulls.clear();
+    column.integers.clear();
+    if (column.columnType == String)
+    {
+        qint32 unused = 0;
+        stream >> column.arena >> column.offsets >> column.lengths >> unused;
+        column.garbage = unused;
+        if (stream.status() != QDataStream::Ok || column.offsets.size() != size || column.lengths.size() != size)
+        {
+            return false;
+        }
+        for (int row = 0; row < size; ++row)
+        {
+            const int offset = column.offsets.at(row);
+            const int length = column.lengths.at(row);
+            if (offset < 0 || length < 0 || length > column.arena.size() - offset)
+            {
+                return false;
+            }
+        }
+    }
+    else
+    {
+        stream >> column.nulls >> column.integers >> column.floats >> column.others;
+        const int valuesSize = column.columnType == Float ? column.floats.size() : column.integers.size();
+        if (stream.status() != QDataStream::Ok || column.nulls.size() != (size + 63) / 64 || valuesSize != size ||
+            (!column.others.isEmpty() && (column.others.firstKey() < 0 || column.others.lastKey() >= size)))
+        {
+            return false;
+        }
+    }
+
+    *this = column;
+    return true;
+}
+
+bool TableColumn::parse(const QString &text, Type type, qint64 &integer, double &number)
+{
+    const int length = text.size();
+    switch (type)
+    {
+    case Integer:
+    {
+        // Каноническая запись: без плюса, ведущих нулей и "-0"
+        const int first = text.startsWith(QLatin1Char('-')) ? 1 : 0;
+        if (length == first || length - first > 19 ||
+            (text.at(first) == QLatin1Char('0') && (first == 1 || length > 1)))
+        {
+            return false;
+        }
+        for (int i = first; i < length; ++i)
+        {
+            const ushort ch = text.at(i).unicode();
+            if (ch < '0' || ch > '9')
+            {
+                return false;
+            }
+        }
+        bool ok = false;
+        integer = text.toLongLong(&ok);
+        return ok;
+    }
+    case Float:
+    {
+        // Быстрый отказ для обычного текста, чтобы не форматировать число зря
+        if (length == 0 || length > 32)
+        {
+            return false;
+        }
+        const ushort ch = text.at(0).unicode();
+        if (ch != '-' && ch != '.' && (ch < '0' || ch > '9'))
+        {
+            return false;
+        }
+        bool ok = false;
+        number = text.toDouble(&ok);
+        return ok && qIsFinite(number) && formatFloat(number) == text;
+    }
+    case Date:
+    {
+        if (length != 10 || text.at(4) != QLatin1Char('-') || text.at(7) != QLatin1Char('-'))
+        {
+            return false;
+        }
+        const QDate date = QDate::fromString(text, Qt::ISODate);
+        if (!date.isValid() || date.toString(Qt::ISODate) != text)
+        {
+            return false;
+        }
+        integer = date.toJulianDay();
+        return true;
+    }
+    case String:
+        return true;
+    }
+    return false;
+}
+
+TableColumn::Type TableColumn::inferType(const QString &text)
+{
+    qint64 integer = 0;
+    double number = 0.0;
+    for (Type type : {Integer, Float, Date})
+    {
+        if (parse(text, type, integer, number))
+        {
+            return type;
+        }
+    }
+    return String;
+}
+
+TableColumn::Type TableColumn::widerType(const QString &text) const
+{
+    const Type type = inferType(text);
+    if (values == 0)
+    {
+        return type; // В столбце ещё нет значений, тип выбирается по первому
+    }
+    return columnType == Integer && type == Float ? Float : String;
+}
+
+bool TableColumn::store(int row, const QString &text)
+{
+    if (columnType == String)
+    {
+        const int oldLength = lengths.at(row);
+        const int newLength = text.size();
+
+        if (newLength <= oldLength)
+        {
+            // Новый текст помещается на место старого, арена не растёт
+            std::copy(text.constBegin(), text.constEnd(), arena.begin() + offsets.at(row));
+            garbage += oldLength - newLength;
+        }
+        else
+        {
+            offsets[row] = arena.size();
+            arena.append(text);
+            garbage += oldLength;
+        }
+        lengths[row] = newLength;
+
+        if (newLength == 0)
+        {
+            offsets[row] = 0;
+        }
+
+        // Пересобираем арену, когда мусора в ней становится больше, чем данных
+        if (garbage > 4096 && garbage > arena.size() / 2)
+        {
+            compact();
+        }
+        return true;
+    }
+
+    const bool wasValue = hasValue(row);
+    if (text.isEmpty())
+    {
+        others.remove(row);
+        setNull(row, true);
+        values -= wasValue;
+        return true;
+    }
+
+    qint64 integer = 0;
+    double number = 0.0;
+    if (parse(text, columnType, integer, number))
+    {
+        others.remove(row);
+        if (columnType == Float)
+        {
+            floats[row] = number;
+        }
+        else
+        {
+            integers[row] = integer;
+        }
+        values += !wasValue;
+    }
+    else
+    {
+        // Значение другого типа меняет тип столбца, а редкий текст хранится отдельно
+        const Type type = inferType(text);
+        if ((type != String && (values == 0 || (columnType == Integer && type == Float))) ||
+            (!others.contains(row) && others.size() >= qMax(MaxOthers, values / 8)))
+        {
+            return false;
+        }
+        others.insert(row, text);
+        values -= wasValue;
+    }
+    setNull(row, false);
+    return true;
+}
+
+void TableColumn::convert(Type newType)
+{
+    if (newType == columnType)
+    {
+        return;
+    }
+
+    if (newType == String)
+    {
+        QString newArena;
+        QVector<int> newOffsets(rows, 0);
+        QVector<int> newLengths(rows, 0);
+        for (int row = 0; row < rows; ++row)
+        {
+            const QString cell = text(row);
+            if (!cell.isEmpty())
+            {
+                newOffsets[row] = newArena.size();
+                newLengths[row] = cell.size();
+                newArena.append(cell);
+            }
+        }
+
+        arena.swap(newArena);
+        others.clear();
+        offsets.swap(newOffsets);
+        lengths.swap(newLengths);
+        garbage = 0;
+        nulls = QVector<quint64>();
+        integers = QVector<qint64>();
+        floats = QVector<double>();
+        columnType = String;
+        return;
+    }
+
+    if (values == 0)
+    {
+        // Пустой столбец: переносить нечего
+        if (newType == Float)
+        {
+            floats = QVector<double>(rows, 0.0);
+            integers = QVector<qint64>();
+        }
+        else
+        {
+            integers = QVector<qint64>(rows, 0);
+            floats = QVector<double>();
+        }
+        columnType = newType;
+        return;
+    }
+
+    // Целые становятся дробными, только если запись каждого значения не меняется
+    const qint64 exactLimit = Q_INT64_C(1) << 53;
+    QVector<double> converted(rows, 0.0);
+    for (int row = 0; row < rows; ++row)
+    {
+        const qint64 value = integers.at(row);
+        if (!hasValue(row))
+        {
+            continue;
+        }
+        if (value > exactLimit || value < -exactLimit || formatFloat(double(value)) != QString::number(value))
+        {
+            convert(String);
+            return;
+        }
+        converted[row] = double(value);
+    }
+    floats.swap(converted);
+    integers = QVector<qint64>();
+    columnType = Float;
+}
+
+void TableColumn::shiftOthers(const IndexShift &shift)
+{
+    if (others.isEmpty())
+    {
+        return;
+    }
+
+    // Номера строк переводятся в новые, удалённые строки выпадают; порядок ключей сохраняется
+    QMap<int, QString> shifted;
+    for (auto it = others.constBegin(); it != others.constEnd(); ++it)
+    {
+        const int row = shift.map(it.key());
+        if (row >= 0)
+        {
+            shifted.insert(shifted.constEnd(), row, it.value());
+        }
+    }
+    others.swap(shifted);
+}
+
+void TableColumn::setNull(int row, bool null)
+{
+    const quint64 bit = quint64(1) << (row & 63);
+    if (null)
+    {
+        nulls[row >> 6] |= bit;
+    }
+    else
+    {
+        nulls[row >> 6] &= ~bit;
+    }
+}
+
+void TableColumn::compact()
+{
+    QString compacted;
+    compacted.reserve(arena.size() - garbage);
+
+    for (int row = 0; row < offsets.size(); ++row)
+    {
+        const int length = lengths.at(row);
+        if (length == 0)
+        {
+            continue;
+        }
+        const int offset = offsets.at(row);
+        offsets[row] = compacted.size();
+        compacted.append(arena.constData() + offset, length);
+    }
+
+    arena.swap(compacted);
+    garbage = 0;
+}
@@ -0,0 +1,91 @@
+#ifndef TABLECOLUMN_H
+#define TABLECOLUMN_H
+
+#include <QDataStream>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+#include "indexshift.h"
+
+// Столбец таблицы в колоночном хранилище.
+// Тип столбца выводится из его значений: целые и дробные числа и даты лежат
+// непрерывными массивами, а текст для отображения получается из значения
+// только по запросу. Значение принимается за число или дату, только если его
+// каноническая запись совпадает с исходным текстом, поэтому текст ячейки
+// восстанавливается без изменений. Пустые ячейки такого столбца отмечены в
+// битовой карте, а редкий текст не по типу (заголовок, "н/д") хранится
+// отдельно и не делает столбец строковым. Строковый столбец хранит текст
+// всех ячеек подряд в одной строке-арене, ячейка хранит только смещение и
+// длину.
+class TableColumn
+{
+public:
+    enum Type
+    {
+        Integer,
+        Float,
+        Date, // Дата ISO 8601, хранится номером юлианского дня
+        String
+    };
+
+    TableColumn();
+    explicit TableColumn(int rows);
+
+    Type type() const { return columnType; }
+    int size() const { return rows; }
+    bool isEmpty(int row) const;
+    QString text(int row) const;
+    // Текст ячейки строкового столбца без копирования; действителен, пока столбец не изменён
+    QStringRef textRef(int row) const { return QStringRef(&arena, offsets.at(row), lengths.at(row)); }
+    // Ячейка хранит значение типа столбца, а не пустоту и не текст
+    bool hasValue(int row) const { return columnType != String && !isEmpty(row) && !others.contains(row); }
+    // Значения для сравнения и подсчётов: integer() для Integer и Date, number() для всех
+    // числовых типов (для дат - номер дня)
+    qint64 integer(int row) const { return integers.at(row); }
+    double number(int row) const;
+    // Текст, введённый для сравнения со значениями столбца, в той же шкале, что и number()
+    bool toNumber(const QString &text, double &value) const;
+
+    void setText(int row, const QString &text);
+    void append(const QString &text);
+    // Вставка и удаление нескольких участков строк за один проход по столбцу
+    void insert(const IndexShift &shift);
+    void remove(const IndexShift &shift);
+    void reserve(int rows);
+
+    // Столбец целиком, с типом, битовой картой и текстом не по типу: после
+    // чтения он тот же, что и при записи. read() не меняет столбец, если
+    // запись повреждена
+    void write(QDataStream &stream) const;
+    bool read(QDataStream &stream);
+
+private:
+    static const int MaxOthers = 16; // Столько ячеек не по типу допускается всегда, дальше - не больше 1/8 значений
+
+    static bool parse(const QString &text, Type type, qint64 &integer, double &number);
+    static Type inferType(const QString &text);
+
+    bool store(int row, const QString &text);
+    Type widerType(const QString &text) const;
+    void convert(Type newType);
+    void shiftOthers(const IndexShift &shift);
+    void setNull(int row, bool null);
+    void compact();
+
+    Type columnType;
+    int rows;
+    int values; // Ячейки со значениями; пока их нет, тип числового столбца выбирается заново
+
+    QVector<quint64> nulls;    // Пустые ячейки числового столбца, по биту на строку
+    QVector<qint64> integers;  // Значения Integer и Date
+    QVector<double> floats;    // Значения Float
+    QMap<int, QString> others; // Текст ячеек числового столбца, не подходящий под тип
+
+    QString arena;        // Текст всех ячеек строкового столбца подряд
+    QVector<int> offsets; // Начало текста ячейки в арене
+    QVector<int> lengths; // Длина текста ячейки
+    int garbage;          // Символы арены, на которые больше не ссылается ни одна ячейка
+};
+
+#endif // TABLECOLUMN_H
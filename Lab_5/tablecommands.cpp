@@ -0,0 +1,426 @@
+#include "tablecommands.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QTimer>
+
+#include <algorithm>
+
+// Ключи ячеек пишутся разностями с предыдущим: у соседних ячеек это малые
+// числа, которые хорошо сжимаются
+static void writeKeys(QDataStream &stream, const QVector<quint64> &keys)
+{
+    stream << quint32(keys.size());
+    quint64 previous = 0;
+    for (quint64 key : keys)
+    {
+        stream << quint64(key - previous);
+        previous = key;
+    }
+}
+
+static QVector<quint64> readKeys(QDataStream &stream)
+{
+    quint32 count = 0;
+    stream >> count;
+    QVector<quint64> keys;
+    quint64 previous = 0;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        quint64 difference = 0;
+        stream >> difference;
+        previous += difference;
+        keys.append(previous);
+    }
+    return keys;
+}
+
+static void writeStyle(QDataStream &stream, const CellStyle &style)
+{
+    stream << style.foreground << style.background << style.font << qint32(style.alignment);
+}
+
+static CellStyle readStyle(QDataStream &stream)
+{
+    CellStyle style;
+    qint32 alignment = 0;
+    stream >> style.foreground >> style.background >> style.font >> alignment;
+    style.alignment = alignment;
+    return style;
+}
+
+static void writeSpans(QDataStream &stream, const QVector<StyleSpan> &spans)
+{
+    stream << quint32(spans.size());
+    for (const StyleSpan &span : spans)
+    {
+        stream << qint32(span.range.top) << qint32(span.range.left) << qint32(span.range.bottom)
+               << qint32(span.range.right) << qint32(span.fields);
+        writeStyle(stream, span.style);
+    }
+}
+
+static QVector<StyleSpan> readSpans(QDataStream &stream)
+{
+    quint32 count = 0;
+    stream >> count;
+    QVector<StyleSpan> spans;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        qint32 top = 0;
+        qint32 left = 0;
+        qint32 bottom = 0;
+        qint32 right = 0;
+        qint32 fields = 0;
+        stream >> top >> left >> bottom >> right >> fields;
+        spans.append(StyleSpan{CellRange{top, left, bottom, right}, fields, readStyle(stream)});
+    }
+    return spans;
+}
+
+static QByteArray packCells(const CellDelta &delta)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+    writeKeys(stream, delta.cells);
+    stream << delta.textsBefore << delta.textsAfter;
+    return data;
+}
+
+// false, если запись не прочитана или повреждена
+static bool unpackCells(const QByteArray &data, CellDelta &delta)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_12);
+    delta = CellDelta();
+    delta.cells = readKeys(stream);
+    stream >> delta.textsBefore >> delta.textsAfter;
+
+    // Повреждённая запись не применяется частично
+    return stream.status() == QDataStream::Ok && delta.textsBefore.size() == delta.cells.size() &&
+           delta.textsAfter.size() == delta.cells.size();
+}
+
+static void writeState(QDataStream &stream, const OrderCommand::State &state)
+{
+    stream << state.ordered << state.order << quint32(state.keys.size());
+    for (const SortKey &key : state.keys)
+    {
+        stream << qint32(key.column) << qint32(key.order);
+    }
+    stream << quint32(state.filters.size());
+    for (const RowFilter &filter : state.filters)
+    {
+        stream << qint32(filter.column) << qint32(filter.condition) << filter.value;
+    }
+}
+
+static OrderCommand::State readState(QDataStream &stream)
+{
+    OrderCommand::State state;
+    quint32 count = 0;
+    stream >> state.ordered >> state.order >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        qint32 column = 0;
+        qint32 order = 0;
+        stream >> column >> order;
+        state.keys.append(SortKey{column, Qt::SortOrder(order)});
+    }
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        qint32 column = 0;
+        qint32 condition = 0;
+        QString value;
+        stream >> column >> condition >> value;
+        state.filters.append(RowFilter{column, RowFilter::Condition(condition), value});
+    }
+    return state;
+}
+
+// Удалённые столбцы пишутся вместе с типом и значениями, поэтому при возврате
+// столбец тот же, что был до удаления
+static QByteArray packSlice(const TableSlice &slice)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << slice.rows << quint32(slice.columns.size());
+    for (const TableColumn &column : slice.columns)
+    {
+        column.write(stream);
+    }
+
+    QVector<quint64> keys;
+    keys.reserve(slice.styles.size());
+    for (auto it = slice.styles.constBegin(); it != slice.styles.constEnd(); ++it)
+    {
+        keys.append(it.key());
+    }
+    std::sort(keys.begin(), keys.end());
+    writeKeys(stream, keys);
+    for (quint64 key : keys)
+    {
+        writeStyle(stream, slice.styles.value(key));
+    }
+    stream << slice.formulas << slice.viewRows << slice.spansSaved;
+    writeSpans(stream, slice.spans);
+    return data;
+}
+
+// false, если запись не прочитана или повреждена
+static bool unpackSlice(const QByteArray &data, TableSlice &slice)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_12);
+    slice = TableSlice();
+    quint32 columns = 0;
+    stream >> slice.rows >> columns;
+    for (quint32 i = 0; i < columns && stream.status() == QDataStream::Ok; ++i)
+    {
+        TableColumn column;
+        if (!column.read(stream))
+        {
+            return false;
+        }
+        slice.columns.append(column);
+    }
+
+    const QVector<quint64> keys = readKeys(stream);
+    for (quint64 key : keys)
+    {
+        slice.styles.insert(key, readStyle(stream));
+    }
+    stream >> slice.formulas >> slice.viewRows >> slice.spansSaved;
+    slice.spans = readSpans(stream);
+    return stream.status() == QDataStream::Ok;
+}
+
+StoredCommand::StoredCommand(TableModel *model, const QString &text) : QUndoCommand(text),
+                                                                      model(model),
+                                                                      store(model->records),
+                                                                      entry(-1)
+{
+}
+
+StoredCommand::~StoredCommand()
+{
+    drop();
+}
+
+void StoredCommand::save(const QByteArray &data)
+{
+    drop();
+    entry = store->store(data);
+}
+
+QByteArray StoredCommand::saved() const
+{
+    return isStored() ? store->load(entry) : QByteArray();
+}
+
+void StoredCommand::fail()
+{
+    // Шаг не выполнен, и модель больше не соответствует истории: команда
+    // убирается, а история очищается, когда стек закончит текущий шаг
+    qWarning() << "Table undo: cannot read the record of" << text();
+    setObsolete(true);
+    QUndoStack *stack = model->undoStack();
+    QTimer::singleShot(0, stack, [stack]()
+                       { stack->clear(); });
+}
+
+void StoredCommand::drop()
+{
+    if (isStored())
+    {
+        store->release(entry);
+        entry = -1;
+    }
+}
+
+CellsCommand::CellsCommand(TableModel *model, const CellDelta &delta, const QString &text) : StoredCommand(model, text),
+                                                                                            pending(delta)
+{
+}
+
+void CellsCommand::undo()
+{
+    apply(false);
+}
+
+void CellsCommand::redo()
+{
+    if (isStored())
+    {
+        apply(true);
+        return;
+    }
+    model->applyCells(pending, true);
+    save(packCells(pending));
+    pending = CellDelta();
+}
+
+void CellsCommand::apply(bool after)
+{
+    CellDelta delta;
+    if (!unpackCells(saved(), delta))
+    {
+        fail();
+        return;
+    }
+    model->applyCells(delta, after);
+}
+
+OrderCommand::OrderCommand(TableModel *model, bool ordered, const QVector<int> &order, const QVector<SortKey> &keys,
+                           const QVector<RowFilter> &filters, const QString &text) : StoredCommand(model, text)
+{
+    before = State{model->ordered, model->order, model->keys, model->filters};
+    after = State{ordered, order, keys, filters};
+}
+
+void OrderCommand::undo()
+{
+    QDataStream stream(saved());
+    stream.setVersion(QDataStream::Qt_5_12);
+    const State previous = readState(stream);
+    if (stream.status() != QDataStream::Ok)
+    {
+        fail();
+        return;
+    }
+    apply(previous);
+}
+
+void OrderCommand::redo()
+{
+    if (!isStored())
+    {
+        apply(after);
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_12);
+        writeState(stream, before);
+        writeState(stream, after);
+        save(data);
+        before = State();
+        after = State();
+        return;
+    }
+
+    QDataStream stream(saved());
+    stream.setVersion(QDataStream::Qt_5_12);
+    readState(stream);
+    const State next = readState(stream);
+    if (stream.status() != QDataStream::Ok)
+    {
+        fail();
+        return;
+    }
+    apply(next);
+}
+
+void OrderCommand::apply(const State &state)
+{
+    model->applyRowOrder(state.ordered, state.order, state.keys, state.filters);
+}
+
+SpansCommand::SpansCommand(TableModel *model, const QVector<StyleSpan> &spans, const QString &text) : StoredCommand(model, text),
+                                                                                                     before(model->spans),
+                                                                                                     after(spans)
+{
+}
+
+void SpansCommand::undo()
+{
+    QDataStream stream(saved());
+    stream.setVersion(QDataStream::Qt_5_12);
+    const QVector<StyleSpan> previous = readSpans(stream);
+    if (stream.status() != QDataStream::Ok)
+    {
+        fail();
+        return;
+    }
+    model->applySpans(previous);
+}
+
+void SpansCommand::redo()
+{
+    if (!isStored())
+    {
+        model->applySpans(after);
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_12);
+        writeSpans(stream, before);
+        writeSpans(stream, after);
+        save(data);
+        before.clear();
+        after.clear();
+        return;
+    }
+
+    QDataStream stream(saved());
+    stream.setVersion(QDataStream::Qt_5_12);
+    readSpans(stream);
+    const QVector<StyleSpan> next = readSpans(stream);
+    if (stream.status() != QDataStream::Ok)
+    {
+        fail();
+        return;
+    }
+    model->applySpans(next);
+}
+
+StructureCommand::StructureCommand(TableModel *model, Qt::Orientation orientation, const IndexShift &shift,
+                                   const TableSlice &content, const QString &text) : StoredCommand(model, text),
+                                                                                     orientation(orientation),
+                                                                                     shift(shift),
+                                                                                     pending(content)
+{
+}
+
+void StructureCommand::undo()
+{
+    if (shift.isRemoval())
+    {
+        insert(shift.inverted());
+    }
+    else
+    {
+        remove(shift.inverted());
+    }
+}
+
+void StructureCommand::redo()
+{
+    if (shift.isRemoval())
+    {
+        remove(shift);
+    }
+    else
+    {
+        insert(shift);
+    }
+}
+
+void StructureCommand::remove(const IndexShift &removed)
+{
+    save(packSlice(model->removeSource(orientation, removed)));
+}
+
+void StructureCommand::insert(const IndexShift &inserted)
+{
+    TableSlice content = pending;
+    if (isStored() && !unpackSlice(saved(), content))
+    {
+        fail();
+        return;
+    }
+    model->insertSource(orientation, inserted, content);
+    // Содержимое снова в таблице, запись больше не нужна
+    drop();
+    pending = TableSlice();
+}
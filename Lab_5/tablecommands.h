@@ -0,0 +1,114 @@
+#ifndef TABLECOMMANDS_H
+#define TABLECOMMANDS_H
+
+#include <QSharedPointer>
+#include <QUndoCommand>
+
+#include "tablemodel.h"
+#include "undostore.h"
+
+// Команда отмены таблицы, разница которой хранится в UndoStore модели:
+// в памяти сжатой, а при превышении лимита - во временном файле.
+// До первого выполнения разница лежит в самой команде, поэтому правка не
+// ждёт упаковки, а отмена только распаковывает записанное.
+class StoredCommand : public QUndoCommand
+{
+public:
+    ~StoredCommand() override;
+
+protected:
+    StoredCommand(TableModel *model, const QString &text);
+
+    bool isStored() const { return entry >= 0; }
+    void save(const QByteArray &data);
+    QByteArray saved() const;
+    void drop();
+    // Запись не прочитана: предупреждение, команда и история отмены удаляются
+    void fail();
+
+    TableModel *model;
+
+private:
+    QSharedPointer<UndoStore> store;
+    int entry;
+};
+
+// Правка текста или оформления ячеек: одна ячейка, выделение или вставка из
+// буфера. Хранит только затронутые ячейки со значениями до и после.
+class CellsCommand : public StoredCommand
+{
+public:
+    CellsCommand(TableModel *model, const CellDelta &delta, const QString &text);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    void apply(bool after);
+
+    CellDelta pending;
+};
+
+// Сортировка, фильтр или их сброс: порядок строк до и после
+class OrderCommand : public StoredCommand
+{
+public:
+    OrderCommand(TableModel *model, bool ordered, const QVector<int> &order, const QVector<SortKey> &keys,
+                 const QVector<RowFilter> &filters, const QString &text);
+
+    void undo() override;
+    void redo() override;
+
+    struct State
+    {
+        bool ordered;
+        QVector<int> order;
+        QVector<SortKey> keys;
+        QVector<RowFilter> filters;
+    };
+
+private:
+    void apply(const State &state);
+
+    State before;
+    State after;
+};
+
+// Оформление строк, столбцов или прямоугольников: весь список диапазонов
+// оформления до и после. Диапазонов немного, и размер записи не зависит от
+// числа закрашенных ячеек.
+class SpansCommand : public StoredCommand
+{
+public:
+    SpansCommand(TableModel *model, const QVector<StyleSpan> &spans, const QString &text);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    QVector<StyleSpan> before;
+    QVector<StyleSpan> after;
+};
+
+// Вставка или удаление нескольких участков строк или столбцов - один шаг
+// отмены. Участки заданы номерами хранилища; хранится только содержимое
+// удалённых строк или столбцов, пока его нет в таблице.
+class StructureCommand : public StoredCommand
+{
+public:
+    StructureCommand(TableModel *model, Qt::Orientation orientation, const IndexShift &shift,
+                     const TableSlice &content, const QString &text);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    void remove(const IndexShift &removed);
+    void insert(const IndexShift &inserted);
+
+    Qt::Orientation orientation;
+    IndexShift shift;
+    TableSlice pending; // Места новых строк для первой вставки
+};
+
+#endif // TABLECOMMANDS_H
@@ -0,0 +1,1203 @@
+#include "tablemodel.h"
+
+#include <QBrush>
+
+#include "tablecommands.h"
+
+#include <algorithm>
+#include <climits>
+#include <set>
+#include <tuple>
+
+bool CellStyle::operator==(const CellStyle &other) const
+{
+    return foreground == other.foreground &&
+           background == other.background &&
+           font == other.font &&
+           alignment == other.alignment;
+}
+
+const int StyleSpan::End;
+
+// Последняя собранная ячейка не запомнена
+static const quint64 NoCachedStyle = ~quint64(0);
+
+// Прямоугольник outer целиком покрывает inner
+static bool covers(const CellRange &outer, const CellRange &inner)
+{
+    return outer.top <= inner.top && outer.left <= inner.left &&
+           outer.bottom >= inner.bottom && outer.right >= inner.right;
+}
+
+// Переносит в target свойства fields из source
+static void applyFields(CellStyle &target, int fields, const CellStyle &source)
+{
+    if (fields & StyleSpan::Foreground)
+    {
+        target.foreground = source.foreground;
+    }
+    if (fields & StyleSpan::Background)
+    {
+        target.background = source.background;
+    }
+    if (fields & StyleSpan::Font)
+    {
+        target.font = source.font;
+    }
+    if (fields & StyleSpan::Alignment)
+    {
+        target.alignment = source.alignment;
+    }
+}
+
+// Ячейки с ключами cellKey как прямоугольники для пересчёта формул
+static QVector<CellRange> cellRanges(const QHash<quint64, QString> &cells)
+{
+    QVector<CellRange> ranges;
+    ranges.reserve(cells.size());
+    for (auto it = cells.constBegin(); it != cells.constEnd(); ++it)
+    {
+        const int row = int(it.key() >> 32);
+        const int column = int(it.key() & 0xffffffffu);
+        ranges.append(CellRange{row, column, row, column});
+    }
+    return ranges;
+}
+
+uint qHash(const CellStyle &style, uint seed)
+{
+    return qHash(style.foreground.rgba(), seed) ^
+           qHash(style.background.rgba(), seed) ^
+           qHash(style.font.key(), seed) ^
+           qHash(style.alignment, seed);
+}
+
+TableModel::TableModel(QObject *parent) : TableModel(0, 0, parent)
+{
+}
+
+TableModel::TableModel(int rows, int columns, QObject *parent) : QAbstractTableModel(parent),
+                                                                 columnData(columns, TableColumn(rows)),
+                                                                 rows(rows),
+                                                                 fieldDelimiter(','),
+                                                                 ordered(false),
+                                                                 revision(0),
+                                                                 undo(new QUndoStack(this)),
+                                                                 records(new UndoStore),
+                                                                 cachedKey(NoCachedStyle)
+{
+    palette.append(CellStyle());
+    paletteIds.insert(palette.first(), 0);
+}
+
+int TableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return ordered ? order.size() : rows;
+}
+
+int TableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : columnData.size();
+}
+
+QVariant TableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+    {
+        return QVariant();
+    }
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        if (!formulas.isEmpty() && formulas.hasFormula(sourceRow(index.row()), index.column()))
+        {
+            return formulas.value(sourceRow(index.row()), index.column());
+        }
+        return text(index.row(), index.column());
+    case Qt::EditRole:
+        return text(index.row(), index.column());
+    case Qt::ForegroundRole:
+    {
+        const QColor &color = style(index.row(), index.column()).foreground;
+        return color.isValid() ? QVariant(QBrush(color)) : QVariant();
+    }
+    case Qt::BackgroundRole:
+    {
+        const QColor &color = style(index.row(), index.column()).background;
+        return color.isValid() ? QVariant(QBrush(color)) : QVariant();
+    }
+    case Qt::FontRole:
+    {
+        const QFont &font = style(index.row(), index.column()).font;
+        return font != QFont() ? QVariant(font) : QVariant();
+    }
+    case Qt::TextAlignmentRole:
+        return style(index.row(), index.column()).alignment;
+    default:
+        return QVariant();
+    }
+}
+
+bool TableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || role != Qt::EditRole)
+    {
+        return false;
+    }
+
+    const QString newText = value.toString();
+    const int row = sourceRow(index.row());
+    const QString oldText = columnData.at(index.column()).text(row);
+    if (oldText == newText)
+    {
+        return false;
+    }
+
+    CellDelta delta;
+    delta.cells.append(cellKey(row, index.column()));
+    delta.textsBefore.append(oldText);
+    delta.textsAfter.append(newText);
+    undo->push(new CellsCommand(this, delta, tr("Правка ячейки")));
+    return true;
+}
+
+QVariant TableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+    {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    // Столбцы называются как в ссылках формул, строки нумеруются по хранилищу
+    if (orientation == Qt::Horizontal)
+    {
+        return FormulaEngine::columnName(section);
+    }
+    return section < rowCount() ? sourceRow(section) + 1 : section + 1;
+}
+
+Qt::ItemFlags TableModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+    {
+        return Qt::NoItemFlags;
+    }
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+}
+
+bool TableModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+    return !parent.isValid() && insertRanges(Qt::Vertical, {IndexRange{row, count}});
+}
+
+bool TableModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    return !parent.isValid() && removeRanges(Qt::Vertical, {IndexRange{row, count}});
+}
+
+bool TableModel::insertColumns(int column, int count, const QModelIndex &parent)
+{
+    return !parent.isValid() && insertRanges(Qt::Horizontal, {IndexRange{column, count}});
+}
+
+bool TableModel::removeColumns(int column, int count, const QModelIndex &parent)
+{
+    return !parent.isValid() && removeRanges(Qt::Horizontal, {IndexRange{column, count}});
+}
+
+bool TableModel::insertRanges(Qt::Orientation orientation, const QVector<IndexRange> &ranges)
+{
+    const int size = orientation == Qt::Vertical ? rowCount() : columnData.size();
+    for (const IndexRange &range : ranges)
+    {
+        if (range.first < 0 || range.first > size || range.count < 0)
+        {
+            return false;
+        }
+    }
+    IndexShift shift(ranges, false);
+    if (shift.isEmpty())
+    {
+        return false;
+    }
+
+    TableSlice content;
+    if (orientation == Qt::Vertical && ordered)
+    {
+        // При заданном порядке новые строки дописываются в конец хранилища,
+        // а в представлении встают на указанные места
+        int inserted = 0;
+        for (const IndexRange &range : shift.ranges())
+        {
+            for (int i = 0; i < range.count; ++i)
+            {
+                content.viewRows.append(range.first + inserted + i);
+            }
+            inserted += range.count;
+        }
+        shift = IndexShift({IndexRange{rows, inserted}}, false);
+    }
+
+    undo->push(new StructureCommand(this, orientation, shift, content,
+                                    orientation == Qt::Vertical ? tr("Вставка строк") : tr("Вставка столбцов")));
+    return true;
+}
+
+bool TableModel::removeRanges(Qt::Orientation orientation, const QVector<IndexRange> &ranges)
+{
+    const int size = orientation == Qt::Vertical ? rowCount() : columnData.size();
+    for (const IndexRange &range : ranges)
+    {
+        if (range.first < 0 || range.count < 0 || range.first + range.count > size)
+        {
+            return false;
+        }
+    }
+    IndexShift shift(ranges, true);
+    if (shift.isEmpty())
+    {
+        return false;
+    }
+
+    if (orientation == Qt::Vertical && ordered)
+    {
+        // Строки представления разбросаны по хранилищу: собираем их в участки хранилища
+        QVector<int> source;
+        source.reserve(shift.total());
+        for (const IndexRange &range : shift.ranges())
+        {
+            for (int row = range.first; row < range.first + range.count; ++row)
+            {
+                source.append(order.at(row));
+            }
+        }
+        std::sort(source.begin(), source.end());
+
+        QVector<IndexRange> sourceRanges;
+        for (int row : source)
+        {
+            if (!sourceRanges.isEmpty() && sourceRanges.last().first + sourceRanges.last().count == row)
+            {
+                ++sourceRanges.last().count;
+            }
+            else
+            {
+                sourceRanges.append(IndexRange{row, 1});
+            }
+        }
+        shift = IndexShift(sourceRanges, true);
+    }
+
+    undo->push(new StructureCommand(this, orientation, shift, TableSlice(),
+                                    orientation == Qt::Vertical ? tr("Удаление строк") : tr("Удаление столбцов")));
+    return true;
+}
+
+void TableModel::insertSource(Qt::Orientation orientation, const IndexShift &shift, const TableSlice &content)
+{
+    const bool vertical = orientation == Qt::Vertical;
+
+    // Новые номера вставленных строк или столбцов по порядку участков
+    QVector<int> inserted;
+    inserted.reserve(shift.total());
+    for (const IndexRange &range : shift.ranges())
+    {
+        const int first = shift.map(range.first) - range.count;
+        for (int i = 0; i < range.count; ++i)
+        {
+            inserted.append(first + i);
+        }
+    }
+
+    // Один участок без перестановки строк - уведомление о диапазоне, иначе один сброс
+    const IndexRange &range = shift.ranges().first();
+    const bool notifyRange = shift.ranges().size() == 1 && (!vertical || !ordered);
+    if (!notifyRange)
+    {
+        beginResetModel();
+    }
+    else if (vertical)
+    {
+        beginInsertRows(QModelIndex(), range.first, range.first + range.count - 1);
+    }
+    else
+    {
+        beginInsertColumns(QModelIndex(), range.first, range.first + range.count - 1);
+    }
+
+    if (vertical)
+    {
+        for (TableColumn &column : columnData)
+        {
+            column.insert(shift);
+        }
+        rows += shift.total();
+
+        if (ordered)
+        {
+            // Строки с известным местом встают на него, без места - в конец, скрытые фильтром не показываются
+            QVector<QPair<int, int>> placed; // Место в представлении и строка хранилища
+            for (int i = 0; i < inserted.size(); ++i)
+            {
+                const int viewRow = content.viewRows.isEmpty() ? INT_MAX : content.viewRows.value(i, -1);
+                if (viewRow >= 0)
+                {
+                    placed.append(qMakePair(viewRow, inserted.at(i)));
+                }
+            }
+            std::sort(placed.begin(), placed.end());
+
+            QVector<int> newOrder;
+            newOrder.reserve(order.size() + placed.size());
+            int next = 0;
+            for (int source : order)
+            {
+                while (next < placed.size() && placed.at(next).first <= newOrder.size())
+                {
+                    newOrder.append(placed.at(next++).second);
+                }
+                newOrder.append(shift.map(source));
+            }
+            while (next < placed.size())
+            {
+                newOrder.append(placed.at(next++).second);
+            }
+            order.swap(newOrder);
+            viewIndex.clear();
+        }
+    }
+    else
+    {
+        // Удалённые столбцы возвращаются целиком, если число строк с тех пор не изменилось
+        QVector<TableColumn> newColumns;
+        newColumns.reserve(columnData.size() + inserted.size());
+        int next = 0;
+        for (int j = 0; j <= columnData.size(); ++j)
+        {
+            while (next < inserted.size() && inserted.at(next) == newColumns.size())
+            {
+                const bool restored = next < content.columns.size() && content.columns.at(next).size() == rows;
+                newColumns.append(restored ? content.columns.at(next) : TableColumn(rows));
+                ++next;
+            }
+            if (j < columnData.size())
+            {
+                newColumns.append(columnData.at(j));
+            }
+        }
+        columnData.swap(newColumns);
+        remapOrderColumns(shift);
+    }
+
+    remapStyles(orientation, shift);
+    const QHash<quint64, QString> rewritten = formulas.shift(orientation, shift);
+    setFormulaTexts(rewritten);
+
+    // Возвращаем содержимое: текст, формулы, оформление
+    const int restored = qMin(vertical ? content.rows.size() : content.columns.size(), inserted.size());
+    for (int i = 0; i < restored; ++i)
+    {
+        if (vertical)
+        {
+            const QStringList &cells = content.rows.at(i);
+            for (int j = 0; j < cells.size() && j < columnData.size(); ++j)
+            {
+                if (cells.at(j).isEmpty())
+                {
+                    continue;
+                }
+                columnData[j].setText(inserted.at(i), cells.at(j));
+                if (FormulaEngine::isFormula(cells.at(j)))
+                {
+                    formulas.setCell(inserted.at(i), j, cells.at(j));
+                }
+            }
+            continue;
+        }
+
+        // Текст возвращённого столбца уже на месте, остаётся зарегистрировать его формулы
+        const TableColumn &column = columnData.at(inserted.at(i));
+        for (int row = 0; row < rows; ++row)
+        {
+            if (!column.isEmpty(row))
+            {
+                const QString cell = column.text(row);
+                if (FormulaEngine::isFormula(cell))
+                {
+                    formulas.setCell(row, inserted.at(i), cell);
+                }
+            }
+        }
+    }
+    // Диапазоны оформления возвращаются такими, какими были до удаления
+    if (content.spansSaved)
+    {
+        spans = content.spans;
+        spanIndex.clear();
+    }
+    for (auto it = content.styles.constBegin(); it != content.styles.constEnd(); ++it)
+    {
+        const int line = inserted.value(int(it.key() >> 32), -1);
+        const int cross = int(it.key() & 0xffffffffu);
+        const int id = styleId(it.value());
+        if (line >= 0 && id != 0)
+        {
+            cellStyles.insert(vertical ? cellKey(line, cross) : cellKey(cross, line), id);
+        }
+    }
+    for (auto it = content.formulas.constBegin(); it != content.formulas.constEnd(); ++it)
+    {
+        const int row = int(it.key() >> 32);
+        const int column = int(it.key() & 0xffffffffu);
+        if (row < rows && column < columnData.size())
+        {
+            columnData[column].setText(row, it.value());
+            formulas.setCell(row, column, it.value());
+        }
+    }
+
+    ++revision;
+    if (!notifyRange)
+    {
+        endResetModel();
+    }
+    else if (vertical)
+    {
+        endInsertRows();
+    }
+    else
+    {
+        endInsertColumns();
+    }
+
+    // Пересчитываются формулы с переписанными ссылками, возвращённые ячейки
+    // и всё, что от них зависит; значения остальных формул не изменились
+    QVector<CellRange> changed = cellRanges(rewritten) + cellRanges(content.formulas);
+    for (const IndexRange &inserted : shift.ranges())
+    {
+        const int first = shift.map(inserted.first) - inserted.count;
+        const int last = first + inserted.count - 1;
+        changed.append(vertical ? CellRange{first, 0, last, columnData.size() - 1}
+                                : CellRange{0, first, rows - 1, last});
+    }
+    recalculate(changed);
+}
+
+TableSlice TableModel::removeSource(Qt::Orientation orientation, const IndexShift &shift)
+{
+    const bool vertical = orientation == Qt::Vertical;
+    TableSlice content;
+
+    // Для отмены сохраняется только затронутое: текст, оформление и места удаляемых строк
+    if (vertical)
+    {
+        content.rows.reserve(shift.total());
+        for (const IndexRange &range : shift.ranges())
+        {
+            for (int row = range.first; row < range.first + range.count; ++row)
+            {
+                QStringList cells;
+                cells.reserve(columnData.size());
+                for (const TableColumn &column : columnData)
+                {
+                    cells.append(column.text(row));
+                }
+                content.rows.append(cells);
+            }
+        }
+        if (ordered)
+        {
+            content.viewRows.fill(-1, shift.total());
+            for (int i = 0; i < order.size(); ++i)
+            {
+                const int line = shift.indexInRanges(order.at(i));
+                if (line >= 0)
+                {
+                    content.viewRows[line] = i;
+                }
+            }
+        }
+    }
+    else
+    {
+        for (const IndexRange &range : shift.ranges())
+        {
+            content.columns += columnData.mid(range.first, range.count);
+        }
+    }
+    content.spans = spans;
+    content.spansSaved = true;
+    for (auto it = cellStyles.constBegin(); it != cellStyles.constEnd(); ++it)
+    {
+        const int row = int(it.key() >> 32);
+        const int column = int(it.key() & 0xffffffffu);
+        const int line = shift.indexInRanges(vertical ? row : column);
+        if (line >= 0)
+        {
+            content.styles.insert(cellKey(line, vertical ? column : row), palette.at(it.value()));
+        }
+    }
+
+    const IndexRange &range = shift.ranges().first();
+    const bool notifyRange = shift.ranges().size() == 1 && (!vertical || !ordered);
+    if (!notifyRange)
+    {
+        beginResetModel();
+    }
+    else if (vertical)
+    {
+        beginRemoveRows(QModelIndex(), range.first, range.first + range.count - 1);
+    }
+    else
+    {
+        beginRemoveColumns(QModelIndex(), range.first, range.first + range.count - 1);
+    }
+
+    // Формулы сдвигаются до изменения столбцов, чтобы запомнить прежний текст переписанных
+    const QHash<quint64, QString> rewritten = formulas.shift(orientation, shift);
+    const IndexShift back = shift.inverted();
+    for (auto it = rewritten.constBegin(); it != rewritten.constEnd(); ++it)
+    {
+        int row = int(it.key() >> 32);
+        int column = int(it.key() & 0xffffffffu);
+        int &position = vertical ? row : column;
+        position = back.map(position);
+        content.formulas.insert(cellKey(row, column), columnData.at(column).text(row));
+    }
+
+    if (vertical)
+    {
+        for (TableColumn &column : columnData)
+        {
+            column.remove(shift);
+        }
+        rows -= shift.total();
+
+        if (ordered)
+        {
+            QVector<int> remaining;
+            remaining.reserve(order.size());
+            for (int source : order)
+            {
+                const int row = shift.map(source);
+                if (row >= 0)
+                {
+                    remaining.append(row);
+                }
+            }
+            order.swap(remaining);
+            viewIndex.clear();
+        }
+    }
+    else
+    {
+        QVector<TableColumn> remaining;
+        remaining.reserve(columnData.size() - shift.total());
+        for (int j = 0; j < columnData.size(); ++j)
+        {
+            if (shift.map(j) >= 0)
+            {
+                remaining.append(columnData.at(j));
+            }
+        }
+        columnData.swap(remaining);
+        remapOrderColumns(shift);
+    }
+    remapStyles(orientation, shift);
+    setFormulaTexts(rewritten);
+
+    ++revision;
+    if (!notifyRange)
+    {
+        endResetModel();
+    }
+    else if (vertical)
+    {
+        endRemoveRows();
+    }
+    else
+    {
+        endRemoveColumns();
+    }
+
+    // Ссылки на удалённые ячейки переписаны в #REF!, а диапазоны сжаты, так
+    // что пересчитываются только переписанные формулы и зависящие от них
+    recalculate(cellRanges(rewritten));
+    return content;
+}
+
+QString TableModel::text(int row, int column) const
+{
+    return columnData.at(column).text(sourceRow(row));
+}
+
+void TableModel::appendRows(const QVector<QStringList> &newRows)
+{
+    if (newRows.isEmpty())
+    {
+        return;
+    }
+
+    // Строка длиннее остальных добавляет столбцы, короткие дополняются пустыми ячейками
+    int columns = 0;
+    for (const QStringList &cells : newRows)
+    {
+        columns = qMax(columns, cells.size());
+    }
+    if (columns > columnData.size())
+    {
+        beginInsertColumns(QModelIndex(), columnData.size(), columns - 1);
+        columnData.insert(columnData.size(), columns - columnData.size(), TableColumn(rows));
+        endInsertColumns();
+    }
+
+    // При заданном порядке новые строки показываются в конце
+    const int first = rowCount();
+    beginInsertRows(QModelIndex(), first, first + newRows.size() - 1);
+    for (int j = 0; j < columnData.size(); ++j)
+    {
+        TableColumn &column = columnData[j];
+        column.reserve(rows + newRows.size());
+        for (int i = 0; i < newRows.size(); ++i)
+        {
+            const QString cell = newRows.at(i).value(j);
+            column.append(cell);
+            if (FormulaEngine::isFormula(cell))
+            {
+                formulas.setCell(rows + i, j, cell);
+            }
+        }
+    }
+    if (ordered)
+    {
+        for (int i = 0; i < newRows.size(); ++i)
+        {
+            order.append(rows + i);
+        }
+        viewIndex.clear();
+    }
+    const int firstNew = rows;
+    rows += newRows.size();
+    ++revision;
+    endInsertRows();
+
+    // Новые формулы и формулы, чьи диапазоны захватывают новые строки
+    if (!formulas.isEmpty())
+    {
+        recalculate({CellRange{firstNew, 0, rows - 1, columnData.size() - 1}});
+    }
+}
+
+void TableModel::setRowOrder(const QVector<int> &newOrder, const QVector<SortKey> &newKeys, const QVector<RowFilter> &newFilters)
+{
+    undo->push(new OrderCommand(this, true, newOrder, newKeys, newFilters,
+                                newKeys.isEmpty() ? tr("Фильтр") : tr("Сортировка")));
+}
+
+void TableModel::clearRowOrder()
+{
+    if (!ordered)
+    {
+        return;
+    }
+    undo->push(new OrderCommand(this, false, QVector<int>(), QVector<SortKey>(), QVector<RowFilter>(),
+                                tr("Сброс сортировки и фильтра")));
+}
+
+void TableModel::applyRowOrder(bool newOrdered, const QVector<int> &newOrder, const QVector<SortKey> &newKeys,
+                               const QVector<RowFilter> &newFilters)
+{
+    beginResetModel();
+    ordered = newOrdered;
+    order = newOrder;
+    keys = newKeys;
+    filters = newFilters;
+
+    // Строк, добавленных загрузкой после снятия порядка, в нём нет; лишних номеров быть не должно
+    order.erase(std::remove_if(order.begin(), order.end(), [this](int row)
+                               { return row < 0 || row >= rows; }),
+                order.end());
+    viewIndex.clear();
+    endResetModel();
+}
+
+void TableModel::setDefaultStyle(const CellStyle &style)
+{
+    paletteIds.remove(palette.first());
+    palette[0] = style;
+    paletteIds.insert(style, 0);
+    emitStylesChanged();
+}
+
+const CellStyle &TableModel::style(int row, int column) const
+{
+    const int source = sourceRow(row);
+    const quint64 key = cellKey(source, column);
+    const CellStyle &base = palette.at(cellStyles.value(key, 0));
+    if (spans.isEmpty())
+    {
+        return base;
+    }
+    if (key == cachedKey)
+    {
+        return cachedStyle;
+    }
+
+    // Сведённое оформление диапазонов ищется двоичным поиском по полосе и участку
+    if (spanIndex.isEmpty())
+    {
+        buildSpanIndex();
+    }
+    const auto band = std::upper_bound(spanIndex.constBegin(), spanIndex.constEnd(), column,
+                                       [](int value, const SpanBand &item)
+                                       { return value < item.left; }) -
+                      1;
+    const auto segment = std::upper_bound(band->segments.constBegin(), band->segments.constEnd(), source,
+                                          [](int value, const SpanSegment &item)
+                                          { return value < item.top; });
+    cachedKey = key;
+    cachedStyle = base;
+    if (segment != band->segments.constBegin())
+    {
+        applyFields(cachedStyle, (segment - 1)->fields, (segment - 1)->style);
+    }
+    return cachedStyle;
+}
+
+void TableModel::buildSpanIndex() const
+{
+    spanIndex.clear();
+    QVector<int> lefts{0};
+    for (const StyleSpan &span : spans)
+    {
+        lefts.append(span.range.left);
+        if (span.range.right != StyleSpan::End)
+        {
+            lefts.append(span.range.right + 1);
+        }
+    }
+    std::sort(lefts.begin(), lefts.end());
+    lefts.erase(std::unique(lefts.begin(), lefts.end()), lefts.end());
+
+    for (int left : lefts)
+    {
+        // Начала и концы диапазонов полосы по строкам: номер i + 1 - начало, -(i + 1) - конец
+        QVector<QPair<int, int>> events;
+        for (int i = 0; i < spans.size(); ++i)
+        {
+            const CellRange &range = spans.at(i).range;
+            if (range.left <= left && left <= range.right)
+            {
+                events.append(qMakePair(range.top, i + 1));
+                if (range.bottom != StyleSpan::End)
+                {
+                    events.append(qMakePair(range.bottom + 1, -(i + 1)));
+                }
+            }
+        }
+        std::sort(events.begin(), events.end());
+
+        // Участок сводится от новых диапазонов к старым, пока не заданы все свойства
+        SpanBand band{left, QVector<SpanSegment>()};
+        std::set<int> active;
+        for (int e = 0; e < events.size();)
+        {
+            const int top = events.at(e).first;
+            for (; e < events.size() && events.at(e).first == top; ++e)
+            {
+                const int id = events.at(e).second;
+                if (id > 0)
+                {
+                    active.insert(id - 1);
+                }
+                else
+                {
+                    active.erase(-id - 1);
+                }
+            }
+            SpanSegment segment{top, 0, CellStyle()};
+            for (auto it = active.rbegin(); it != active.rend() && segment.fields != StyleSpan::AllFields; ++it)
+            {
+                const StyleSpan &span = spans.at(*it);
+                const int fields = span.fields & ~segment.fields;
+                applyFields(segment.style, fields, span.style);
+                segment.fields |= fields;
+            }
+
+            // Соседние участки с одинаковым оформлением сливаются
+            if (!band.segments.isEmpty() && band.segments.last().fields == segment.fields &&
+                band.segments.last().style == segment.style)
+            {
+                continue;
+            }
+            band.segments.append(segment);
+        }
+        spanIndex.append(band);
+    }
+}
+
+void TableModel::applyStyle(const QVector<CellRange> &ranges, int fields, const CellStyle &style)
+{
+    QVector<StyleSpan> added;
+    const bool allRowsShown = rowCount() == rows;
+    for (const CellRange &range : ranges)
+    {
+        if (range.top < 0 || range.left < 0 || range.top > range.bottom || range.left > range.right ||
+            range.bottom >= rowCount() || range.right >= columnData.size())
+        {
+            continue;
+        }
+
+        // Во всю ширину - целые строки, во всю высоту показанной целиком таблицы - целые столбцы
+        const int right = range.left == 0 && range.right == columnData.size() - 1 ? int(StyleSpan::End) : range.right;
+        if (allRowsShown && range.top == 0 && range.bottom == rowCount() - 1)
+        {
+            added.append(StyleSpan{CellRange{0, range.left, StyleSpan::End, right}, fields, style});
+            continue;
+        }
+        if (!ordered)
+        {
+            added.append(StyleSpan{CellRange{range.top, range.left, range.bottom, right}, fields, style});
+            continue;
+        }
+
+        // Строки представления разбросаны по хранилищу: диапазон на каждую серию строк хранилища подряд.
+        // Серии соседних прямоугольников, идущие одна за другой, сливаются ниже
+        QVector<int> source;
+        source.reserve(range.bottom - range.top + 1);
+        for (int row = range.top; row <= range.bottom; ++row)
+        {
+            source.append(order.at(row));
+        }
+        std::sort(source.begin(), source.end());
+        for (int first = 0; first < source.size();)
+        {
+            int last = first;
+            while (last + 1 < source.size() && source.at(last + 1) == source.at(last) + 1)
+            {
+                ++last;
+            }
+            added.append(StyleSpan{CellRange{source.at(first), range.left, source.at(last), right}, fields, style});
+            first = last + 1;
+        }
+    }
+    if (added.isEmpty())
+    {
+        return;
+    }
+
+    // У всех новых диапазонов одно оформление, и их порядок не важен: диапазоны
+    // одних столбцов, продолжающие друг друга по строкам, объединяются
+    std::sort(added.begin(), added.end(), [](const StyleSpan &a, const StyleSpan &b)
+              { return std::make_tuple(a.range.left, a.range.right, a.range.top) <
+                       std::make_tuple(b.range.left, b.range.right, b.range.top); });
+    QVector<StyleSpan> merged;
+    for (const StyleSpan &span : added)
+    {
+        if (!merged.isEmpty())
+        {
+            CellRange &last = merged.last().range;
+            if (last.left == span.range.left && last.right == span.range.right &&
+                (last.bottom == StyleSpan::End || span.range.top <= last.bottom + 1))
+            {
+                last.bottom = qMax(last.bottom, span.range.bottom);
+                continue;
+            }
+        }
+        merged.append(span);
+    }
+    addSpans(merged, tr("Оформление ячеек"));
+}
+
+void TableModel::addSpans(const QVector<StyleSpan> &added, const QString &text)
+{
+    // Старые диапазоны, которые новый закрывает целиком и по месту, и по
+    // свойствам, больше не видны и выбрасываются
+    QVector<StyleSpan> newSpans = spans;
+    for (const StyleSpan &span : added)
+    {
+        newSpans.erase(std::remove_if(newSpans.begin(), newSpans.end(), [&span](const StyleSpan &old)
+                                      { return covers(span.range, old.range) && (old.fields & ~span.fields) == 0; }),
+                       newSpans.end());
+        newSpans.append(span);
+    }
+    undo->push(new SpansCommand(this, newSpans, text));
+}
+
+void TableModel::applySpans(const QVector<StyleSpan> &newSpans)
+{
+    spans = newSpans;
+    spanIndex.clear();
+    emitStylesChanged();
+}
+
+bool TableModel::pasteCells(int row, int column, const QVector<QStringList> &cells)
+{
+    if (row < 0 || column < 0 || row >= rowCount() || column >= columnData.size())
+    {
+        return false;
+    }
+
+    // В разницу попадают только ячейки, текст которых меняется
+    CellDelta delta;
+    const int height = qMin(cells.size(), rowCount() - row);
+    for (int i = 0; i < height; ++i)
+    {
+        const int source = sourceRow(row + i);
+        const QStringList &line = cells.at(i);
+        const int width = qMin(line.size(), columnData.size() - column);
+        for (int j = 0; j < width; ++j)
+        {
+            const QString before = columnData.at(column + j).text(source);
+            if (before != line.at(j))
+            {
+                delta.cells.append(cellKey(source, column + j));
+                delta.textsBefore.append(before);
+                delta.textsAfter.append(line.at(j));
+            }
+        }
+    }
+    if (!delta.cells.isEmpty())
+    {
+        undo->push(new CellsCommand(this, delta, tr("Вставка ячеек")));
+    }
+    return true;
+}
+
+void TableModel::applyCells(const CellDelta &delta, bool after)
+{
+    const QStringList &texts = after ? delta.textsAfter : delta.textsBefore;
+    QVector<CellRange> changed;
+    CellRange bounds{INT_MAX, INT_MAX, -1, -1};
+    for (int i = 0; i < delta.cells.size(); ++i)
+    {
+        const quint64 key = delta.cells.at(i);
+        const int row = int(key >> 32);
+        const int column = int(key & 0xffffffffu);
+        if (row >= rows || column >= columnData.size())
+        {
+            continue;
+        }
+
+        const QString &text = texts.at(i);
+        columnData[column].setText(row, text);
+        if (FormulaEngine::isFormula(text) || formulas.hasFormula(row, column))
+        {
+            formulas.setCell(row, column, text);
+        }
+        bounds = CellRange{qMin(bounds.top, row), qMin(bounds.left, column),
+                           qMax(bounds.bottom, row), qMax(bounds.right, column)};
+        if (delta.cells.size() <= 256)
+        {
+            changed.append(CellRange{row, column, row, column});
+        }
+    }
+    emitCellsChanged(delta.cells, {Qt::DisplayRole, Qt::EditRole});
+
+    // Пересчитываются формулы, зависящие от изменённых ячеек; после большой
+    // правки - от охватывающего прямоугольника
+    if (bounds.bottom >= 0)
+    {
+        recalculate(changed.isEmpty() ? QVector<CellRange>{bounds} : changed);
+    }
+}
+
+void TableModel::setStyles(const QVector<CellStyle> &newPalette, const QHash<quint64, int> &newCellStyles,
+                           const QVector<StyleSpan> &newSpans)
+{
+    palette = newPalette;
+    paletteIds.clear();
+    for (int i = palette.size() - 1; i >= 0; --i)
+    {
+        paletteIds.insert(palette.at(i), i);
+    }
+    cellStyles = newCellStyles;
+    spans = newSpans;
+    spanIndex.clear();
+    emitStylesChanged();
+}
+
+quint64 TableModel::cellKey(int row, int column)
+{
+    return (quint64(quint32(row)) << 32) | quint32(column);
+}
+
+int TableModel::styleId(const CellStyle &style)
+{
+    auto it = paletteIds.constFind(style);
+    if (it != paletteIds.constEnd())
+    {
+        return it.value();
+    }
+
+    palette.append(style);
+    paletteIds.insert(style, palette.size() - 1);
+    return palette.size() - 1;
+}
+
+void TableModel::remapStyles(Qt::Orientation orientation, const IndexShift &shift)
+{
+    cachedKey = NoCachedStyle;
+    remapSpans(orientation, shift);
+    if (cellStyles.isEmpty())
+    {
+        return;
+    }
+
+    // Сдвигаем ключи оформленных ячеек после вставки или удаления строк и столбцов
+    QHash<quint64, int> remapped;
+    remapped.reserve(cellStyles.size());
+    for (auto it = cellStyles.constBegin(); it != cellStyles.constEnd(); ++it)
+    {
+        int row = int(it.key() >> 32);
+        int column = int(it.key() & 0xffffffffu);
+        int &position = orientation == Qt::Vertical ? row : column;
+
+        position = shift.map(position);
+        if (position >= 0)
+        {
+            remapped.insert(cellKey(row, column), it.value());
+        }
+    }
+    cellStyles.swap(remapped);
+}
+
+void TableModel::remapSpans(Qt::Orientation orientation, const IndexShift &shift)
+{
+    // Границы сжимаются к оставшимся строкам и столбцам. Вставленные внутрь
+    // диапазона и прямо перед его первой строкой попадают в него, поэтому
+    // диапазон от начала таблицы остаётся от начала; граница "до конца" не меняется
+    QVector<StyleSpan> remapped;
+    for (StyleSpan span : spans)
+    {
+        int &low = orientation == Qt::Vertical ? span.range.top : span.range.left;
+        int &high = orientation == Qt::Vertical ? span.range.bottom : span.range.right;
+        if (shift.isRemoval())
+        {
+            const int newLow = shift.survivorsBefore(low);
+            if (high != StyleSpan::End)
+            {
+                high = shift.survivorsBefore(high + 1) - 1;
+            }
+            low = newLow;
+        }
+        else
+        {
+            low = low > 0 ? shift.map(low - 1) + 1 : 0;
+            if (high != StyleSpan::End)
+            {
+                high = shift.map(high);
+            }
+        }
+        if (low <= high)
+        {
+            remapped.append(span);
+        }
+    }
+    spans.swap(remapped);
+    spanIndex.clear();
+}
+
+void TableModel::remapOrderColumns(const IndexShift &shift)
+{
+    // Ключи и условия по удалённым столбцам выпадают, остальные сдвигаются
+    QVector<SortKey> remappedKeys;
+    for (SortKey key : keys)
+    {
+        key.column = shift.map(key.column);
+        if (key.column >= 0)
+        {
+            remappedKeys.append(key);
+        }
+    }
+    keys.swap(remappedKeys);
+
+    QVector<RowFilter> remappedFilters;
+    for (RowFilter filter : filters)
+    {
+        filter.column = shift.map(filter.column);
+        if (filter.column >= 0)
+        {
+            remappedFilters.append(filter);
+        }
+    }
+    filters.swap(remappedFilters);
+}
+
+void TableModel::setFormulaTexts(const QHash<quint64, QString> &texts)
+{
+    // Ссылки в формулах переписаны, новый текст сохраняется в ячейках
+    for (auto it = texts.constBegin(); it != texts.constEnd(); ++it)
+    {
+        columnData[int(it.key() & 0xffffffffu)].setText(int(it.key() >> 32), it.value());
+    }
+}
+
+void TableModel::emitStylesChanged()
+{
+    cachedKey = NoCachedStyle;
+    if (rowCount() > 0 && !columnData.isEmpty())
+    {
+        emit dataChanged(index(0, 0), index(rowCount() - 1, columnData.size() - 1),
+                         {Qt::ForegroundRole, Qt::BackgroundRole, Qt::FontRole, Qt::TextAlignmentRole});
+    }
+}
+
+int TableModel::viewRow(int source) const
+{
+    if (!ordered)
+    {
+        return source;
+    }
+    // Обратный порядок строится один раз после смены порядка, а не при каждой правке
+    if (viewIndex.size() != rows)
+    {
+        viewIndex.fill(-1, rows);
+        for (int i = 0; i < order.size(); ++i)
+        {
+            viewIndex[order.at(i)] = i;
+        }
+    }
+    return viewIndex.at(source);
+}
+
+void TableModel::emitCellsChanged(const QVector<quint64> &cells, const QVector<int> &roles)
+{
+    if (cells.isEmpty() || rowCount() == 0 || columnData.isEmpty())
+    {
+        return;
+    }
+
+    // Много изменённых ячеек - одно изменение на всю таблицу
+    if (cells.size() > 256)
+    {
+        emit dataChanged(index(0, 0), index(rowCount() - 1, columnData.size() - 1), roles);
+        return;
+    }
+
+    for (quint64 cell : cells)
+    {
+        const int source = int(cell >> 32);
+        const int column = int(cell & 0xffffffffu);
+        if (source >= rows || column >= columnData.size())
+        {
+            continue;
+        }
+        const int row = viewRow(source);
+        if (row >= 0)
+        {
+            const QModelIndex changedIndex = index(row, column);
+            emit dataChanged(changedIndex, changedIndex, roles);
+        }
+    }
+}
+
+void TableModel::recalculate(const QVector<CellRange> &changed)
+{
+    emitCellsChanged(formulas.recalculate(changed, columnData, rows), {Qt::DisplayRole});
+}
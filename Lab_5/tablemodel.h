@@ -0,0 +1,255 @@
+#ifndef TABLEMODEL_H
+#define TABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QUndoStack>
+#include <QVector>
+
+#include "formulaengine.h"
+#include "tablecolumn.h"
+#include "undostore.h"
+
+#include <climits>
+
+// Оформление ячейки. Каждое уникальное оформление хранится в палитре модели
+// один раз, ячейки ссылаются на него по номеру.
+struct CellStyle
+{
+    QColor foreground;
+    QColor background;
+    QFont font;
+    int alignment = Qt::AlignLeft | Qt::AlignVCenter;
+
+    bool operator==(const CellStyle &other) const;
+    bool operator!=(const CellStyle &other) const { return !(*this == other); }
+};
+
+uint qHash(const CellStyle &style, uint seed = 0);
+
+// Оформление прямоугольника ячеек, целых строк или столбцов одной записью.
+// Задаёт только отмеченные в fields свойства, остальные берутся из нижних
+// слоёв. Ячейка получает оформление при показе: стиль по умолчанию, затем
+// собственное оформление ячейки, затем диапазоны в порядке применения.
+struct StyleSpan
+{
+    enum Field
+    {
+        Foreground = 1,
+        Background = 2,
+        Font = 4,
+        Alignment = 8,
+        AllFields = Foreground | Background | Font | Alignment
+    };
+
+    static const int End = INT_MAX; // Граница "до конца таблицы": целые строки или столбцы
+
+    CellRange range; // Номера хранилища
+    int fields;
+    CellStyle style;
+};
+
+// Ключ сортировки строк
+struct SortKey
+{
+    int column;
+    Qt::SortOrder order;
+};
+
+// Условие отбора строк по значению в столбце. Для числовых столбцов и дат
+// сравниваются значения, для остальных - текст без учёта регистра.
+struct RowFilter
+{
+    enum Condition
+    {
+        Contains,
+        Equals,
+        NotEquals,
+        Less,
+        Greater
+    };
+
+    int column;
+    Condition condition;
+    QString value;
+};
+
+// Содержимое строк или столбцов, удалённых одним изменением, для отмены
+struct TableSlice
+{
+    QVector<QStringList> rows;        // Текст ячеек удалённых строк
+    QVector<TableColumn> columns;     // Удалённые столбцы целиком
+    QHash<quint64, CellStyle> styles; // Оформление; ключ - cellKey(номер в срезе, номер поперёк)
+    QHash<quint64, QString> formulas; // Прежний текст оставшихся формул, переписанных при удалении
+    QVector<int> viewRows;            // Места строк в представлении при заданном порядке, -1 - строка скрыта
+    QVector<StyleSpan> spans;         // Диапазоны оформления до удаления
+    bool spansSaved = false;
+};
+
+// Изменение отдельных ячеек для отмены: только затронутые ячейки, значения до и после
+struct CellDelta
+{
+    QVector<quint64> cells; // Ключи cellKey в номерах хранилища
+    QStringList textsBefore;
+    QStringList textsAfter;
+};
+
+// Модель таблицы с типизированным колоночным хранением и разреженной таблицей стилей.
+// Память растёт вместе с данными, а не с количеством объектов-ячеек.
+// Строки представления могут идти в другом порядке, чем строки хранилища:
+// сортировка и фильтр только переставляют номера строк, а номера строк во
+// всех методах, кроме columns() и styledCells(), - номера строк представления.
+// Ячейки с текстом "=..." - формулы: для редактирования отдаётся текст
+// формулы, для показа - её значение. Правка, оформление, вставка из буфера,
+// вставка и удаление строк и столбцов, сортировка и фильтр идут через стек
+// отмены модели.
+class TableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit TableModel(QObject *parent = nullptr);
+    TableModel(int rows, int columns, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    bool insertColumns(int column, int count, const QModelIndex &parent = QModelIndex()) override;
+    bool removeColumns(int column, int count, const QModelIndex &parent = QModelIndex()) override;
+
+    // Вставка и удаление нескольких участков строк (номера представления) или
+    // столбцов одним изменением: представление получает одно уведомление, а
+    // стек отмены - один шаг
+    bool insertRanges(Qt::Orientation orientation, const QVector<IndexRange> &ranges);
+    bool removeRanges(Qt::Orientation orientation, const QVector<IndexRange> &ranges);
+    QUndoStack *undoStack() const { return undo; }
+
+    // Ставит текст в прямоугольник ячеек, начиная с ячейки представления
+    // (row, column), одним изменением и одним шагом отмены; не поместившееся
+    // в таблицу отбрасывается
+    bool pasteCells(int row, int column, const QVector<QStringList> &cells);
+
+    QString text(int row, int column) const;
+    // Значения формул столбца по строкам хранилища, для сортировки и фильтра
+    QVector<QPair<int, QString>> formulaValues(int column) const { return formulas.columnValues(column); }
+    // Столбцы целиком в порядке хранилища: копия дешёвая за счёт неявного разделения данных
+    const QVector<TableColumn> &columns() const { return columnData; }
+    void appendRows(const QVector<QStringList> &rows);
+
+    // Порядок строк представления
+    int sourceRow(int row) const { return ordered ? order.at(row) : row; }
+    int sourceRowCount() const { return rows; }
+    // Разделитель полей файла, с которым таблица сохраняется обратно
+    char delimiter() const { return fieldDelimiter; }
+    void setDelimiter(char newDelimiter) { fieldDelimiter = newDelimiter; }
+    bool isOrdered() const { return ordered; }
+    const QVector<SortKey> &sortKeys() const { return keys; }
+    const QVector<RowFilter> &rowFilters() const { return filters; }
+    // Меняется при каждой вставке и удалении строк и столбцов; порядок,
+    // посчитанный по другой версии, применять нельзя
+    int structureRevision() const { return revision; }
+    // Смена порядка и его сброс - шаги отмены
+    void setRowOrder(const QVector<int> &newOrder, const QVector<SortKey> &newKeys, const QVector<RowFilter> &newFilters);
+    void clearRowOrder();
+
+    // Стиль с номером 0 используется для всех ячеек без собственного оформления
+    void setDefaultStyle(const CellStyle &style);
+    // Итоговое оформление ячейки со всеми слоями; ссылка действительна до следующего вызова
+    const CellStyle &style(int row, int column) const;
+    // Свойства fields из style для прямоугольников представления одним шагом
+    // отмены. Прямоугольник во всю высоту или ширину таблицы становится
+    // диапазоном целых столбцов или строк: память не зависит от числа ячеек
+    void applyStyle(const QVector<CellRange> &ranges, int fields, const CellStyle &style);
+
+    // Палитра, оформленные ячейки и диапазоны целиком, для файла оформления
+    static quint64 cellKey(int row, int column);
+    const QVector<CellStyle> &styles() const { return palette; }
+    const QHash<quint64, int> &styledCells() const { return cellStyles; }
+    const QVector<StyleSpan> &styleSpans() const { return spans; }
+    // Заменяет всё оформление одним изменением; стиль 0 - стиль по умолчанию
+    void setStyles(const QVector<CellStyle> &newPalette, const QHash<quint64, int> &newCellStyles,
+                   const QVector<StyleSpan> &newSpans = QVector<StyleSpan>());
+
+private:
+    friend class StoredCommand;
+    friend class CellsCommand;
+    friend class OrderCommand;
+    friend class StructureCommand;
+    friend class SpansCommand;
+
+    // Изменения, которые выполняют команды стека отмены
+    void applyCells(const CellDelta &delta, bool after);
+    void applySpans(const QVector<StyleSpan> &newSpans);
+    void addSpans(const QVector<StyleSpan> &added, const QString &text);
+    void applyRowOrder(bool newOrdered, const QVector<int> &newOrder, const QVector<SortKey> &newKeys,
+                       const QVector<RowFilter> &newFilters);
+
+    // Структурные изменения в номерах хранилища; их выполняют команды стека отмены
+    void insertSource(Qt::Orientation orientation, const IndexShift &shift, const TableSlice &content);
+    TableSlice removeSource(Qt::Orientation orientation, const IndexShift &shift);
+
+    int styleId(const CellStyle &style);
+    void remapStyles(Qt::Orientation orientation, const IndexShift &shift);
+    void remapSpans(Qt::Orientation orientation, const IndexShift &shift);
+    void buildSpanIndex() const;
+    void emitStylesChanged();
+    void remapOrderColumns(const IndexShift &shift);
+    void setFormulaTexts(const QHash<quint64, QString> &texts);
+    void emitCellsChanged(const QVector<quint64> &cells, const QVector<int> &roles);
+    // Строка представления для строки хранилища; -1 - строка скрыта фильтром
+    int viewRow(int source) const;
+    void recalculate(const QVector<CellRange> &changed);
+
+    QVector<TableColumn> columnData;
+    int rows; // Строки хранилища
+    char fieldDelimiter;
+
+    bool ordered;               // Строки показываются через order
+    QVector<int> order;         // Номер строки хранилища для каждой строки представления
+    QVector<SortKey> keys;      // Как получен order, для сортировки по нескольким столбцам
+    QVector<RowFilter> filters;
+    mutable QVector<int> viewIndex; // Обратный к order, строится по запросу; пусто - устарел
+    int revision;
+
+    FormulaEngine formulas; // Формулы в координатах хранилища
+
+    QVector<CellStyle> palette;       // Уникальные оформления
+    QHash<CellStyle, int> paletteIds; // Обратный индекс палитры
+    QHash<quint64, int> cellStyles;   // Ячейки с оформлением, отличным от стиля 0
+    QVector<StyleSpan> spans;         // Диапазоны оформления в порядке применения
+
+    // Индекс диапазонов для style(): границы диапазонов делят столбцы на
+    // полосы, а строки каждой полосы - на участки, в которых диапазоны уже
+    // сведены в одно оформление. Строится по запросу; пусто - устарел
+    struct SpanSegment
+    {
+        int top; // Первая строка хранилища; участок длится до следующего
+        int fields;
+        CellStyle style;
+    };
+    struct SpanBand
+    {
+        int left; // Первый столбец; полоса длится до следующей
+        QVector<SpanSegment> segments;
+    };
+    mutable QVector<SpanBand> spanIndex;
+
+    // Последняя собранная ячейка: представление запрашивает её свойства подряд
+    mutable quint64 cachedKey;
+    mutable CellStyle cachedStyle;
+
+    QUndoStack *undo;
+    QSharedPointer<UndoStore> records; // Разницы команд отмены
+};
+
+#endif // TABLEMODEL_H
@@ -0,0 +1,311 @@
+#include "tablesorter.h"
+
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <numeric>
+
+// Порядок групп ячеек, одинаковый при любом направлении сортировки:
+// значения типа столбца, затем текст не по типу, пустые ячейки в конце
+static int cellGroup(const TableColumn &column, int row)
+{
+    if (column.isEmpty(row))
+    {
+        return 2;
+    }
+    return column.type() == TableColumn::String || column.hasValue(row) ? 0 : 1;
+}
+
+// Границы частей для параллельной обработки: по одной на поток
+static QVector<int> splitRows(int rows)
+{
+    const int parts = rows < TableSorter::ParallelRows ? 1 : qMax(1, QThread::idealThreadCount());
+    QVector<int> bounds;
+    for (int part = 0; part <= parts; ++part)
+    {
+        bounds.append(int(qint64(rows) * part / parts));
+    }
+    return bounds;
+}
+
+TableSorter::TableSorter(QObject *parent) : QObject(parent),
+                                            rows(0),
+                                            revision(0)
+{
+    connect(&watcher, &QFutureWatcher<QVector<int>>::finished, this, [this]()
+            { emit finished(watcher.result()); });
+}
+
+TableSorter::~TableSorter()
+{
+    watcher.waitForFinished();
+}
+
+TableSorter *TableSorter::forModel(const TableModel *model, const QVector<SortKey> &keys,
+                                   const QVector<RowFilter> &filters, QObject *parent)
+{
+    TableSorter *sorter = new TableSorter(parent);
+    sorter->columns = model->columns();
+    sorter->rows = model->sourceRowCount();
+    sorter->revision = model->structureRevision();
+    sorter->keys = keys;
+    sorter->filters = filters;
+
+    // Значения формул снимаются только для столбцов, по которым идёт сравнение
+    QVector<int> compared;
+    for (const SortKey &key : keys)
+    {
+        compared.append(key.column);
+    }
+    for (const RowFilter &filter : filters)
+    {
+        compared.append(filter.column);
+    }
+    for (int column : compared)
+    {
+        if (!sorter->formulaValues.contains(column))
+        {
+            const QVector<QPair<int, QString>> values = model->formulaValues(column);
+            if (!values.isEmpty())
+            {
+                sorter->formulaValues.insert(column, values);
+            }
+        }
+    }
+    return sorter;
+}
+
+void TableSorter::start()
+{
+    watcher.setFuture(QtConcurrent::run(this, &TableSorter::run));
+}
+
+QVector<int> TableSorter::run()
+{
+    substituteFormulas();
+    parseFilters();
+
+    QVector<int> order;
+    filterRows(order);
+    if (!keys.isEmpty())
+    {
+        sortRows(order);
+    }
+    return order;
+}
+
+void TableSorter::substituteFormulas()
+{
+    // Вместо текста "=..." в снимок ставятся значения формул; столбец собирается
+    // заново, чтобы его тип выводился уже из значений
+    for (auto it = formulaValues.constBegin(); it != formulaValues.constEnd(); ++it)
+    {
+        const TableColumn &source = columns.at(it.key());
+        const QVector<QPair<int, QString>> &values = it.value();
+        TableColumn computed;
+        computed.reserve(rows);
+        int next = 0;
+        for (int row = 0; row < rows; ++row)
+        {
+            if (next < values.size() && values.at(next).first == row)
+            {
+                computed.append(values.at(next++).second);
+            }
+            else
+            {
+                computed.append(source.text(row));
+            }
+        }
+        columns[it.key()] = computed;
+    }
+}
+
+void TableSorter::parseFilters()
+{
+    // Значения условий разбираются один раз, а не для каждой строки
+    filterNumbers.clear();
+    numericFilters.clear();
+    for (const RowFilter &filter : filters)
+    {
+        double number = 0.0;
+        const bool numeric = columns.at(filter.column).toNumber(filter.value, number);
+        filterNumbers.append(number);
+        numericFilters.append(numeric);
+    }
+}
+
+bool TableSorter::accepts(int row) const
+{
+    for (int i = 0; i < filters.size(); ++i)
+    {
+        const RowFilter &filter = filters.at(i);
+        const TableColumn &column = columns.at(filter.column);
+        const QString text = column.type() == TableColumn::String ? QString() : column.text(row);
+        const QStringRef cell = column.type() == TableColumn::String ? column.textRef(row) : QStringRef(&text);
+
+        bool matches = false;
+        if (filter.condition == RowFilter::Contains)
+        {
+            matches = cell.contains(filter.value, Qt::CaseInsensitive);
+        }
+        else if (numericFilters.at(i) && column.hasValue(row))
+        {
+            const double value = column.number(row);
+            const double bound = filterNumbers.at(i);
+            switch (filter.condition)
+            {
+            case RowFilter::Equals:
+                matches = value == bound;
+                break;
+            case RowFilter::NotEquals:
+                matches = value != bound;
+                break;
+            case RowFilter::Less:
+                matches = value < bound;
+                break;
+            case RowFilter::Greater:
+                matches = value > bound;
+                break;
+            default:
+                break;
+            }
+        }
+        else
+        {
+            const int result = cell.compare(filter.value, Qt::CaseInsensitive);
+            switch (filter.condition)
+            {
+            case RowFilter::Equals:
+                matches = result == 0;
+                break;
+            case RowFilter::NotEquals:
+                matches = result != 0;
+                break;
+            case RowFilter::Less:
+                matches = !cell.isEmpty() && result < 0;
+                break;
+            case RowFilter::Greater:
+                matches = !cell.isEmpty() && result > 0;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (!matches)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TableSorter::lessThan(int a, int b) const
+{
+    for (const SortKey &key : keys)
+    {
+        const TableColumn &column = columns.at(key.column);
+        const int groupA = cellGroup(column, a);
+        const int groupB = cellGroup(column, b);
+        if (groupA != groupB)
+        {
+            return groupA < groupB;
+        }
+        if (groupA == 2)
+        {
+            continue;
+        }
+
+        int result;
+        if (column.type() == TableColumn::String)
+        {
+            result = column.textRef(a).compare(column.textRef(b), Qt::CaseInsensitive);
+        }
+        else if (groupA == 1)
+        {
+            result = column.text(a).compare(column.text(b), Qt::CaseInsensitive);
+        }
+        else if (column.type() == TableColumn::Float)
+        {
+            const double x = column.number(a);
+            const double y = column.number(b);
+            result = x < y ? -1 : (y < x ? 1 : 0);
+        }
+        else
+        {
+            const qint64 x = column.integer(a);
+            const qint64 y = column.integer(b);
+            result = x < y ? -1 : (y < x ? 1 : 0);
+        }
+
+        if (result != 0)
+        {
+            return key.order == Qt::AscendingOrder ? result < 0 : result > 0;
+        }
+    }
+    // Равные строки остаются в порядке хранилища
+    return a < b;
+}
+
+void TableSorter::filterRows(QVector<int> &order) const
+{
+    if (filters.isEmpty())
+    {
+        order.resize(rows);
+        std::iota(order.begin(), order.end(), 0);
+        return;
+    }
+
+    // Каждая часть отбирает свои строки, затем части склеиваются по порядку
+    const QVector<int> bounds = splitRows(rows);
+    QVector<QVector<int>> accepted(bounds.size() - 1);
+    QVector<int> *output = accepted.data(); // Без отсоединения данных внутри параллельных задач
+    QVector<int> parts(accepted.size());
+    std::iota(parts.begin(), parts.end(), 0);
+
+    QtConcurrent::blockingMap(parts, [&](int part)
+                              {
+                                  for (int row = bounds.at(part); row < bounds.at(part + 1); ++row)
+                                  {
+                                      if (accepts(row))
+                                      {
+                                          output[part].append(row);
+                                      }
+                                  }
+                              });
+
+    for (const QVector<int> &part : accepted)
+    {
+        order += part;
+    }
+}
+
+void TableSorter::sortRows(QVector<int> &order) const
+{
+    auto less = [this](int a, int b)
+    { return lessThan(a, b); };
+
+    // Части сортируются параллельно, затем сливаются попарно, тоже параллельно
+    const QVector<int> bounds = splitRows(order.size());
+    const int parts = bounds.size() - 1;
+    int *data = order.data();
+
+    QVector<int> tasks(parts);
+    std::iota(tasks.begin(), tasks.end(), 0);
+    QtConcurrent::blockingMap(tasks, [&](int part)
+                              { std::sort(data + bounds.at(part), data + bounds.at(part + 1), less); });
+
+    for (int width = 1; width < parts; width *= 2)
+    {
+        tasks.clear();
+        for (int part = 0; part + width < parts; part += 2 * width)
+        {
+            tasks.append(part);
+        }
+        QtConcurrent::blockingMap(tasks, [&](int part)
+                                  { std::inplace_merge(data + bounds.at(part), data + bounds.at(part + width),
+                                                       data + bounds.at(qMin(part + 2 * width, parts)), less); });
+    }
+}
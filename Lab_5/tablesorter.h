@@ -0,0 +1,60 @@
+#ifndef TABLESORTER_H
+#define TABLESORTER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QVector>
+
+#include "tablemodel.h"
+
+// Фоновая сортировка и фильтр таблицы.
+// В потоке GUI снимается снимок столбцов (дешёвый за счёт неявного
+// разделения данных), в рабочих потоках отбираются строки и сортируются их
+// номера. Результат - порядок строк для TableModel::setRowOrder, сами ячейки
+// не перемещаются. Ячейки с формулами сравниваются по вычисленным значениям,
+// снятым вместе со столбцами.
+class TableSorter : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int ParallelRows = 64 * 1024; // Таблицы меньше этого обрабатываются в одном потоке
+
+    static TableSorter *forModel(const TableModel *model, const QVector<SortKey> &keys,
+                                 const QVector<RowFilter> &filters, QObject *parent = nullptr);
+    ~TableSorter() override;
+
+    const QVector<SortKey> &sortKeys() const { return keys; }
+    const QVector<RowFilter> &rowFilters() const { return filters; }
+    // Версия структуры модели, по которой посчитан порядок
+    int structureRevision() const { return revision; }
+    void start();
+
+signals:
+    // Номера строк хранилища в порядке показа
+    void finished(const QVector<int> &order);
+
+private:
+    explicit TableSorter(QObject *parent);
+
+    QVector<int> run();
+    void substituteFormulas();
+    void parseFilters();
+    bool accepts(int row) const;
+    bool lessThan(int a, int b) const;
+    void filterRows(QVector<int> &order) const;
+    void sortRows(QVector<int> &order) const;
+
+    QVector<TableColumn> columns;
+    int rows;
+    int revision;
+    QVector<SortKey> keys;
+    QVector<RowFilter> filters;
+    QVector<double> filterNumbers; // Значение условия как число, если столбец числовой
+    QVector<bool> numericFilters;
+    QHash<int, QVector<QPair<int, QString>>> formulaValues; // Столбец -> значения его формул по строкам
+
+    QFutureWatcher<QVector<int>> watcher;
+};
+
+#endif // TABLESORTER_H
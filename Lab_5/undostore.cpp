@@ -0,0 +1,99 @@
+#include "undostore.h"
+
+#include <QDebug>
+
+UndoStore::UndoStore() : nextEntry(0),
+                         memory(0),
+                         spilled(0)
+{
+}
+
+int UndoStore::store(const QByteArray &data)
+{
+    // Быстрое сжатие: запись делается при каждой правке и не должна её замедлять
+    Entry entry;
+    entry.data = qCompress(data, 1);
+    entry.offset = -1;
+    entry.size = entry.data.size();
+    memory += entry.size;
+
+    const int id = nextEntry++;
+    entries.insert(id, entry);
+    if (memory > MemoryLimit)
+    {
+        spill();
+    }
+    return id;
+}
+
+QByteArray UndoStore::load(int entry)
+{
+    auto it = entries.constFind(entry);
+    if (it == entries.constEnd())
+    {
+        return QByteArray();
+    }
+    if (it->offset < 0)
+    {
+        return qUncompress(it->data);
+    }
+
+    if (!file.seek(it->offset))
+    {
+        qWarning() << "UndoStore: cannot read" << file.fileName();
+        return QByteArray();
+    }
+    return qUncompress(file.read(it->size));
+}
+
+void UndoStore::release(int entry)
+{
+    auto it = entries.find(entry);
+    if (it == entries.end())
+    {
+        return;
+    }
+    if (it->offset < 0)
+    {
+        memory -= it->size;
+    }
+    else
+    {
+        --spilled;
+    }
+    entries.erase(it);
+
+    // Когда в файле не осталось записей, место в нём освобождается
+    if (spilled == 0 && file.isOpen() && file.size() > 0)
+    {
+        file.resize(0);
+    }
+}
+
+void UndoStore::spill()
+{
+    if (!file.isOpen() && !file.open())
+    {
+        // Без временного файла записи остаются в памяти
+        return;
+    }
+
+    // Старые записи дописываются в конец файла, пока память не станет вдвое меньше лимита
+    for (auto it = entries.begin(); it != entries.end() && memory > MemoryLimit / 2; ++it)
+    {
+        if (it->offset >= 0)
+        {
+            continue;
+        }
+        const qint64 offset = file.size();
+        if (!file.seek(offset) || file.write(it->data) != it->size)
+        {
+            qWarning() << "UndoStore: cannot write" << file.fileName();
+            return;
+        }
+        it->offset = offset;
+        it->data = QByteArray();
+        memory -= it->size;
+        ++spilled;
+    }
+}
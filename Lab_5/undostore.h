@@ -0,0 +1,44 @@
+#ifndef UNDOSTORE_H
+#define UNDOSTORE_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QTemporaryFile>
+
+// Записи команд отмены таблицы. Каждая запись - сжатая разница "было/стало",
+// а не копия таблицы. Пока суммарный размер записей в памяти больше лимита,
+// самые старые записи уходят во временный файл и читаются оттуда только при
+// отмене. Команды держат хранилище через QSharedPointer, поэтому оно живёт,
+// пока жива последняя команда.
+class UndoStore
+{
+public:
+    static const qint64 MemoryLimit = 64 * 1024 * 1024;
+
+    UndoStore();
+
+    // Номер новой записи
+    int store(const QByteArray &data);
+    QByteArray load(int entry);
+    void release(int entry);
+    // Сжатые записи в памяти, байт
+    qint64 memoryUsage() const { return memory; }
+
+private:
+    struct Entry
+    {
+        QByteArray data; // Пусто, если запись в файле
+        qint64 offset;   // Место в файле, -1 - запись в памяти
+        int size;
+    };
+
+    void spill();
+
+    QMap<int, Entry> entries; // По возрастанию номеров - от старых к новым
+    int nextEntry;
+    qint64 memory;
+    int spilled;              // Записи в файле
+    QTemporaryFile file;
+};
+
+#endif // UNDOSTORE_H